@@ -0,0 +1,903 @@
+/**
+ * \file            bench.c
+ * \brief           Micro-benchmarks of MicroRL library with output captured by virtual terminal
+ */
+
+/*
+ * Portion Copyright (c) 2011 Eugene SAMOYLOV
+ * Portion Copyright (c) 2021 Dmitry KARASEV
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of MicroRL - Micro Read Line library for small and embedded devices.
+ *
+ * Authors:         Eugene SAMOYLOV aka Helius <ghelius@gmail.com>,
+ *                  Dmitry KARASEV <karasevsdmitry@yandex.ru>
+ * Version:         1.7.0
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "microrl.h"
+#include "vterm.h"
+
+#ifndef BENCH_CONFIG
+#define BENCH_CONFIG                        "custom"
+#endif
+
+/* Minimum measured time of each workload, in nanoseconds */
+#ifndef BENCH_MIN_TIME_NS
+#define BENCH_MIN_TIME_NS                   50000000ULL
+#endif
+
+#define BENCH_COMPL_NUM                     500
+
+/* Size of storage for exported history */
+#define BENCH_HIST_STORE_LEN                4096
+
+#define BENCH_IS_UTF8_CONT(x)               (((unsigned char)(x) & 0xC0) == 0x80)
+
+/*
+ * Time and cycle counters. On Cortex-M3/M4/M7 build with BENCH_DWT and BENCH_CPU_HZ,
+ * cycles are read from DWT and time is computed from them. On host time is read
+ * from monotonic clock and cycles from time stamp counter where it is available
+ */
+#if defined(BENCH_DWT)
+#ifndef BENCH_CPU_HZ
+#error "BENCH_CPU_HZ must be set for DWT cycle counter"
+#endif /* BENCH_CPU_HZ */
+#define DWT_CTRL                            (*(volatile uint32_t*)0xE0001000)
+#define DWT_CYCCNT                          (*(volatile uint32_t*)0xE0001004)
+#define DEMCR                               (*(volatile uint32_t*)0xE000EDFC)
+#define BENCH_HAS_CYCLES                    1
+
+static uint64_t cycles_high;
+static uint32_t cycles_last;
+
+static void timer_init(void) {
+    DEMCR |= 1UL << 24;                         /* TRCENA */
+    DWT_CYCCNT = 0;
+    DWT_CTRL |= 1UL;                            /* CYCCNTENA */
+}
+
+static uint64_t bench_cycles(void) {
+    uint32_t now = DWT_CYCCNT;
+
+    // Extend 32 bit counter, it is read often enough to see every wrap
+    if (now < cycles_last) {
+        cycles_high += 1ULL << 32;
+    }
+    cycles_last = now;
+    return cycles_high | now;
+}
+
+static uint64_t bench_ns(void) {
+    return bench_cycles() * 1000000000ULL / BENCH_CPU_HZ;
+}
+#else
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAS_CYCLES                    1
+
+static uint64_t bench_cycles(void) {
+    return __rdtsc();
+}
+#else
+#define BENCH_HAS_CYCLES                    0
+
+static uint64_t bench_cycles(void) {
+    return 0;
+}
+#endif /* defined(__x86_64__) || defined(__i386__) */
+
+static void timer_init(void) {
+}
+
+static uint64_t bench_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+#endif /* defined(BENCH_DWT) */
+
+/**
+ * \brief           Benchmark workload
+ */
+typedef struct {
+    const char* name;                           /*!< Workload name */
+    void (*run)(microrl_t* mrl);                /*!< Feed input to initialized instance */
+} workload_t;
+
+static vterm_t vt;                              /* Terminal, output is checked in the first run */
+static int capture;                             /* Output goes to terminal */
+static size_t out_calls;                        /* Number of output callback calls */
+static size_t out_bytes;                        /* Number of output bytes */
+static size_t in_bytes;                         /* Number of input bytes */
+static size_t errors;                           /* Number of failed checks made by workload */
+
+#if MICRORL_CFG_USE_EXT_BUFFERS
+static char cmdline_buf[MICRORL_CFG_CMDLINE_LEN];
+#if MICRORL_CFG_USE_HISTORY
+static char hist_buf[MICRORL_CFG_RING_HISTORY_LEN];
+#endif /* MICRORL_CFG_USE_HISTORY */
+#endif /* MICRORL_CFG_USE_EXT_BUFFERS */
+
+#if MICRORL_CFG_USE_COMPLETE
+static char compl_names[BENCH_COMPL_NUM + 2][16];
+static char* compl_list[BENCH_COMPL_NUM + 3];
+#endif /* MICRORL_CFG_USE_COMPLETE */
+
+#if MICRORL_CFG_USE_HISTORY_PERSIST
+static char hist_store[BENCH_HIST_STORE_LEN];   /* Exported history, like flash page */
+static size_t hist_store_len;
+#endif /* MICRORL_CFG_USE_HISTORY_PERSIST */
+
+#if MICRORL_CFG_USE_OUTPUT_BACKPRESSURE
+static size_t link_budget;                      /* Number of bytes terminal link accepts until it is drained */
+#endif /* MICRORL_CFG_USE_OUTPUT_BACKPRESSURE */
+
+#if MICRORL_CFG_USE_ESC_TIMEOUT
+static uint32_t bench_time;                     /* Time of time callback, moved by workload */
+#endif /* MICRORL_CFG_USE_ESC_TIMEOUT */
+
+/**
+ * \brief           Output callback, counts output and passes it to terminal
+ */
+static void bench_print(microrl_t* mrl, const char* str) {
+    size_t len = strlen(str);
+
+    (void)mrl;
+    out_calls++;
+    out_bytes += len;
+    if (capture) {
+        vterm_feed(&vt, str, len);
+    }
+}
+
+#if MICRORL_CFG_USE_OUTPUT_BUFFER
+/**
+ * \brief           Buffer output callback, counts output and passes it to terminal
+ */
+static void bench_write(microrl_t* mrl, const char* buf, size_t len) {
+    (void)mrl;
+    out_calls++;
+    out_bytes += len;
+    if (capture) {
+        vterm_feed(&vt, buf, len);
+    }
+}
+#endif /* MICRORL_CFG_USE_OUTPUT_BUFFER */
+
+#if MICRORL_CFG_USE_OUTPUT_BACKPRESSURE
+/**
+ * \brief           Non-blocking output callback, accepts bytes up to link budget
+ */
+static size_t bench_try_write(microrl_t* mrl, const char* buf, size_t len) {
+    (void)mrl;
+    if (len > link_budget) {
+        len = link_budget;
+    }
+    link_budget -= len;
+    out_calls++;
+    out_bytes += len;
+    if (capture) {
+        vterm_feed(&vt, buf, len);
+    }
+    return len;
+}
+#endif /* MICRORL_CFG_USE_OUTPUT_BACKPRESSURE */
+
+/**
+ * \brief           Execute callback, does nothing. With deferred execution
+ *                  command "wait" is left pending
+ */
+static int bench_execute(microrl_t* mrl, int argc, const char* const *argv) {
+    (void)mrl;
+#if MICRORL_CFG_USE_ASYNC_EXEC
+    if ((argc > 0) && (strcmp(argv[0], "wait") == 0)) {
+        return MICRORL_EXEC_PENDING;
+    }
+#endif /* MICRORL_CFG_USE_ASYNC_EXEC */
+    (void)argc;
+    (void)argv;
+    return 0;
+}
+
+#if MICRORL_CFG_USE_COMMANDS
+#if MICRORL_CFG_USE_COMMAND_ARGS
+#define BENCH_ARGS(args)                    , args, sizeof(args) / sizeof(args[0])
+
+static const char* const speed_modes[] = {"fast", "normal", "slow", NULL};
+
+static const microrl_arg_t gpio_args[] = {
+    {"pin", MICRORL_ARG_HEX, NULL, 0},
+    {"value", MICRORL_ARG_INT, NULL, 1},
+};
+
+static const microrl_arg_t speed_args[] = {
+    {"motor", MICRORL_ARG_INT, NULL, 0},
+    {"mode", MICRORL_ARG_ENUM, speed_modes, 0},
+    {"-v", MICRORL_ARG_FLAG, NULL, 0},
+};
+#else
+#define BENCH_ARGS(args)
+#endif /* MICRORL_CFG_USE_COMMAND_ARGS */
+
+static const microrl_cmd_t gpio_cmds[] = {
+    {"get", bench_execute, NULL, 0, "Read pin" BENCH_ARGS(gpio_args)},
+    {"set", bench_execute, NULL, 0, "Write pin" BENCH_ARGS(gpio_args)},
+};
+
+static const microrl_cmd_t motor_cmds[] = {
+    {"speed", bench_execute, NULL, 0, "Set motor speed" BENCH_ARGS(speed_args)},
+    {"stop", bench_execute, NULL, 0, "Stop motor"},
+};
+
+static const microrl_cmd_t bench_cmds[] = {
+    {"gpio", NULL, gpio_cmds, 2, "GPIO pins"},
+    {"help", bench_execute, NULL, 0, "Print help"},
+    {"motor", NULL, motor_cmds, 2, "Motor control"},
+    {"reset", bench_execute, NULL, 0, "Reset device"},
+    {"version", bench_execute, NULL, 0, "Print version"},
+};
+#endif /* MICRORL_CFG_USE_COMMANDS */
+
+#if MICRORL_CFG_USE_COMPLETE
+/**
+ * \brief           Completion callback, returns names starting with the last token
+ */
+static char** bench_complete(microrl_t* mrl, int argc, const char* const *argv) {
+    size_t prefix_len = strlen(argv[argc - 1]);
+    size_t num = 0;
+
+    (void)mrl;
+    if (argc == 1) {
+        for (size_t i = 0; i < (BENCH_COMPL_NUM + 2); ++i) {
+            if (strncmp(compl_names[i], argv[0], prefix_len) == 0) {
+                compl_list[num++] = compl_names[i];
+            }
+        }
+    }
+    compl_list[num] = NULL;
+    return compl_list;
+}
+#endif /* MICRORL_CFG_USE_COMPLETE */
+
+/**
+ * \brief           Initialize instance for the next run of workload
+ */
+static void bench_init(microrl_t* mrl) {
+#if MICRORL_CFG_USE_EXT_BUFFERS
+#if MICRORL_CFG_USE_HISTORY
+    microrl_init_ex(mrl, bench_print, cmdline_buf, sizeof(cmdline_buf), hist_buf, sizeof(hist_buf));
+#else
+    microrl_init_ex(mrl, bench_print, cmdline_buf, sizeof(cmdline_buf), NULL, 0);
+#endif /* MICRORL_CFG_USE_HISTORY */
+#else
+    microrl_init(mrl, bench_print);
+#endif /* MICRORL_CFG_USE_EXT_BUFFERS */
+#if MICRORL_CFG_USE_OUTPUT_BUFFER
+    microrl_set_write_callback(mrl, bench_write);
+#endif /* MICRORL_CFG_USE_OUTPUT_BUFFER */
+#if MICRORL_CFG_USE_OUTPUT_BACKPRESSURE
+    link_budget = SIZE_MAX;
+    microrl_set_try_write_callback(mrl, bench_try_write);
+#endif /* MICRORL_CFG_USE_OUTPUT_BACKPRESSURE */
+    microrl_set_execute_callback(mrl, bench_execute);
+#if MICRORL_CFG_USE_COMPLETE
+    microrl_set_complete_callback(mrl, bench_complete);
+#endif /* MICRORL_CFG_USE_COMPLETE */
+}
+
+/**
+ * \brief           Type string key by key
+ */
+static void type(microrl_t* mrl, const char* str) {
+    for (; *str != '\0'; ++str) {
+        microrl_insert_char(mrl, *str);
+        in_bytes++;
+    }
+}
+
+/**
+ * \brief           Press the same key several times, key can be ESC sequence
+ */
+static void press(microrl_t* mrl, const char* key, int times) {
+    while (times-- > 0) {
+        type(mrl, key);
+    }
+}
+
+/**
+ * \brief           Pass block of input at once, like paste from terminal does
+ */
+static void paste(microrl_t* mrl, const char* buf, size_t len) {
+    microrl_process_input(mrl, buf, len);
+    in_bytes += len;
+}
+
+/**
+ * \brief           Workload: type lines key by key and run them
+ */
+static void run_typing(microrl_t* mrl) {
+    char line[64];
+
+    for (int i = 0; i < 20; ++i) {
+        sprintf(line, "set mode test value %d\r", i);
+        type(mrl, line);
+    }
+    type(mrl, "get mode 'quoted arg'");
+}
+
+/**
+ * \brief           Workload: paste block to the middle of line
+ */
+static void run_paste(microrl_t* mrl) {
+    char block[MICRORL_CFG_CMDLINE_LEN];
+    size_t len = MICRORL_CFG_CMDLINE_LEN - 16;
+
+    for (size_t i = 0; i < len; ++i) {
+        block[i] = ((i % 8) == 7) ? ' ' : (char)('a' + (i % 26));
+    }
+    type(mrl, "echo begin end");
+    press(mrl, "\033[D", 4);
+    paste(mrl, block, len);
+}
+
+#if MICRORL_CFG_USE_HISTORY
+/**
+ * \brief           Workload: fill history and hold Up and Down keys
+ */
+static void run_history(microrl_t* mrl) {
+    char line[64];
+
+    for (int i = 0; i < 64; ++i) {
+        sprintf(line, "history record %d%s\r", i, ((i % 3) == 0) ? " with longer tail" : "");
+        type(mrl, line);
+    }
+    for (int i = 0; i < 10; ++i) {
+        press(mrl, "\033[A", 40);
+        press(mrl, "\033[B", 20);
+    }
+}
+#endif /* MICRORL_CFG_USE_HISTORY */
+
+#if MICRORL_CFG_USE_COMPLETE
+/**
+ * \brief           Workload: complete from large set of names
+ */
+static void run_complete(microrl_t* mrl) {
+    type(mrl, "ip\t");                          /* Common prefix */
+    type(mrl, "\t");                            /* All variants are listed */
+    type(mrl, "12\t");                          /* Ten variants are listed */
+    type(mrl, "3\t");                           /* The only variant */
+    type(mrl, "p\t");
+}
+#endif /* MICRORL_CFG_USE_COMPLETE */
+
+/**
+ * \brief           Workload: edit line of maximum length
+ */
+static void run_long_line(microrl_t* mrl) {
+    char line[MICRORL_CFG_CMDLINE_LEN];
+    size_t len = MICRORL_CFG_CMDLINE_LEN - 2;
+
+    for (size_t i = 0; i < len; ++i) {
+        line[i] = ((i % 10) == 9) ? ' ' : (char)('0' + (i % 10));
+    }
+    line[len] = '\0';
+    type(mrl, line);
+    type(mrl, "\001");                          /* Ctrl+A */
+    press(mrl, "\033[C", 20);
+    press(mrl, "\004", 10);                     /* Ctrl+D */
+    type(mrl, "\005");                          /* Ctrl+E */
+    press(mrl, "\b", 15);
+    type(mrl, "\001");
+    type(mrl, "inserted ");
+}
+
+#if MICRORL_CFG_USE_HISTORY
+#if MICRORL_CFG_USE_HISTORY_PERSIST
+/**
+ * \brief           Check command line of instance is equal to string.
+ *                  Token separators '\0' of command line are compared as whitespaces
+ * \return          '1' if line is equal, '0' otherwise
+ */
+static int line_equal(const microrl_t* mrl, const char* str) {
+    if (mrl->cmdlen != (int)strlen(str)) {
+        return 0;
+    }
+    for (int i = 0; i < mrl->cmdlen; ++i) {
+        if (((mrl->cmdline[i] == '\0') ? ' ' : mrl->cmdline[i]) != str[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * \brief           History export callback, appends data to storage
+ */
+static void bench_hist_sink(microrl_t* mrl, const char* data, size_t len) {
+    (void)mrl;
+    if (len > (sizeof(hist_store) - hist_store_len)) {
+        errors++;
+        return;
+    }
+    memcpy(hist_store + hist_store_len, data, len);
+    hist_store_len += len;
+}
+
+/**
+ * \brief           Workload: export history with small deltas, import it to new instance
+ *                  and navigate it. Imported bytes are counted as input
+ */
+static void run_persist(microrl_t* mrl) {
+    char line[64];
+
+    hist_store_len = 0;
+    for (int i = 0; i < 32; ++i) {
+        sprintf(line, "history record %d%s\r", i, ((i % 3) == 0) ? " with longer tail" : "");
+        type(mrl, line);
+    }
+    microrl_hist_export(mrl, bench_hist_sink);
+    for (int i = 32; i < 64; ++i) {
+        sprintf(line, "history record %d%s\r", i, ((i % 3) == 0) ? " with longer tail" : "");
+        type(mrl, line);
+        if (((i % 4) == 3) && (microrl_hist_export_delta(mrl, bench_hist_sink) != microrlOK)) {
+            microrl_hist_export(mrl, bench_hist_sink);
+        }
+    }
+
+    bench_init(mrl);                            /* Reboot */
+    if (microrl_hist_import(mrl, hist_store, hist_store_len) != microrlOK) {
+        errors++;
+    }
+    in_bytes += hist_store_len;
+    press(mrl, "\033[A", 1);
+    if (!line_equal(mrl, "history record 63 with longer tail")) {
+        errors++;
+    }
+    press(mrl, "\033[A", 20);
+    press(mrl, "\033[B", 10);
+}
+#endif /* MICRORL_CFG_USE_HISTORY_PERSIST */
+
+#if MICRORL_CFG_USE_HISTORY_SEARCH
+/**
+ * \brief           Workload: reverse history search with Ctrl+R, records are longer
+ *                  than narrow terminal
+ */
+static void run_search(microrl_t* mrl) {
+    static const char* const names[] = {"copy", "move", "list", "remove"};
+    char line[96];
+
+    for (int i = 0; i < 48; ++i) {
+        sprintf(line, "%s /data/log_%02d.txt /backup/log_%02d.txt --verbose\r", names[i % 4], i, i);
+        type(mrl, line);
+    }
+    for (int i = 0; i < 10; ++i) {
+        type(mrl, "\022log_1");                 /* Ctrl+R, pattern is typed key by key */
+        press(mrl, "\022", 4);                  /* Older records */
+        press(mrl, "\b", 3);
+        type(mrl, "zz");                        /* Nothing is found */
+        type(mrl, "\007");                      /* Ctrl+G cancels search */
+        type(mrl, "\022remove\005");            /* Ctrl+E takes found record */
+        type(mrl, "\025");                      /* Ctrl+U */
+    }
+    type(mrl, "\022move /data\005");
+}
+#endif /* MICRORL_CFG_USE_HISTORY_SEARCH */
+
+#if MICRORL_CFG_USE_OUTPUT_BACKPRESSURE
+/**
+ * \brief           Drain terminal link by chunks until all output and deferred redraw are passed
+ */
+static void drain(microrl_t* mrl, size_t chunk) {
+    do {
+        link_budget = chunk;
+        microrl_flush(mrl);
+    } while (mrl->tx_stalled || mrl->redraw_pending);
+    link_budget = SIZE_MAX;
+}
+
+/**
+ * \brief           Workload: hold Up, Down and Backspace keys while terminal link is stalled,
+ *                  then drain it slowly
+ */
+static void run_stall(microrl_t* mrl) {
+    char line[64];
+
+    for (int i = 0; i < 64; ++i) {
+        sprintf(line, "history record %d%s\r", i, ((i % 3) == 0) ? " with longer tail" : "");
+        type(mrl, line);
+    }
+    for (int i = 0; i < 10; ++i) {
+        link_budget = 0;
+        press(mrl, "\033[A", 40);
+        press(mrl, "\b", 5);
+        drain(mrl, 16);
+        link_budget = 0;
+        press(mrl, "\033[B", 20);
+        drain(mrl, 16);
+    }
+}
+#endif /* MICRORL_CFG_USE_OUTPUT_BACKPRESSURE */
+#endif /* MICRORL_CFG_USE_HISTORY */
+
+#if MICRORL_CFG_USE_COMMANDS
+/**
+ * \brief           Workload: dispatch lines to commands table and complete from it
+ */
+static void run_commands(microrl_t* mrl) {
+    static const char* const modes[] = {"fast", "normal", "slow"};
+    char line[64];
+
+    microrl_set_commands(mrl, bench_cmds, sizeof(bench_cmds) / sizeof(bench_cmds[0]));
+#if MICRORL_CFG_USE_COMPLETE
+    microrl_set_complete_callback(mrl, NULL);   /* TAB completes from commands table */
+#endif /* MICRORL_CFG_USE_COMPLETE */
+    for (int i = 0; i < 10; ++i) {
+        sprintf(line, "motor speed %d %s -v\r", i, modes[i % 3]);
+        type(mrl, line);
+        sprintf(line, "gpio set 0x%x %d\r", i + 10, i & 1);
+        type(mrl, line);
+        type(mrl, "motor stop\r");
+        type(mrl, "unknown command\r");     /* Passed to execute callback */
+    }
+    type(mrl, "motor\r");                       /* Subcommands are listed */
+    type(mrl, "gpio get pin\r");                /* Bad argument */
+    type(mrl, "mo\tsp\t1 f\t-\t");
+}
+#endif /* MICRORL_CFG_USE_COMMANDS */
+
+#if MICRORL_CFG_USE_ESC_TIMEOUT
+/**
+ * \brief           Time callback, returns time set by workload
+ */
+static uint32_t bench_get_time(microrl_t* mrl) {
+    (void)mrl;
+    return bench_time;
+}
+
+/**
+ * \brief           Workload: lone ESC keys between typed words and sequences split in time
+ */
+static void run_escape(microrl_t* mrl) {
+    bench_time = 0;
+    microrl_set_time_callback(mrl, bench_get_time);
+    for (int i = 0; i < 20; ++i) {
+        type(mrl, "word ");
+        type(mrl, "\033");                      /* Lone ESC key */
+        bench_time += MICRORL_CFG_ESC_TIMEOUT_TIME;
+        type(mrl, "x");                         /* Not part of sequence, it is inserted */
+        type(mrl, "\033");
+        bench_time += MICRORL_CFG_ESC_TIMEOUT_TIME;
+        microrl_tick(mrl);                      /* Sequence is finished without input */
+        type(mrl, "\033[");
+        bench_time += MICRORL_CFG_ESC_TIMEOUT_TIME / 2;
+        type(mrl, "D");                         /* Arrow key is received in time */
+    }
+}
+#endif /* MICRORL_CFG_USE_ESC_TIMEOUT */
+
+#if MICRORL_CFG_USE_LOG
+/**
+ * \brief           Print log text, it is counted as input
+ */
+static void log_text(microrl_t* mrl, const char* text, size_t len) {
+    microrl_log(mrl, text, len);
+    in_bytes += len;
+}
+
+/**
+ * \brief           Workload: flood of log lines printed while line is edited
+ */
+static void run_log(microrl_t* mrl) {
+    static const char msg[] = "sensor 12 value 3456" MICRORL_CFG_END_LINE;
+
+    type(mrl, "get sensor ");
+    for (int i = 0; i < 20; ++i) {
+        for (int j = 0; j < 10; ++j) {
+            log_text(mrl, msg, sizeof(msg) - 1);
+        }
+        microrl_tick(mrl);                      /* Line is printed again once */
+        type(mrl, "1");
+        log_text(mrl, msg, sizeof(msg) - 1);    /* Line is printed again by next input */
+        type(mrl, " ");
+    }
+}
+#endif /* MICRORL_CFG_USE_LOG */
+
+#if MICRORL_CFG_USE_ASYNC_EXEC
+/**
+ * \brief           Workload: keys typed while command is pending are processed after it
+ */
+static void run_async(microrl_t* mrl) {
+    char line[64];
+
+    for (int i = 0; i < 20; ++i) {
+        sprintf(line, "wait %d\r", i);
+        type(mrl, line);
+        type(mrl, "get status\r");              /* Kept in type-ahead buffer */
+        if (microrl_command_done(mrl, 0) != microrlOK) {
+            errors++;
+        }
+    }
+    type(mrl, "wait\rget");
+    microrl_command_done(mrl, 0);
+}
+#endif /* MICRORL_CFG_USE_ASYNC_EXEC */
+
+#if MICRORL_CFG_USE_UTF8
+/**
+ * \brief           Workload: edit line of UTF-8 labels longer than terminal width,
+ *                  chars of 2, 3 and 4 bytes are split between input blocks
+ */
+static void run_utf8(microrl_t* mrl) {
+    static const char label[] = "Größe-капля-€-\xF0\x9D\x84\x9E ";
+    char line[MICRORL_CFG_CMDLINE_LEN];
+    size_t len = 0;
+
+    while ((len + sizeof(label)) < (MICRORL_CFG_CMDLINE_LEN - 32)) {
+        memcpy(line + len, label, sizeof(label) - 1);
+        len += sizeof(label) - 1;
+    }
+    type(mrl, "name x\xC3\xA9\r");
+    type(mrl, "name y\xC3\xA9\r");
+    press(mrl, "\033[A", 1);                    /* Only one char differs */
+    type(mrl, "\025");                          /* Ctrl+U */
+    for (size_t i = 0; i < len; i += 7) {
+        paste(mrl, line + i, ((len - i) < 7) ? (len - i) : 7);
+    }
+    type(mrl, "\001");                          /* Ctrl+A */
+    press(mrl, "\033[C", 40);
+    press(mrl, "\004", 5);                      /* Ctrl+D */
+    type(mrl, "Ж\xE2\x82\xAC");
+    press(mrl, "\b", 3);
+    press(mrl, "\033[D", 10);
+    paste(mrl, label, sizeof(label) - 1);
+    type(mrl, "\005");                          /* Ctrl+E */
+    press(mrl, "\b", 12);
+}
+#endif /* MICRORL_CFG_USE_UTF8 */
+
+static const workload_t workloads[] = {
+    {"typing", run_typing},
+    {"paste-mid", run_paste},
+#if MICRORL_CFG_USE_HISTORY
+    {"history", run_history},
+#if MICRORL_CFG_USE_HISTORY_PERSIST
+    {"persist", run_persist},
+#endif /* MICRORL_CFG_USE_HISTORY_PERSIST */
+#if MICRORL_CFG_USE_HISTORY_SEARCH
+    {"search", run_search},
+#endif /* MICRORL_CFG_USE_HISTORY_SEARCH */
+#if MICRORL_CFG_USE_OUTPUT_BACKPRESSURE
+    {"stall", run_stall},
+#endif /* MICRORL_CFG_USE_OUTPUT_BACKPRESSURE */
+#endif /* MICRORL_CFG_USE_HISTORY */
+#if MICRORL_CFG_USE_COMPLETE
+    {"complete", run_complete},
+#endif /* MICRORL_CFG_USE_COMPLETE */
+    {"long-line", run_long_line},
+#if MICRORL_CFG_USE_COMMANDS
+    {"commands", run_commands},
+#endif /* MICRORL_CFG_USE_COMMANDS */
+#if MICRORL_CFG_USE_ESC_TIMEOUT
+    {"escape", run_escape},
+#endif /* MICRORL_CFG_USE_ESC_TIMEOUT */
+#if MICRORL_CFG_USE_LOG
+    {"log", run_log},
+#endif /* MICRORL_CFG_USE_LOG */
+#if MICRORL_CFG_USE_ASYNC_EXEC
+    {"async", run_async},
+#endif /* MICRORL_CFG_USE_ASYNC_EXEC */
+#if MICRORL_CFG_USE_UTF8
+    {"utf8", run_utf8},
+#endif /* MICRORL_CFG_USE_UTF8 */
+};
+
+/**
+ * \brief           Check cursor row of terminal shows prompt and command line of instance.
+ *                  Every char of line takes one column, UTF-8 char takes one column too.
+ *                  With horizontal scroll terminal must never wrap lines
+ * \return          '1' if screen is correct, '0' otherwise
+ */
+static int check_screen(const microrl_t* mrl) {
+    char expect[VTERM_LINE_LEN];
+    char shown[VTERM_LINE_LEN];
+    int start[VTERM_COLS + 1];                  /* Line position of char shown in column */
+    int width = VTERM_COLS - 1 - MICRORL_CFG_PROMPT_LEN;
+    int pos = 0;
+    int cols = 0;
+    int col = -1;
+    int n;
+
+#if MICRORL_CFG_USE_HSCROLL
+    pos = mrl->view_offset;
+    width = MICRORL_VIEW_WIDTH;
+#endif /* MICRORL_CFG_USE_HSCROLL */
+    while ((pos < mrl->cmdlen) && (cols < width)) {
+        start[cols++] = pos;
+        do {
+            pos++;
+        } while ((pos < mrl->cmdlen) && BENCH_IS_UTF8_CONT(mrl->cmdline[pos]));
+    }
+    start[cols] = pos;
+
+    n = sprintf(expect, "%s", MICRORL_CFG_PROMPT_STRING);
+    for (int c = 0; c <= cols; ++c) {
+        if (start[c] == mrl->cursor) {
+            col = MICRORL_CFG_PROMPT_LEN + c;
+        }
+        if (c == cols) {
+            break;
+        }
+#if MICRORL_CFG_USE_HSCROLL
+        if ((c == 0) && (mrl->view_offset > 0)) {
+            expect[n++] = '<';
+            continue;
+        }
+        if ((c == (width - 1)) && (pos < mrl->cmdlen)) {
+            expect[n++] = '>';
+            continue;
+        }
+#endif /* MICRORL_CFG_USE_HSCROLL */
+        for (int i = start[c]; i < start[c + 1]; ++i) {
+            expect[n++] = (mrl->cmdline[i] == '\0') ? ' ' : mrl->cmdline[i];
+        }
+    }
+    while ((n > 0) && (expect[n - 1] == ' ')) {
+        n--;
+    }
+    expect[n] = '\0';
+    vterm_line(&vt, -1, shown);
+    if (vt.errors != 0) {
+        return 0;
+    }
+#if MICRORL_CFG_USE_HSCROLL
+    if (vt.wraps != 0) {
+        return 0;
+    }
+#endif /* MICRORL_CFG_USE_HSCROLL */
+    return (strcmp(shown, expect) == 0) && (vt.col == col);
+}
+
+/**
+ * \brief           Print enabled configuration switches
+ */
+static void print_config(void) {
+    printf("config %s: CMDLINE_LEN=%d", BENCH_CONFIG, (int)MICRORL_CFG_CMDLINE_LEN);
+#if MICRORL_CFG_USE_HISTORY
+    printf(" RING_HISTORY_LEN=%d", (int)MICRORL_CFG_RING_HISTORY_LEN);
+#endif /* MICRORL_CFG_USE_HISTORY */
+#if MICRORL_CFG_USE_HISTORY_INDEX
+    printf(" HISTORY_INDEX");
+#endif /* MICRORL_CFG_USE_HISTORY_INDEX */
+#if MICRORL_CFG_USE_HISTORY_COMPRESS
+    printf(" HISTORY_COMPRESS");
+#endif /* MICRORL_CFG_USE_HISTORY_COMPRESS */
+#if MICRORL_CFG_USE_HISTORY_PERSIST
+    printf(" HISTORY_PERSIST");
+#endif /* MICRORL_CFG_USE_HISTORY_PERSIST */
+#if MICRORL_CFG_USE_HISTORY_SEARCH
+    printf(" HISTORY_SEARCH");
+#endif /* MICRORL_CFG_USE_HISTORY_SEARCH */
+#if MICRORL_CFG_USE_EXT_BUFFERS
+    printf(" EXT_BUFFERS");
+#endif /* MICRORL_CFG_USE_EXT_BUFFERS */
+#if MICRORL_CFG_USE_OUTPUT_BUFFER
+    printf(" OUTPUT_BUFFER=%d", (int)MICRORL_CFG_OUTPUT_BUFFER_LEN);
+#endif /* MICRORL_CFG_USE_OUTPUT_BUFFER */
+#if MICRORL_CFG_USE_SHADOW_LINE
+    printf(" SHADOW_LINE");
+#endif /* MICRORL_CFG_USE_SHADOW_LINE */
+#if MICRORL_CFG_USE_OUTPUT_BACKPRESSURE
+    printf(" OUTPUT_BACKPRESSURE");
+#endif /* MICRORL_CFG_USE_OUTPUT_BACKPRESSURE */
+#if MICRORL_CFG_USE_HSCROLL
+    printf(" HSCROLL TERMINAL_WIDTH=%d", (int)MICRORL_CFG_TERMINAL_WIDTH);
+#endif /* MICRORL_CFG_USE_HSCROLL */
+#if MICRORL_CFG_USE_PASTE_BURST
+    printf(" PASTE_BURST");
+#endif /* MICRORL_CFG_USE_PASTE_BURST */
+#if MICRORL_CFG_USE_TOKEN_INDEX
+    printf(" TOKEN_INDEX");
+#endif /* MICRORL_CFG_USE_TOKEN_INDEX */
+#if MICRORL_CFG_USE_COMPLETE_CACHE
+    printf(" COMPLETE_CACHE");
+#endif /* MICRORL_CFG_USE_COMPLETE_CACHE */
+#if MICRORL_CFG_USE_COMMANDS
+    printf(" COMMANDS");
+#endif /* MICRORL_CFG_USE_COMMANDS */
+#if MICRORL_CFG_USE_COMMAND_ARGS
+    printf(" COMMAND_ARGS");
+#endif /* MICRORL_CFG_USE_COMMAND_ARGS */
+#if MICRORL_CFG_USE_ESC_TIMEOUT
+    printf(" ESC_TIMEOUT");
+#endif /* MICRORL_CFG_USE_ESC_TIMEOUT */
+#if MICRORL_CFG_USE_LOG
+    printf(" LOG");
+#endif /* MICRORL_CFG_USE_LOG */
+#if MICRORL_CFG_USE_ASYNC_EXEC
+    printf(" ASYNC_EXEC");
+#endif /* MICRORL_CFG_USE_ASYNC_EXEC */
+#if MICRORL_CFG_USE_UTF8
+    printf(" UTF8");
+#endif /* MICRORL_CFG_USE_UTF8 */
+#if VTERM_WRAP
+    printf(" VTERM_COLS=%d VTERM_WRAP", VTERM_COLS);
+#endif /* VTERM_WRAP */
+    printf(" sizeof(microrl_t)=%u\n", (unsigned)sizeof(microrl_t));
+    printf("%-10s %9s %9s %9s %8s %9s %7s %s\n",
+           "workload", "in_bytes", "ns/byte", "cyc/byte", "calls", "out_bytes", "out/in", "screen");
+}
+
+int main(void) {
+    microrl_t mrl;
+    int failed = 0;
+
+#if MICRORL_CFG_USE_COMPLETE
+    for (int i = 0; i < BENCH_COMPL_NUM; ++i) {
+        sprintf(compl_names[i], "ip_addr_%03d", i);
+    }
+    strcpy(compl_names[BENCH_COMPL_NUM], "ping");
+    strcpy(compl_names[BENCH_COMPL_NUM + 1], "ps");
+#endif /* MICRORL_CFG_USE_COMPLETE */
+    timer_init();
+    print_config();
+    for (size_t w = 0; w < (sizeof(workloads) / sizeof(workloads[0])); ++w) {
+        size_t calls, bytes, input;
+        uint64_t ns, cycles, start_ns, start_cycles;
+        size_t runs = 0;
+        int ok;
+
+        // The first run is checked on terminal, counters are the same for every run
+        vterm_init(&vt);
+        capture = 1;
+        out_calls = out_bytes = in_bytes = errors = 0;
+        bench_init(&mrl);
+        workloads[w].run(&mrl);
+        ok = check_screen(&mrl) && (errors == 0);
+        failed |= !ok;
+        calls = out_calls;
+        bytes = out_bytes;
+        input = in_bytes;
+
+        capture = 0;
+        in_bytes = 0;
+        start_ns = bench_ns();
+        start_cycles = bench_cycles();
+        do {
+            bench_init(&mrl);
+            workloads[w].run(&mrl);
+            runs++;
+            ns = bench_ns() - start_ns;
+        } while ((ns < BENCH_MIN_TIME_NS) || (runs < 3));
+        cycles = bench_cycles() - start_cycles;
+
+        printf("%-10s %9u %9.2f ", workloads[w].name, (unsigned)input, (double)ns / (double)in_bytes);
+        if (BENCH_HAS_CYCLES) {
+            printf("%9.2f ", (double)cycles / (double)in_bytes);
+        } else {
+            printf("%9s ", "-");
+        }
+        printf("%8u %9u %7.2f %s\n", (unsigned)calls, (unsigned)bytes,
+               (double)bytes / (double)input, ok ? "OK" : "FAIL");
+    }
+    return failed;
+}
@@ -0,0 +1,239 @@
+/**
+ * \file            vterm.c
+ * \brief           Virtual VT100 terminal capturing output of benchmarked instance
+ */
+
+/*
+ * Portion Copyright (c) 2011 Eugene SAMOYLOV
+ * Portion Copyright (c) 2021 Dmitry KARASEV
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of MicroRL - Micro Read Line library for small and embedded devices.
+ *
+ * Authors:         Eugene SAMOYLOV aka Helius <ghelius@gmail.com>,
+ *                  Dmitry KARASEV <karasevsdmitry@yandex.ru>
+ * Version:         1.7.0
+ */
+
+#include <string.h>
+#include "vterm.h"
+
+/**
+ * \brief           Fill cells of screen row with whitespaces
+ * \param[in,out]   vt: Terminal
+ * \param[in]       row: Screen row
+ * \param[in]       col: The first cleared column
+ */
+static void clear_row(vterm_t* vt, int row, int col) {
+    memset(&vt->screen[row][col], 0, sizeof(vt->screen[0][0]) * (VTERM_COLS - col));
+    for (; col < VTERM_COLS; ++col) {
+        vt->screen[row][col][0] = ' ';
+    }
+}
+
+/**
+ * \brief           Clear screen and reset cursor and counters
+ * \param[out]      vt: Terminal
+ */
+void vterm_init(vterm_t* vt) {
+    memset(vt, 0, sizeof(*vt));
+    for (int row = 0; row < VTERM_ROWS; ++row) {
+        clear_row(vt, row, 0);
+    }
+}
+
+/**
+ * \brief           Move cursor to the next row, scroll screen up at the bottom
+ * \param[in,out]   vt: Terminal
+ */
+static void line_feed(vterm_t* vt) {
+    if (vt->row < (VTERM_ROWS - 1)) {
+        vt->row++;
+        return;
+    }
+    memmove(vt->screen[0], vt->screen[1], sizeof(vt->screen[0]) * (VTERM_ROWS - 1));
+    clear_row(vt, VTERM_ROWS - 1, 0);
+}
+
+/**
+ * \brief           Execute final char of CSI sequence
+ * \param[in,out]   vt: Terminal
+ * \param[in]       ch: Final char
+ */
+static void csi_final(vterm_t* vt, char ch) {
+    int n = vt->has_param ? vt->param : 1;
+
+    vt->wrap_pending = 0;
+    switch (ch) {
+        case 'C':
+            vt->col += n;
+            if (vt->col >= VTERM_COLS) {
+                vt->col = VTERM_COLS - 1;
+            }
+            break;
+        case 'D':
+            vt->col -= n;
+            if (vt->col < 0) {
+                vt->col = 0;
+            }
+            break;
+        case 'A':
+            vt->row -= n;
+            if (vt->row < 0) {
+                vt->row = 0;
+            }
+            break;
+        case 'B':
+            vt->row += n;
+            if (vt->row >= VTERM_ROWS) {
+                vt->row = VTERM_ROWS - 1;
+            }
+            break;
+        case 'G':
+            vt->col = (n > 0) ? (n - 1) : 0;
+            break;
+        case 'K':
+            if (vt->param == 0) {
+                clear_row(vt, vt->row, vt->col);
+            } else {
+                vt->errors++;
+            }
+            break;
+        case 'J':
+            for (int row = 0; row < VTERM_ROWS; ++row) {
+                clear_row(vt, row, 0);
+            }
+            break;
+        case 'H':
+            vt->row = 0;
+            vt->col = 0;
+            break;
+        case 'm':
+            break;
+        default:
+            vt->errors++;
+            break;
+    }
+}
+
+/**
+ * \brief           Put output of instance to terminal
+ * \param[in,out]   vt: Terminal
+ * \param[in]       buf: Output data
+ * \param[in]       len: Length of output data
+ */
+void vterm_feed(vterm_t* vt, const char* buf, size_t len) {
+    vt->bytes += len;
+    for (size_t i = 0; i < len; ++i) {
+        char ch = buf[i];
+
+        if (vt->state == 1) {
+            if (ch == '[') {
+                vt->state = 2;
+                vt->param = 0;
+                vt->has_param = 0;
+            } else {
+                vt->state = 0;
+                vt->errors++;
+            }
+        } else if (vt->state == 2) {
+            if ((ch >= '0') && (ch <= '9')) {
+                vt->param = vt->param * 10 + (ch - '0');
+                vt->has_param = 1;
+            } else {
+                csi_final(vt, ch);
+                vt->state = 0;
+            }
+        } else if (ch == '\033') {
+            vt->state = 1;
+        } else if (ch == '\r') {
+            vt->col = 0;
+            vt->wrap_pending = 0;
+        } else if (ch == '\n') {
+            line_feed(vt);
+            vt->wrap_pending = 0;
+        } else if (ch == '\b') {
+            vt->wrap_pending = 0;
+            if (vt->col > 0) {
+                vt->col--;
+            }
+        } else if ((unsigned char)ch < ' ') {
+            vt->errors++;
+        } else if (((unsigned char)ch & 0xC0) == 0x80) {
+            // continuation byte of UTF-8 char goes to the last printed cell
+            int last = vt->wrap_pending ? vt->col : (vt->col - 1);
+            char* cell = vt->screen[vt->row][(last > 0) ? last : 0];
+            size_t n = strnlen(cell, VTERM_CELL_LEN);
+
+            if ((last < 0) || (n == VTERM_CELL_LEN)) {
+                vt->errors++;
+            } else {
+                cell[n] = ch;
+            }
+        } else {
+#if VTERM_WRAP
+            if (vt->wrap_pending) {
+                vt->wrap_pending = 0;
+                vt->wraps++;
+                vt->col = 0;
+                line_feed(vt);
+            }
+#endif /* VTERM_WRAP */
+            if (vt->col < VTERM_COLS) {
+                memset(vt->screen[vt->row][vt->col], 0, VTERM_CELL_LEN);
+                vt->screen[vt->row][vt->col][0] = ch;
+#if VTERM_WRAP
+                // Cursor stays at the last column until the next char is printed
+                if (vt->col == (VTERM_COLS - 1)) {
+                    vt->wrap_pending = 1;
+                    continue;
+                }
+#endif /* VTERM_WRAP */
+                vt->col++;
+            }
+        }
+    }
+}
+
+/**
+ * \brief           Get screen row without trailing whitespaces
+ * \param[in]       vt: Terminal
+ * \param[in]       row: Screen row, negative value counts up from cursor row, -1 is cursor row
+ * \param[out]      buf: Buffer of \ref VTERM_LINE_LEN bytes for line
+ * \return          Pointer to buf
+ */
+const char* vterm_line(const vterm_t* vt, int row, char* buf) {
+    size_t len = 0;
+    size_t end = 0;
+
+    if (row < 0) {
+        row += vt->row + 1;
+    }
+    if ((row < 0) || (row >= VTERM_ROWS)) {
+        buf[0] = '\0';
+        return buf;
+    }
+    for (int col = 0; col < VTERM_COLS; ++col) {
+        const char* cell = vt->screen[row][col];
+        size_t n = strnlen(cell, VTERM_CELL_LEN);
+
+        memcpy(buf + len, cell, n);
+        len += n;
+        if ((n != 1) || (cell[0] != ' ')) {
+            end = len;
+        }
+    }
+    buf[end] = '\0';
+    return buf;
+}
@@ -0,0 +1,76 @@
+/**
+ * \file            vterm.h
+ * \brief           Virtual VT100 terminal capturing output of benchmarked instance
+ */
+
+/*
+ * Portion Copyright (c) 2011 Eugene SAMOYLOV
+ * Portion Copyright (c) 2021 Dmitry KARASEV
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of MicroRL - Micro Read Line library for small and embedded devices.
+ *
+ * Authors:         Eugene SAMOYLOV aka Helius <ghelius@gmail.com>,
+ *                  Dmitry KARASEV <karasevsdmitry@yandex.ru>
+ * Version:         1.7.0
+ */
+
+#ifndef VTERM_HDR_H
+#define VTERM_HDR_H
+
+#include <stddef.h>
+
+#ifndef VTERM_ROWS
+#define VTERM_ROWS                          32
+#endif
+
+#ifndef VTERM_COLS
+#define VTERM_COLS                          512
+#endif
+
+/* Wrap text to the next row after the last column, like VT100 with autowrap mode.
+   Set VTERM_COLS to terminal width of instance to check that its line never wraps */
+#ifndef VTERM_WRAP
+#define VTERM_WRAP                          0
+#endif
+
+/* Max number of bytes of UTF-8 char in one cell */
+#define VTERM_CELL_LEN                      4
+
+/* Size of buffer for screen row with NULL terminator */
+#define VTERM_LINE_LEN                      (VTERM_COLS * VTERM_CELL_LEN + 1)
+
+/**
+ * \brief           Terminal screen and parser state. Lines are not wrapped by default, columns
+ *                  are wide enough for the longest command line without horizontal scroll.
+ *                  Every cell keeps one UTF-8 char, unused bytes of cell are '\0'
+ */
+typedef struct {
+    char screen[VTERM_ROWS][VTERM_COLS][VTERM_CELL_LEN];    /*!< Screen chars */
+    int row;                                    /*!< Cursor row */
+    int col;                                    /*!< Cursor column */
+    int state;                                  /*!< Parser state: 0 - text, 1 - after ESC, 2 - CSI */
+    int param;                                  /*!< The first CSI parameter */
+    int has_param;                              /*!< The first CSI parameter is given */
+    int wrap_pending;                           /*!< The last column is printed, next char goes to the next row */
+    size_t bytes;                               /*!< Number of bytes received */
+    size_t errors;                              /*!< Number of unsupported sequences or chars */
+    size_t wraps;                               /*!< Number of lines wrapped with \ref VTERM_WRAP */
+} vterm_t;
+
+void        vterm_init(vterm_t* vt);
+void        vterm_feed(vterm_t* vt, const char* buf, size_t len);
+const char* vterm_line(const vterm_t* vt, int row, char* buf);
+
+#endif /* VTERM_HDR_H */
@@ -93,6 +93,14 @@ char get_char(void) {
     return UDR;
 }
 
+/**
+ * \brief           Wait for char and pass it to MicroRL library
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ */
+void input_poll(microrl_t* mrl) {
+    microrl_insert_char(mrl, get_char());
+}
+
 /**
  * \brief           HELP command callback
  * \param[in]       mrl: \ref microrl_t working instance
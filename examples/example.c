@@ -57,8 +57,8 @@ int main (void/*int argc, char** argv*/) {
 #endif /* MICRORL_CFG_USE_CTRL_C */
 
     while (1) {
-        // put received char from stdin to microrl lib
-        microrl_insert_char(prl, get_char());
+        // put received chars to microrl lib
+        input_poll(prl);
     }
     return 0;
 }
@@ -34,7 +34,7 @@ extern "C" {
 
 void init(void);
 void print(microrl_t* mrl, const char* str);
-char get_char(void);
+void input_poll(microrl_t* mrl);
 int execute(microrl_t* mrl, int argc, const char* const *argv);
 char ** complet(microrl_t* mrl, int argc, const char* const *argv);
 void sigint(microrl_t* mrl);
@@ -0,0 +1,397 @@
+/**
+ * \file            telnet_load.c
+ * \brief           Load generator for telnet server example. Many sessions type commands
+ *                  key by key and keystroke-to-echo latency is measured
+ */
+
+/*
+ * Portion Copyright (c) 2011 Eugene SAMOYLOV
+ * Portion Copyright (c) 2021 Dmitry KARASEV
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of MicroRL - Micro Read Line library for small and embedded devices.
+ *
+ * Authors:         Eugene SAMOYLOV aka Helius <ghelius@gmail.com>,
+ *                  Dmitry KARASEV <karasevsdmitry@yandex.ru>
+ * Version:         1.7.0
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include "microrl_config.h"
+
+#define LOAD_MAX_EVENTS         256             /*!< Number of events handled per epoll_wait call */
+#define LOAD_HIST_LEN           100000          /*!< Latency histogram size, 1 us per bucket */
+#define LOAD_TELNET_IAC         255             /*!< Telnet command prefix */
+#define LOAD_TELNET_SE          240             /*!< Telnet subnegotiation end */
+#define LOAD_TELNET_SB          250             /*!< Telnet subnegotiation start */
+#define LOAD_TELNET_WILL        251             /*!< The first option negotiation command */
+
+/* Line typed by each session, key by key */
+static const char script[] = "echo microrl load test\r";
+static const char prompt[] = MICRORL_CFG_PROMPT_STRING;
+
+/**
+ * \brief           Session states
+ */
+typedef enum {
+    SESSION_GREETING = 0x00,                    /*!< Waiting for banner and prompt */
+    SESSION_THINK,                              /*!< Waiting before the next key */
+    SESSION_ECHO,                               /*!< Key is sent, waiting for echo */
+    SESSION_PROMPT                              /*!< Enter is sent, waiting for prompt */
+} session_state_t;
+
+/**
+ * \brief           Client session
+ */
+typedef struct {
+    uint64_t sent;                              /*!< Time the last key is sent */
+    uint64_t next;                              /*!< Time to send the next key */
+    int fd;                                     /*!< Socket descriptor */
+    session_state_t state;                      /*!< Member of \ref session_state_t enumeration */
+    size_t key;                                 /*!< Position of the next key in script */
+    size_t matched;                             /*!< Number of prompt chars matched in output */
+    int telnet;                                 /*!< Number of telnet command bytes to skip, -1 in subnegotiation */
+} session_t;
+
+/**
+ * \brief           Latency histogram
+ */
+typedef struct {
+    uint32_t bucket[LOAD_HIST_LEN + 1];         /*!< Number of samples per microsecond, last is overflow */
+    uint64_t count;                             /*!< Number of samples */
+    uint64_t max;                               /*!< Maximum sample */
+} latency_t;
+
+static latency_t key_lat, line_lat;
+
+/**
+ * \brief           Get monotonic time
+ * \return          Time in microseconds
+ */
+static uint64_t now_us(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+/**
+ * \brief           Add sample to latency histogram
+ * \param[in,out]   lat: Latency histogram
+ * \param[in]       us: Sample in microseconds
+ */
+static void latency_add(latency_t* lat, uint64_t us) {
+    lat->bucket[(us < LOAD_HIST_LEN) ? us : LOAD_HIST_LEN]++;
+    lat->count++;
+    if (us > lat->max) {
+        lat->max = us;
+    }
+}
+
+/**
+ * \brief           Get percentile of latency samples
+ * \param[in]       lat: Latency histogram
+ * \param[in]       pct: Percentile, 0..100
+ * \return          Latency in microseconds
+ */
+static uint64_t latency_pct(const latency_t* lat, double pct) {
+    uint64_t need = (uint64_t)(lat->count * pct / 100.0);
+    uint64_t sum = 0;
+
+    for (size_t i = 0; i < LOAD_HIST_LEN; i++) {
+        sum += lat->bucket[i];
+        if (sum > need) {
+            return i;
+        }
+    }
+    return lat->max;
+}
+
+/**
+ * \brief           Skip telnet commands in received byte
+ * \param[in,out]   s: Session
+ * \param[in]       ch: Received byte
+ * \return          '1' if byte is data, '0' if it is part of telnet command
+ */
+static int telnet_data(session_t* s, unsigned char ch) {
+    if (s->telnet < 0) {
+        // subnegotiation, IAC SE ends it
+        if (ch == LOAD_TELNET_SE) {
+            s->telnet = 0;
+        }
+        return 0;
+    }
+    if (s->telnet > 0) {
+        if ((s->telnet == 2) && (ch == LOAD_TELNET_SB)) {
+            s->telnet = -1;
+        } else {
+            s->telnet = ((s->telnet == 2) && (ch >= LOAD_TELNET_WILL) && (ch != LOAD_TELNET_IAC)) ? 1 : 0;
+        }
+        return 0;
+    }
+    if (ch == LOAD_TELNET_IAC) {
+        s->telnet = 2;
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * \brief           Check received data for prompt
+ * \param[in,out]   s: Session
+ * \param[in]       ch: Received data byte
+ * \return          '1' if the last prompt char is received
+ */
+static int prompt_match(session_t* s, char ch) {
+    if (ch != prompt[s->matched]) {
+        s->matched = (ch == prompt[0]) ? 1 : 0;
+    } else if (++s->matched == (sizeof(prompt) - 1)) {
+        s->matched = 0;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * \brief           Open connection to server
+ * \param[in]       addr: Server address
+ * \param[in]       nonblock: Make socket non-blocking
+ * \return          Socket descriptor, '-1' on error
+ */
+static int session_connect(const struct sockaddr_in* addr, int nonblock) {
+    int one = 1;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    if (fd < 0) {
+        return -1;
+    }
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(fd, (const struct sockaddr*)addr, sizeof(*addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    if (nonblock) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+    return fd;
+}
+
+/**
+ * \brief           Send the next key of script
+ * \param[in,out]   s: Session
+ */
+static void session_send(session_t* s) {
+    char ch = script[s->key];
+
+    s->key = (s->key + 1) % (sizeof(script) - 1);
+    s->state = (ch == '\r') ? SESSION_PROMPT : SESSION_ECHO;
+    s->sent = now_us();
+    if (send(s->fd, &ch, 1, MSG_NOSIGNAL) != 1) {
+        perror("send");
+        exit(1);
+    }
+}
+
+/**
+ * \brief           Get server statistics with separate control session
+ * \param[in]       addr: Server address
+ * \param[out]      session_bytes: Memory used by one session on server
+ * \param[out]      microrl_bytes: Size of \ref microrl_t on server
+ * \return          Server CPU time in microseconds, '0' on error
+ */
+static uint64_t server_stats(const struct sockaddr_in* addr, size_t* session_bytes, size_t* microrl_bytes) {
+    session_t s;
+    char out[1024];
+    size_t len = 0, done = 0;
+    unsigned long long cpu_us = 0;
+    const char* line;
+
+    memset(&s, 0, sizeof(s));
+    s.fd = session_connect(addr, 0);
+    if (s.fd < 0) {
+        return 0;
+    }
+    // the 2nd prompt follows stats output
+    if (send(s.fd, "stats\r", 6, MSG_NOSIGNAL) == 6) {
+        while ((done < 2) && (len < (sizeof(out) - 1))) {
+            char buf[256];
+            ssize_t n = recv(s.fd, buf, sizeof(buf), 0);
+
+            if (n <= 0) {
+                break;
+            }
+            for (ssize_t i = 0; (i < n) && (len < (sizeof(out) - 1)); i++) {
+                if (telnet_data(&s, (unsigned char)buf[i])) {
+                    out[len++] = buf[i];
+                    done += prompt_match(&s, buf[i]);
+                }
+            }
+        }
+    }
+    close(s.fd);
+    out[len] = '\0';
+    line = strstr(out, "stats:");
+    if ((line == NULL) || (sscanf(line, "stats: sessions=%*u session_bytes=%zu microrl_bytes=%zu cpu_us=%llu",
+                                  session_bytes, microrl_bytes, &cpu_us) != 3)) {
+        return 0;
+    }
+    return cpu_us;
+}
+
+/**
+ * \brief           Program entry point
+ * \param[in]       argc: argument count
+ * \param[in]       argv: pointer array to arguments
+ * \return          Exit code
+ */
+int main(int argc, char** argv) {
+    struct epoll_event events[LOAD_MAX_EVENTS];
+    struct sockaddr_in addr;
+    const char* host = "127.0.0.1";
+    int port = 2323, num = 100, duration = 10, think = 0;
+    size_t session_bytes = 0, microrl_bytes = 0;
+    uint64_t cpu_start, cpu_end, start = 0, end, keys = 0;
+    size_t ready = 0;
+    session_t* sessions;
+    int opt, epfd;
+
+    while ((opt = getopt(argc, argv, "h:p:n:d:t:")) != -1) {
+        switch (opt) {
+            case 'h': host = optarg; break;
+            case 'p': port = atoi(optarg); break;
+            case 'n': num = atoi(optarg); break;
+            case 'd': duration = atoi(optarg); break;
+            case 't': think = atoi(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-h host] [-p port] [-n sessions] [-d seconds] [-t think_ms]\n", argv[0]);
+                return 1;
+        }
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if ((num <= 0) || (inet_pton(AF_INET, host, &addr.sin_addr) != 1)) {
+        fprintf(stderr, "bad address or number of sessions\n");
+        return 1;
+    }
+
+    sessions = calloc((size_t)num, sizeof(session_t));
+    epfd = epoll_create1(0);
+    for (int i = 0; i < num; i++) {
+        struct epoll_event ev;
+
+        sessions[i].fd = session_connect(&addr, 1);
+        if (sessions[i].fd < 0) {
+            perror("connect");
+            return 1;
+        }
+        ev.events = EPOLLIN;
+        ev.data.ptr = &sessions[i];
+        epoll_ctl(epfd, EPOLL_CTL_ADD, sessions[i].fd, &ev);
+    }
+
+    cpu_start = server_stats(&addr, &session_bytes, &microrl_bytes);
+    while (1) {
+        uint64_t now = now_us();
+        int n;
+
+        if ((ready == (size_t)num) && (start == 0)) {
+            start = now;
+        }
+        if ((start != 0) && ((now - start) >= (uint64_t)duration * 1000000u)) {
+            break;
+        }
+        // sessions waiting before the next key are polled each millisecond
+        if (think > 0) {
+            for (int i = 0; i < num; i++) {
+                if ((sessions[i].state == SESSION_THINK) && (now >= sessions[i].next)) {
+                    session_send(&sessions[i]);
+                }
+            }
+        }
+        n = epoll_wait(epfd, events, LOAD_MAX_EVENTS, (think > 0) ? 1 : 100);
+        for (int i = 0; i < n; i++) {
+            session_t* s = events[i].data.ptr;
+            char buf[1024];
+            ssize_t len;
+            int got = 0, prompted = 0;
+
+            while ((len = recv(s->fd, buf, sizeof(buf), 0)) > 0) {
+                for (ssize_t j = 0; j < len; j++) {
+                    if (telnet_data(s, (unsigned char)buf[j])) {
+                        got = 1;
+                        prompted |= prompt_match(s, buf[j]);
+#if !MICRORL_CFG_ENABLE_INIT_PROMPT
+                        // no prompt on connect, banner line is the last greeting output
+                        prompted |= (s->state == SESSION_GREETING) && (buf[j] == '\n');
+#endif /* !MICRORL_CFG_ENABLE_INIT_PROMPT */
+                    }
+                }
+            }
+            if ((len == 0) || ((len < 0) && (errno != EAGAIN))) {
+                fprintf(stderr, "session closed by server\n");
+                return 1;
+            }
+            now = now_us();
+            if ((s->state == SESSION_GREETING) && prompted) {
+                ready++;
+            } else if ((s->state == SESSION_ECHO) && got) {
+                latency_add(&key_lat, now - s->sent);
+                keys += (start != 0);
+            } else if ((s->state == SESSION_PROMPT) && prompted) {
+                latency_add(&line_lat, now - s->sent);
+                keys += (start != 0);
+            } else {
+                continue;
+            }
+            if (think > 0) {
+                s->state = SESSION_THINK;
+                s->next = now + (uint64_t)think * 1000u;
+            } else {
+                session_send(s);
+            }
+        }
+    }
+    end = now_us();
+    cpu_end = server_stats(&addr, &session_bytes, &microrl_bytes);
+
+    printf("sessions:            %d\n", num);
+    printf("keystrokes:          %llu (%.0f/s)\n", (unsigned long long)keys, keys * 1e6 / (double)(end - start));
+    printf("key echo latency:    p50 %llu us, p99 %llu us, max %llu us\n",
+           (unsigned long long)latency_pct(&key_lat, 50), (unsigned long long)latency_pct(&key_lat, 99),
+           (unsigned long long)key_lat.max);
+    printf("enter-to-prompt:     p50 %llu us, p99 %llu us, max %llu us\n",
+           (unsigned long long)latency_pct(&line_lat, 50), (unsigned long long)latency_pct(&line_lat, 99),
+           (unsigned long long)line_lat.max);
+    if ((cpu_start != 0) && (cpu_end > cpu_start)) {
+        double load = (double)(cpu_end - cpu_start) / (double)(end - start);
+
+        printf("server cpu:          %.1f%% of one core\n", load * 100.0);
+        printf("sessions per core:   %.0f at this key rate\n", num / load);
+    }
+    printf("RAM per session:     %zu bytes (microrl_t %zu bytes)\n", session_bytes, microrl_bytes);
+    return 0;
+}
@@ -0,0 +1,708 @@
+/**
+ * \file            telnet_server.c
+ * \brief           Non-blocking multi-session telnet server, one MicroRL instance per connection.
+ *                  Sessions are sharded over worker threads with own event loop each
+ */
+
+/*
+ * Portion Copyright (c) 2011 Eugene SAMOYLOV
+ * Portion Copyright (c) 2021 Dmitry KARASEV
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of MicroRL - Micro Read Line library for small and embedded devices.
+ *
+ * Authors:         Eugene SAMOYLOV aka Helius <ghelius@gmail.com>,
+ *                  Dmitry KARASEV <karasevsdmitry@yandex.ru>
+ * Version:         1.7.0
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include "microrl.h"
+
+#define SERVER_PORT             2323            /*!< Default TCP port */
+#define SERVER_MAX_WORKERS      64              /*!< Maximum number of worker threads */
+#define SERVER_MAX_EVENTS       64              /*!< Number of events handled per epoll_wait call */
+#define SERVER_RX_LEN           512             /*!< Size of socket read buffer */
+#define SERVER_TX_LEN           2048            /*!< Size of per-connection output buffer */
+#define SERVER_JOB_OUT_LEN      128             /*!< Size of output buffer of pool job */
+
+/* Telnet protocol codes, RFC 854 */
+#define TELNET_SE               240
+#define TELNET_SB               250
+#define TELNET_WILL             251
+#define TELNET_WONT             252
+#define TELNET_DO               253
+#define TELNET_DONT             254
+#define TELNET_IAC              255
+#define TELNET_OPT_ECHO         1
+#define TELNET_OPT_SGA          3
+#define TELNET_OPT_LINEMODE     34
+
+/**
+ * \brief           Telnet input parser states
+ */
+typedef enum {
+    TELNET_STATE_DATA = 0x00,                   /*!< Plain data */
+    TELNET_STATE_CR,                            /*!< CR is received, NUL or LF after it is skipped */
+    TELNET_STATE_IAC,                           /*!< IAC is received, command follows */
+    TELNET_STATE_OPT,                           /*!< Option negotiation command is received, option code follows */
+    TELNET_STATE_SB,                            /*!< Inside subnegotiation, skipped until IAC SE */
+    TELNET_STATE_SB_IAC                         /*!< IAC is received inside subnegotiation */
+} telnet_state_t;
+
+struct conn;
+
+/**
+ * \brief           Worker thread, owns its connections and their MicroRL instances
+ */
+typedef struct worker {
+    pthread_t thread;                           /*!< Worker thread */
+    int epfd;                                   /*!< Event loop of worker */
+    int pipe_fd[2];                             /*!< Messages to worker: new connections and finished jobs */
+    size_t sessions;                            /*!< Number of connections, read by acceptor */
+} worker_t;
+
+/**
+ * \brief           Command handed to pool, its output is printed by worker of connection
+ */
+typedef struct job {
+    struct job* next;                           /*!< Next job in pool queue */
+    struct conn* conn;                          /*!< Connection job is started by */
+    unsigned ms;                                /*!< Job duration */
+    size_t len;                                 /*!< Output length */
+    char out[SERVER_JOB_OUT_LEN];               /*!< Job output */
+} job_t;
+
+/**
+ * \brief           Message passed to worker through its pipe
+ */
+typedef struct {
+    int fd;                                     /*!< Accepted socket, '-1' if not used */
+    job_t* job;                                 /*!< Finished job, NULL if not used */
+} worker_msg_t;
+
+/**
+ * \brief           Client connection
+ */
+typedef struct conn {
+    microrl_t mrl;                              /*!< Shell instance of connection */
+#if MICRORL_CFG_USE_EXT_BUFFERS
+    char cmdline[MICRORL_CFG_CMDLINE_LEN];      /*!< Command line buffer */
+#if MICRORL_CFG_USE_HISTORY
+    char history[MICRORL_CFG_RING_HISTORY_LEN]; /*!< History ring buffer */
+#endif /* MICRORL_CFG_USE_HISTORY */
+#endif /* MICRORL_CFG_USE_EXT_BUFFERS */
+    worker_t* worker;                           /*!< Worker connection belongs to */
+    job_t* job;                                 /*!< Pending pool job, NULL if none */
+    char* rx_rest;                              /*!< Input received after command handed to pool */
+    size_t rx_len;                              /*!< Length of input waiting for job end */
+    size_t tx_len;                              /*!< Number of pending output bytes */
+    size_t tx_hold;                             /*!< Output after this position waits for job end */
+    int fd;                                     /*!< Socket descriptor, '-1' if closed while job is pending */
+    uint32_t events;                            /*!< Events socket is registered for */
+    telnet_state_t telnet;                      /*!< Member of \ref telnet_state_t enumeration */
+    char closing;                               /*!< Connection is closed after output is sent */
+    char tx_buf[SERVER_TX_LEN];                 /*!< Output buffer */
+} conn_t;
+
+static worker_t workers[SERVER_MAX_WORKERS];
+static size_t workers_num;
+static size_t sessions;
+static size_t tx_dropped;
+
+/* Pool of threads running long commands */
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_cond = PTHREAD_COND_INITIALIZER;
+static job_t* pool_head;
+static job_t* pool_tail;
+
+/* Connection being initialized by this thread, init clears userdata of its instance */
+static __thread conn_t* conn_pending;
+
+/**
+ * \brief           Register socket for events connection waits for now
+ * \param[in,out]   c: Connection
+ */
+static void conn_events(conn_t* c) {
+    size_t limit = (c->job != NULL) ? c->tx_hold : c->tx_len;
+    // input is read only when previous command is done
+    uint32_t events = ((c->job == NULL) ? EPOLLIN : 0) | ((limit > 0) ? EPOLLOUT : 0);
+
+    if (events != c->events) {
+        struct epoll_event ev;
+
+        c->events = events;
+        ev.events = events;
+        ev.data.ptr = c;
+        epoll_ctl(c->worker->epfd, EPOLL_CTL_MOD, c->fd, &ev);
+    }
+}
+
+/**
+ * \brief           Send pending output of connection. Output printed after command
+ *                  is handed to pool is held until the command is done
+ * \param[in,out]   c: Connection
+ * \return          '0' on success or if socket is not writable now, '-1' on error
+ */
+static int conn_flush(conn_t* c) {
+    size_t limit = (c->job != NULL) ? c->tx_hold : c->tx_len;
+    size_t pos = 0;
+
+    while (pos < limit) {
+        ssize_t n = send(c->fd, c->tx_buf + pos, limit - pos, MSG_NOSIGNAL);
+
+        if (n < 0) {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+                break;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        pos += (size_t)n;
+    }
+    memmove(c->tx_buf, c->tx_buf + pos, c->tx_len - pos);
+    c->tx_len -= pos;
+    if (c->job != NULL) {
+        c->tx_hold -= pos;
+    }
+    conn_events(c);
+    return 0;
+}
+
+/**
+ * \brief           Append data to connection output buffer
+ *
+ * Data is sent when buffer is full or input is processed. Data is dropped
+ * if client does not read it and buffer stays full
+ *
+ * \param[in,out]   c: Connection
+ * \param[in]       data: Data to send
+ * \param[in]       len: Data length
+ */
+static void conn_write(conn_t* c, const char* data, size_t len) {
+    while (len > 0) {
+        size_t part;
+
+        if ((c->tx_len == SERVER_TX_LEN) && ((conn_flush(c) != 0) || (c->tx_len == SERVER_TX_LEN))) {
+            __atomic_fetch_add(&tx_dropped, len, __ATOMIC_RELAXED);
+            return;
+        }
+        part = SERVER_TX_LEN - c->tx_len;
+        if (part > len) {
+            part = len;
+        }
+        memcpy(c->tx_buf + c->tx_len, data, part);
+        c->tx_len += part;
+        data += part;
+        len -= part;
+    }
+}
+
+/**
+ * \brief           Print callback for MicroRL library, output goes to the connection
+ *                  instance belongs to
+ * \param[in]       mrl: \ref microrl_t working instance
+ * \param[in]       str: Output string
+ */
+static void print(microrl_t* mrl, const char* str) {
+    conn_write((mrl->userdata != NULL) ? mrl->userdata : conn_pending, str, strlen(str));
+}
+
+#if MICRORL_CFG_USE_OUTPUT_BUFFER
+/**
+ * \brief           Buffer output callback for MicroRL library
+ * \param[in]       mrl: \ref microrl_t working instance
+ * \param[in]       buf: Data to write, not NULL-terminated
+ * \param[in]       len: Number of bytes to write
+ */
+static void write_buf(microrl_t* mrl, const char* buf, size_t len) {
+    conn_write(mrl->userdata, buf, len);
+}
+#endif /* MICRORL_CFG_USE_OUTPUT_BUFFER */
+
+/**
+ * \brief           Pool thread, runs jobs and passes them back to worker of their connection
+ * \param[in]       arg: Not used
+ * \return          Not used
+ */
+static void* pool_thread(void* arg) {
+    (void)arg;
+    while (1) {
+        worker_msg_t msg = {-1, NULL};
+        job_t* job;
+
+        pthread_mutex_lock(&pool_lock);
+        while (pool_head == NULL) {
+            pthread_cond_wait(&pool_cond, &pool_lock);
+        }
+        job = pool_head;
+        pool_head = job->next;
+        if (pool_head == NULL) {
+            pool_tail = NULL;
+        }
+        pthread_mutex_unlock(&pool_lock);
+
+        // blocking work is done here, connection is not touched by pool
+        usleep(job->ms * 1000u);
+        job->len = (size_t)snprintf(job->out, sizeof(job->out), "slept %u ms" MICRORL_CFG_END_LINE, job->ms);
+
+        msg.job = job;
+        if (write(job->conn->worker->pipe_fd[1], &msg, sizeof(msg)) != sizeof(msg)) {
+            perror("pipe");
+            exit(1);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * \brief           Hand command to pool. Worker keeps reading other connections, while
+ *                  this one does not get input until the command is done
+ * \param[in,out]   c: Connection
+ * \param[in]       ms: Job duration
+ */
+static void pool_start(conn_t* c, unsigned ms) {
+    job_t* job = calloc(1, sizeof(job_t));
+
+    if (job == NULL) {
+        print(&c->mrl, "out of memory" MICRORL_CFG_END_LINE);
+        return;
+    }
+    job->conn = c;
+    job->ms = ms;
+    c->job = job;
+    // prompt printed after execute callback returns is held behind job output
+    c->tx_hold = c->tx_len;
+
+    pthread_mutex_lock(&pool_lock);
+    if (pool_tail != NULL) {
+        pool_tail->next = job;
+    } else {
+        pool_head = job;
+    }
+    pool_tail = job;
+    pthread_cond_signal(&pool_cond);
+    pthread_mutex_unlock(&pool_lock);
+}
+
+/**
+ * \brief           Execute callback for MicroRL library
+ * \param[in]       mrl: \ref microrl_t working instance
+ * \param[in]       argc: argument count
+ * \param[in]       argv: pointer array to token string
+ * \return          '0' on success, '1' otherwise
+ */
+static int execute(microrl_t* mrl, int argc, const char* const *argv) {
+    conn_t* c = mrl->userdata;
+    char line[160];
+
+    if (argc == 0) {
+        return 0;
+    }
+    if (strcmp(argv[0], "help") == 0) {
+        print(mrl, "help  - this message" MICRORL_CFG_END_LINE);
+        print(mrl, "echo  - print arguments" MICRORL_CFG_END_LINE);
+        print(mrl, "sleep - run command of given milliseconds in pool" MICRORL_CFG_END_LINE);
+        print(mrl, "stats - print server statistics" MICRORL_CFG_END_LINE);
+        print(mrl, "quit  - close connection" MICRORL_CFG_END_LINE);
+    } else if (strcmp(argv[0], "echo") == 0) {
+        for (int i = 1; i < argc; i++) {
+            print(mrl, argv[i]);
+            print(mrl, (i + 1 < argc) ? " " : "");
+        }
+        print(mrl, MICRORL_CFG_END_LINE);
+    } else if (strcmp(argv[0], "sleep") == 0) {
+        pool_start(c, (argc > 1) ? (unsigned)atoi(argv[1]) : 1000u);
+    } else if (strcmp(argv[0], "stats") == 0) {
+        // one line format is parsed by telnet_load
+        struct rusage ru;
+
+        getrusage(RUSAGE_SELF, &ru);
+        snprintf(line, sizeof(line), "stats: sessions=%zu session_bytes=%zu microrl_bytes=%zu cpu_us=%llu dropped=%zu"
+                 " workers=%zu worker_sessions=%zu" MICRORL_CFG_END_LINE,
+                 __atomic_load_n(&sessions, __ATOMIC_RELAXED), sizeof(conn_t), sizeof(microrl_t),
+                 (unsigned long long)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000ULL
+                     + (unsigned long long)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec),
+                 __atomic_load_n(&tx_dropped, __ATOMIC_RELAXED), workers_num,
+                 __atomic_load_n(&c->worker->sessions, __ATOMIC_RELAXED));
+        print(mrl, line);
+    } else if (strcmp(argv[0], "quit") == 0) {
+        c->closing = 1;
+    } else {
+        print(mrl, "command not found, type 'help'" MICRORL_CFG_END_LINE);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * \brief           Pass input to MicroRL line by line, input after the line handed to
+ *                  pool is kept until the job is done
+ * \param[in,out]   c: Connection
+ * \param[in]       data: Input without telnet commands
+ * \param[in]       len: Input length
+ */
+static void conn_input(conn_t* c, const char* data, size_t len) {
+    while ((len > 0) && (c->job == NULL)) {
+        size_t n = 0;
+
+        while ((n < len) && (data[n] != '\r') && (data[n] != '\n')) {
+            n++;
+        }
+        n += (n < len);
+        microrl_process_input(&c->mrl, data, n);
+        data += n;
+        len -= n;
+    }
+    if ((len > 0) && ((c->rx_rest = malloc(len)) != NULL)) {
+        memcpy(c->rx_rest, data, len);
+        c->rx_len = len;
+    }
+}
+
+/**
+ * \brief           Remove telnet commands from received data and pass the rest to MicroRL
+ *
+ * Option requests are not answered, server announces its options once on connect
+ *
+ * \param[in,out]   c: Connection
+ * \param[in]       buf: Received data
+ * \param[in]       len: Received data length
+ */
+static void telnet_input(conn_t* c, const char* buf, size_t len) {
+    char data[SERVER_RX_LEN];
+    size_t n = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        unsigned char ch = (unsigned char)buf[i];
+
+        switch (c->telnet) {
+            case TELNET_STATE_CR:
+                c->telnet = TELNET_STATE_DATA;
+                if ((ch == '\0') || (ch == '\n')) {
+                    break;
+                }
+                /* fall through */
+            case TELNET_STATE_DATA:
+                if (ch == TELNET_IAC) {
+                    c->telnet = TELNET_STATE_IAC;
+                } else {
+                    data[n++] = (char)ch;
+                    if (ch == '\r') {
+                        c->telnet = TELNET_STATE_CR;
+                    }
+                }
+                break;
+            case TELNET_STATE_IAC:
+                if (ch == TELNET_IAC) {
+                    data[n++] = (char)ch;
+                    c->telnet = TELNET_STATE_DATA;
+                } else if ((ch >= TELNET_WILL) && (ch <= TELNET_DONT)) {
+                    c->telnet = TELNET_STATE_OPT;
+                } else if (ch == TELNET_SB) {
+                    c->telnet = TELNET_STATE_SB;
+                } else {
+                    c->telnet = TELNET_STATE_DATA;
+                }
+                break;
+            case TELNET_STATE_OPT:
+                c->telnet = TELNET_STATE_DATA;
+                break;
+            case TELNET_STATE_SB:
+                if (ch == TELNET_IAC) {
+                    c->telnet = TELNET_STATE_SB_IAC;
+                }
+                break;
+            case TELNET_STATE_SB_IAC:
+                c->telnet = (ch == TELNET_SE) ? TELNET_STATE_DATA : TELNET_STATE_SB;
+                break;
+        }
+    }
+    conn_input(c, data, n);
+}
+
+/**
+ * \brief           Close connection. Memory is freed when pending job is done
+ * \param[in]       c: Connection
+ */
+static void conn_close(conn_t* c) {
+    if (c->fd < 0) {
+        return;
+    }
+    epoll_ctl(c->worker->epfd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    c->fd = -1;
+    __atomic_fetch_sub(&c->worker->sessions, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_sub(&sessions, 1, __ATOMIC_RELAXED);
+    if (c->job == NULL) {
+        free(c->rx_rest);
+        free(c);
+    }
+}
+
+/**
+ * \brief           Print output of finished job before held output and resume input
+ * \param[in,out]   job: Finished job
+ */
+static void job_done(job_t* job) {
+    conn_t* c = job->conn;
+    size_t len = job->len;
+
+    c->job = NULL;
+    if (c->fd < 0) {
+        // connection is closed while job was running
+        free(c->rx_rest);
+        free(c);
+        free(job);
+        return;
+    }
+    if (len > (SERVER_TX_LEN - c->tx_len)) {
+        len = SERVER_TX_LEN - c->tx_len;
+    }
+    memmove(c->tx_buf + c->tx_hold + len, c->tx_buf + c->tx_hold, c->tx_len - c->tx_hold);
+    memcpy(c->tx_buf + c->tx_hold, job->out, len);
+    c->tx_len += len;
+    free(job);
+
+    if (c->rx_rest != NULL) {
+        char* rest = c->rx_rest;
+
+        c->rx_rest = NULL;
+        conn_input(c, rest, c->rx_len);
+        free(rest);
+    }
+    if ((conn_flush(c) != 0) || (c->closing && (c->tx_len == 0))) {
+        conn_close(c);
+    }
+}
+
+/**
+ * \brief           Start shell for accepted connection in worker thread, instance is
+ *                  used by this thread only
+ * \param[in,out]   w: Worker
+ * \param[in]       fd: Accepted socket
+ */
+static void conn_open(worker_t* w, int fd) {
+    static const char options[] = {
+        (char)TELNET_IAC, (char)TELNET_WILL, TELNET_OPT_ECHO,
+        (char)TELNET_IAC, (char)TELNET_WILL, TELNET_OPT_SGA,
+        (char)TELNET_IAC, (char)TELNET_DONT, TELNET_OPT_LINEMODE,
+    };
+    static const char banner[] = "MicroRL telnet server, type 'help'" MICRORL_CFG_END_LINE;
+    struct epoll_event ev;
+    conn_t* c = calloc(1, sizeof(conn_t));
+
+    if (c == NULL) {
+        close(fd);
+        __atomic_fetch_sub(&w->sessions, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    c->fd = fd;
+    c->worker = w;
+    c->events = EPOLLIN;
+    ev.events = EPOLLIN;
+    ev.data.ptr = c;
+    if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        close(fd);
+        free(c);
+        __atomic_fetch_sub(&w->sessions, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    __atomic_fetch_add(&sessions, 1, __ATOMIC_RELAXED);
+
+    conn_write(c, options, sizeof(options));
+    conn_write(c, banner, sizeof(banner) - 1);
+    conn_pending = c;
+#if MICRORL_CFG_USE_EXT_BUFFERS
+#if MICRORL_CFG_USE_HISTORY
+    microrl_init_ex(&c->mrl, print, c->cmdline, sizeof(c->cmdline), c->history, sizeof(c->history));
+#else
+    microrl_init_ex(&c->mrl, print, c->cmdline, sizeof(c->cmdline), NULL, 0);
+#endif /* MICRORL_CFG_USE_HISTORY */
+#else
+    microrl_init(&c->mrl, print);
+#endif /* MICRORL_CFG_USE_EXT_BUFFERS */
+    c->mrl.userdata = c;
+    conn_pending = NULL;
+#if MICRORL_CFG_USE_OUTPUT_BUFFER
+    microrl_set_write_callback(&c->mrl, write_buf);
+#endif /* MICRORL_CFG_USE_OUTPUT_BUFFER */
+    microrl_set_execute_callback(&c->mrl, execute);
+    if (conn_flush(c) != 0) {
+        conn_close(c);
+    }
+}
+
+/**
+ * \brief           Worker thread, event loop of its connections
+ * \param[in]       arg: Worker
+ * \return          Not used
+ */
+static void* worker_thread(void* arg) {
+    worker_t* w = arg;
+    struct epoll_event events[SERVER_MAX_EVENTS];
+
+    while (1) {
+        int num = epoll_wait(w->epfd, events, SERVER_MAX_EVENTS, -1);
+
+        for (int i = 0; i < num; i++) {
+            conn_t* c = events[i].data.ptr;
+
+            if (c == NULL) {
+                worker_msg_t msg;
+
+                if (read(w->pipe_fd[0], &msg, sizeof(msg)) == sizeof(msg)) {
+                    if (msg.job != NULL) {
+                        job_done(msg.job);
+                    } else {
+                        conn_open(w, msg.fd);
+                    }
+                }
+                continue;
+            }
+            if (c->fd < 0) {
+                // closed by other event of this batch
+                continue;
+            }
+            if (events[i].events & EPOLLIN) {
+                char buf[SERVER_RX_LEN];
+                ssize_t len = recv(c->fd, buf, sizeof(buf), 0);
+
+                if ((len == 0) || ((len < 0) && (errno != EAGAIN) && (errno != EINTR))) {
+                    conn_close(c);
+                    continue;
+                }
+                if (len > 0) {
+                    telnet_input(c, buf, (size_t)len);
+                }
+            }
+            if ((conn_flush(c) != 0) || (c->closing && (c->tx_len == 0))
+                || (events[i].events & (EPOLLERR | EPOLLHUP))) {
+                conn_close(c);
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * \brief           Program entry point, main thread accepts connections and places each one
+ *                  on the least loaded worker
+ * \param[in]       argc: argument count
+ * \param[in]       argv: pointer array to arguments
+ * \return          Exit code
+ */
+int main(int argc, char** argv) {
+    struct sockaddr_in addr;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t pool_num;
+    int port = SERVER_PORT;
+    int one = 1;
+    int lfd, opt;
+
+    workers_num = (cores > 0) ? (size_t)cores : 1;
+    pool_num = workers_num;
+    while ((opt = getopt(argc, argv, "p:w:j:")) != -1) {
+        switch (opt) {
+            case 'p': port = atoi(optarg); break;
+            case 'w': workers_num = (size_t)atoi(optarg); break;
+            case 'j': pool_num = (size_t)atoi(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-p port] [-w workers] [-j pool_threads]\n", argv[0]);
+                return 1;
+        }
+    }
+    if ((workers_num == 0) || (workers_num > SERVER_MAX_WORKERS) || (pool_num == 0)) {
+        fprintf(stderr, "bad number of threads\n");
+        return 1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+
+    signal(SIGPIPE, SIG_IGN);
+    lfd = socket(AF_INET, SOCK_STREAM, 0);
+    setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if ((lfd < 0) || (bind(lfd, (struct sockaddr*)&addr, sizeof(addr)) != 0) || (listen(lfd, SOMAXCONN) != 0)) {
+        perror("listen");
+        return 1;
+    }
+
+    for (size_t i = 0; i < workers_num; i++) {
+        worker_t* w = &workers[i];
+        struct epoll_event ev;
+
+        w->epfd = epoll_create1(0);
+        if ((w->epfd < 0) || (pipe(w->pipe_fd) != 0)) {
+            perror("worker");
+            return 1;
+        }
+        ev.events = EPOLLIN;
+        ev.data.ptr = NULL;
+        epoll_ctl(w->epfd, EPOLL_CTL_ADD, w->pipe_fd[0], &ev);
+        pthread_create(&w->thread, NULL, worker_thread, w);
+    }
+    for (size_t i = 0; i < pool_num; i++) {
+        pthread_t thread;
+
+        pthread_create(&thread, NULL, pool_thread, NULL);
+        pthread_detach(thread);
+    }
+    printf("listening on port %d, %zu workers, %zu pool threads, %zu bytes per session\n",
+           port, workers_num, pool_num, sizeof(conn_t));
+    fflush(stdout);
+
+    while (1) {
+        worker_msg_t msg = {-1, NULL};
+        worker_t* w = &workers[0];
+        int fd = accept(lfd, NULL, NULL);
+
+        if (fd < 0) {
+            continue;
+        }
+        for (size_t i = 1; i < workers_num; i++) {
+            if (__atomic_load_n(&workers[i].sessions, __ATOMIC_RELAXED)
+                < __atomic_load_n(&w->sessions, __ATOMIC_RELAXED)) {
+                w = &workers[i];
+            }
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        // counted here, so the next connection sees this worker loaded already
+        __atomic_fetch_add(&w->sessions, 1, __ATOMIC_RELAXED);
+        msg.fd = fd;
+        if (write(w->pipe_fd[1], &msg, sizeof(msg)) != sizeof(msg)) {
+            __atomic_fetch_sub(&w->sessions, 1, __ATOMIC_RELAXED);
+            close(fd);
+        }
+    }
+    return 0;
+}
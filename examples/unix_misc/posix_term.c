@@ -0,0 +1,193 @@
+/**
+ * \file            posix_term.c
+ * \brief           POSIX terminal backend: raw mode, batched input and buffered output
+ *
+ * Terminal is switched to raw mode once at init and restored at exit and on
+ * terminating signals. Input is read in chunks of available bytes, so it can be
+ * passed to \ref microrl_process_input at once. Output is collected in buffer
+ * and written with one write() call per flush
+ */
+
+/*
+ * Portion Copyright (c) 2011 Eugene SAMOYLOV
+ * Portion Copyright (c) 2021 Dmitry KARASEV
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of MicroRL - Micro Read Line library for small and embedded devices.
+ *
+ * Authors:         Eugene SAMOYLOV aka Helius <ghelius@gmail.com>,
+ *                  Dmitry KARASEV <karasevsdmitry@yandex.ru>
+ * Version:         1.7.0
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include "posix_term.h"
+
+static int term_in = -1;                        /* Input descriptor */
+static int term_out = -1;                       /* Output descriptor */
+static int term_raw;                            /* Input is terminal switched to raw mode */
+static struct termios term_saved;               /* Terminal attributes before init */
+static struct termios term_attr;                /* Terminal attributes in raw mode */
+static struct sigaction term_action;            /* Handler of signals restoring terminal */
+static char out_buf[POSIX_TERM_OUT_LEN];        /* Output buffer */
+static size_t out_len;                          /* Number of pending bytes in output buffer */
+
+/* Signals restoring terminal before default action */
+static const int term_signals[] = {SIGINT, SIGTERM, SIGHUP, SIGQUIT, SIGTSTP};
+
+/**
+ * \brief           Write whole buffer to descriptor
+ * \param[in]       fd: Output descriptor
+ * \param[in]       buf: Data to write
+ * \param[in]       len: Length of data
+ */
+static void write_all(int fd, const char* buf, size_t len) {
+    while (len > 0) {
+        ssize_t res = write(fd, buf, len);
+
+        if (res < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        buf += res;
+        len -= (size_t)res;
+    }
+}
+
+/**
+ * \brief           Restore terminal and do default action of signal.
+ *                  Raw mode is set again when process is continued after stop
+ * \param[in]       sig: Signal number
+ */
+static void term_signal(int sig) {
+    int err = errno;
+
+    if (term_raw) {
+        tcsetattr(term_in, TCSAFLUSH, &term_saved);
+    }
+    // signal is not blocked in handler, default action is done right here
+    signal(sig, SIG_DFL);
+    raise(sig);
+    // here only after SIGTSTP, when process is continued
+    sigaction(sig, &term_action, NULL);
+    if (term_raw) {
+        tcsetattr(term_in, TCSAFLUSH, &term_attr);
+    }
+    errno = err;
+}
+
+/**
+ * \brief           Switch terminal to raw mode, chars are read without waiting for Enter
+ *                  and are not echoed. Signal keys (Ctrl+C, Ctrl+Z) are kept.
+ *                  Descriptors which are not terminal (pipe, file) are used as is
+ * \param[in]       in_fd: Input descriptor, STDIN_FILENO usually
+ * \param[in]       out_fd: Output descriptor, STDOUT_FILENO usually
+ * \return          '0' on success, '-1' if terminal attributes can't be set
+ */
+int posix_term_init(int in_fd, int out_fd) {
+    term_in = in_fd;
+    term_out = out_fd;
+    atexit(posix_term_restore);
+    if (!isatty(in_fd) || (tcgetattr(in_fd, &term_saved) != 0)) {
+        return 0;
+    }
+    term_attr = term_saved;
+    term_attr.c_lflag &= ~(ICANON | ECHO);
+    term_attr.c_cc[VMIN] = 1;
+    term_attr.c_cc[VTIME] = 0;
+    if (tcsetattr(in_fd, TCSAFLUSH, &term_attr) != 0) {
+        return -1;
+    }
+    term_raw = 1;
+
+    term_action.sa_handler = term_signal;
+    term_action.sa_flags = SA_NODEFER;
+    sigemptyset(&term_action.sa_mask);
+    for (size_t i = 0; i < (sizeof(term_signals) / sizeof(term_signals[0])); ++i) {
+        sigaction(term_signals[i], &term_action, NULL);
+    }
+    return 0;
+}
+
+/**
+ * \brief           Write pending output and restore terminal attributes saved at init.
+ *                  Called at exit automatically
+ */
+void posix_term_restore(void) {
+    posix_term_flush();
+    if (term_raw) {
+        tcsetattr(term_in, TCSAFLUSH, &term_saved);
+        term_raw = 0;
+    }
+}
+
+/**
+ * \brief           Read available input bytes
+ * \param[out]      buf: Buffer for input
+ * \param[in]       len: Buffer size
+ * \param[in]       timeout: Time to wait for input in milliseconds, '-1' to wait forever
+ * \return          Number of read bytes, '0' on timeout or signal, '-1' on end of input or error
+ */
+int posix_term_read(char* buf, size_t len, int timeout) {
+    struct pollfd pfd;
+    ssize_t res;
+
+    pfd.fd = term_in;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    res = poll(&pfd, 1, timeout);
+    if (res <= 0) {
+        return ((res < 0) && (errno != EINTR)) ? -1 : 0;
+    }
+    res = read(term_in, buf, len);
+    if (res < 0) {
+        return ((errno == EINTR) || (errno == EAGAIN)) ? 0 : -1;
+    }
+    return (res == 0) ? -1 : (int)res;
+}
+
+/**
+ * \brief           Put output to buffer, buffer is written when it is full
+ * \param[in]       buf: Output data
+ * \param[in]       len: Length of output data
+ */
+void posix_term_write(const char* buf, size_t len) {
+    if ((out_len + len) > sizeof(out_buf)) {
+        posix_term_flush();
+        if (len > sizeof(out_buf)) {
+            write_all(term_out, buf, len);
+            return;
+        }
+    }
+    memcpy(out_buf + out_len, buf, len);
+    out_len += len;
+}
+
+/**
+ * \brief           Write buffered output with one write() call
+ */
+void posix_term_flush(void) {
+    if (out_len > 0) {
+        write_all(term_out, out_buf, out_len);
+        out_len = 0;
+    }
+}
@@ -0,0 +1,53 @@
+/**
+ * \file            posix_term.h
+ * \brief           POSIX terminal backend: raw mode, batched input and buffered output
+ */
+
+/*
+ * Portion Copyright (c) 2011 Eugene SAMOYLOV
+ * Portion Copyright (c) 2021 Dmitry KARASEV
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of MicroRL - Micro Read Line library for small and embedded devices.
+ *
+ * Authors:         Eugene SAMOYLOV aka Helius <ghelius@gmail.com>,
+ *                  Dmitry KARASEV <karasevsdmitry@yandex.ru>
+ * Version:         1.7.0
+ */
+
+#ifndef MICRORL_POSIX_TERM_HDR_H
+#define MICRORL_POSIX_TERM_HDR_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Size of output buffer, output is written when buffer is full or on flush */
+#ifndef POSIX_TERM_OUT_LEN
+#define POSIX_TERM_OUT_LEN                  4096
+#endif
+
+int     posix_term_init(int in_fd, int out_fd);
+void    posix_term_restore(void);
+int     posix_term_read(char* buf, size_t len, int timeout);
+void    posix_term_write(const char* buf, size_t len);
+void    posix_term_flush(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* MICRORL_POSIX_TERM_HDR_H */
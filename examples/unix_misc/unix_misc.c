@@ -24,13 +24,11 @@
  * Version:         1.7.0
  */
 
-#include <termios.h>
-#include <stdio.h>
-#include <fcntl.h>
-#include <sys/ioctl.h>
-#include <unistd.h> 
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include "microrl.h"
+#include "posix_term.h"
 
 // definition commands word
 #define _CMD_HELP           "help"
@@ -61,11 +59,11 @@ char name[_NAME_LEN];
 int val;
 
 /**
- * \brief           Init Linux PC platform
- * \note            Dummy function, no need on Linux-PC
+ * \brief           Init Linux PC platform, terminal is switched to raw mode until exit
  */
 void init(void) {
-};
+    posix_term_init(STDIN_FILENO, STDOUT_FILENO);
+}
 
 /**
  * \brief           Print to IO stream callback for MicroRL library
@@ -73,23 +71,32 @@ void init(void) {
  * \param[in]       str: Output string
  */
 void print(microrl_t* mrl, const char* str) {
-    fprintf(stdout, "%s", str);
+    (void)mrl;
+    posix_term_write(str, strlen(str));
 }
 
 /**
- * \brief           Get char user pressed, no waiting Enter input
- * \return          Input character
+ * \brief           Wait for input and pass all available chars to MicroRL library at once.
+ *                  Output of previous call is written once before waiting. Exit at the end of piped input
+ * \param[in,out]   mrl: \ref microrl_t working instance
  */
-char get_char(void) {
-    struct termios oldt, newt;
-    int ch;
-    tcgetattr( STDIN_FILENO, &oldt );
-    newt = oldt;
-    newt.c_lflag &= ~( ICANON | ECHO );
-    tcsetattr( STDIN_FILENO, TCSANOW, &newt );
-    ch = getchar();
-    tcsetattr( STDIN_FILENO, TCSANOW, &oldt );
-    return ch;
+void input_poll(microrl_t* mrl) {
+    char buf[256];
+    int len;
+
+    posix_term_flush();
+#if MICRORL_USE_TICK
+    len = posix_term_read(buf, sizeof(buf), 10);
+#else
+    len = posix_term_read(buf, sizeof(buf), -1);
+#endif /* MICRORL_USE_TICK */
+    if (len < 0) {
+        exit(0);
+    }
+    microrl_process_input(mrl, buf, len);
+#if MICRORL_USE_TICK
+    microrl_tick(mrl);
+#endif /* MICRORL_USE_TICK */
 }
 
 /**
@@ -122,7 +129,7 @@ int execute(microrl_t* mrl, int argc, const char* const *argv) {
     while (i < argc) {
         if (strcmp (argv[i], _CMD_HELP) == 0) {
             print(mrl, "microrl library based shell v 1.0\n\r");
-            print_help();        // print help
+            print_help(mrl);     // print help
         } else if (strcmp (argv[i], _CMD_NAME) == 0) {
             if ((++i) < argc) { // if value preset
                 if (strlen(argv[i]) < _NAME_LEN) {
@@ -26,18 +26,14 @@
  * Version:         1.7.0
  */
 
-/*
- * BUGS and TODO:
- * -- rewrite history for use more than 256 byte buffer
- */
-
 #include <string.h>
 #include <ctype.h>
 #include <stdlib.h>
-#if MICRORL_CFG_USE_LIBC_STDIO
-#include <stdio.h>
-#endif /* MICRORL_CFG_USE_LIBC_STDIO */
+#include <limits.h>
 #include "microrl.h"
+#if MICRORL_CFG_USE_PRINTF
+#include <stdarg.h>
+#endif /* MICRORL_CFG_USE_PRINTF */
 
 /**
  * \brief           List of ASCII key codes
@@ -79,7 +75,63 @@ typedef enum {
     MICRORL_KEY_DEL = 127                           /*!< Delete (not a real control character...) */
 } microrl_key_ascii_t;
 
+#if MICRORL_CFG_USE_UTF8
+/* Bytes of multi-byte chars are printable, char type may be signed */
+#define IS_CONTROL_CHAR(x)                  ((unsigned char)(x) <= 31)
+#else
 #define IS_CONTROL_CHAR(x)                  ((x) <= 31)
+#endif /* MICRORL_CFG_USE_UTF8 */
+#define IS_PRINTABLE_CHAR(x)                (!IS_CONTROL_CHAR(x) && ((x) != MICRORL_KEY_DEL))
+
+#if MICRORL_CFG_USE_ESC_SEQ
+#define IS_ESCAPE_ACTIVE(mrl)               ((mrl)->escape_seq != MICRORL_ESC_NONE)
+#else
+#define IS_ESCAPE_ACTIVE(mrl)               0
+#endif /* MICRORL_CFG_USE_ESC_SEQ */
+
+/* Command line is modified by split and must be restored after it */
+#define MICRORL_USE_SPLIT_RESTORE           (MICRORL_CFG_USE_QUOTING && !MICRORL_CFG_USE_TOKEN_INDEX)
+
+#if MICRORL_CFG_USE_HISTORY_SEARCH
+#define IS_SEARCH_ACTIVE(mrl)               ((mrl)->search_active != 0)
+#else
+#define IS_SEARCH_ACTIVE(mrl)               0
+#endif /* MICRORL_CFG_USE_HISTORY_SEARCH */
+
+#if MICRORL_CFG_USE_ASYNC_EXEC
+#define IS_EXEC_PENDING(mrl)                ((mrl)->exec_pending != 0)
+#else
+#define IS_EXEC_PENDING(mrl)                0
+#endif /* MICRORL_CFG_USE_ASYNC_EXEC */
+
+#if MICRORL_CFG_USE_UTF8
+#define IS_UTF8_CONT(x)                     (((unsigned char)(x) & 0xC0) == 0x80)
+#define LINE_COL(mrl, pos)                  line_col((mrl), (pos))
+#define LINE_POS(mrl, col)                  line_pos((mrl), (col))
+#define CHAR_NEXT(mrl, pos)                 char_next((mrl), (pos))
+#define CHAR_PREV(mrl, pos)                 char_prev((mrl), (pos))
+#else
+#define LINE_COL(mrl, pos)                  (pos)
+#define LINE_POS(mrl, col)                  (col)
+#define CHAR_NEXT(mrl, pos)                 ((pos) + 1)
+#define CHAR_PREV(mrl, pos)                 ((pos) - 1)
+#endif /* MICRORL_CFG_USE_UTF8 */
+
+#if MICRORL_CFG_USE_STATS
+#define STATS_INC(mrl, name)                ((mrl)->stats.name++)
+#define STATS_ADD(mrl, name, val)           ((mrl)->stats.name += (uint32_t)(val))
+#else
+#define STATS_INC(mrl, name)
+#define STATS_ADD(mrl, name, val)
+#endif /* MICRORL_CFG_USE_STATS */
+
+#if MICRORL_CFG_USE_TRACE
+#define TRACE_ENTER(mrl, point)             trace_point((mrl), (point), 0)
+#define TRACE_LEAVE(mrl, point)             trace_point((mrl), (point), 1)
+#else
+#define TRACE_ENTER(mrl, point)
+#define TRACE_LEAVE(mrl, point)
+#endif /* MICRORL_CFG_USE_TRACE */
 
 /**
  * \brief           History ring buffer memory status
@@ -98,10 +150,106 @@ typedef enum {
     MICRORL_HIST_DIR_DOWN                           /*!< Next record in history ring buffer */
 } microrl_hist_dir_t;
 
-static char* prompt_default = MICRORL_CFG_PROMPT_STRING;
+#if MICRORL_CFG_USE_EXT_BUFFERS
+#define MICRORL_CMDLINE_SIZE(mrl)           ((mrl)->cmdline_len)
+#define MICRORL_HIST_RING_LEN(prbuf)        ((prbuf)->ring_len)
+#else
+#define MICRORL_CMDLINE_SIZE(mrl)           MICRORL_CFG_CMDLINE_LEN
+#define MICRORL_HIST_RING_LEN(prbuf)        MICRORL_CFG_RING_HISTORY_LEN
+#endif /* MICRORL_CFG_USE_EXT_BUFFERS */
+
+#if MICRORL_CFG_USE_RX_RING
+#define MICRORL_RX_MASK                     ((microrl_rx_pos_t)(MICRORL_CFG_RX_RING_LEN - 1))
+#if defined(__GNUC__) || defined(__clang__)
+/* Acquire load pairs with release store of other side, ring data is visible before index */
+#define MICRORL_RX_LOAD(idx)                __atomic_load_n(&(idx), __ATOMIC_ACQUIRE)
+#define MICRORL_RX_STORE(idx, val)          __atomic_store_n(&(idx), (val), __ATOMIC_RELEASE)
+#else
+/* Compiler-only ordering, enough for single-core MCU */
+#define MICRORL_RX_LOAD(idx)                (*(volatile microrl_rx_pos_t*)&(idx))
+#define MICRORL_RX_STORE(idx, val)          (*(volatile microrl_rx_pos_t*)&(idx) = (val))
+#endif /* defined(__GNUC__) || defined(__clang__) */
+#endif /* MICRORL_CFG_USE_RX_RING */
+
+#if MICRORL_CFG_USE_TRACE || __DOXYGEN__
+/**
+ * \brief           Pass trace point with time stamp to trace callback
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       point: Member of \ref microrl_trace_point_t enumeration
+ * \param[in]       leave: '0' at entry, '1' at exit of traced function
+ */
+static void trace_point(microrl_t* mrl, microrl_trace_point_t point, int leave) {
+    if (mrl->trace != NULL) {
+        mrl->trace(mrl, point, leave, (mrl->get_stamp != NULL) ? mrl->get_stamp(mrl) : 0);
+    }
+}
+#endif /* MICRORL_CFG_USE_TRACE || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_UTF8 || __DOXYGEN__
+/**
+ * \brief           Get number of bytes of UTF-8 char by its first byte
+ * \param[in]       ch: The first byte of char
+ * \return          Number of bytes, '0' for continuation byte and invalid first byte
+ */
+static int utf8_char_len(unsigned char ch) {
+    if (ch < 0x80) {
+        return 1;
+    } else if ((ch >= 0xC2) && (ch <= 0xDF)) {
+        return 2;
+    } else if ((ch >= 0xE0) && (ch <= 0xEF)) {
+        return 3;
+    } else if ((ch >= 0xF0) && (ch <= 0xF4)) {
+        return 4;
+    }
+    return 0;
+}
+
+/**
+ * \brief           Check text consists of whole UTF-8 chars only
+ * \param[in]       text: Text, not NULL-terminated
+ * \param[in]       len: Number of bytes of text
+ * \return          '1' if text is valid, '0' otherwise
+ */
+static int utf8_valid(const char* text, size_t len) {
+    size_t i = 0;
+
+    while (i < len) {
+        size_t n = utf8_char_len(text[i]);
+
+        if ((n == 0) || (n > (len - i))) {
+            return 0;
+        }
+        while (--n > 0) {
+            if (!IS_UTF8_CONT(text[++i])) {
+                return 0;
+            }
+        }
+        i++;
+    }
+    return 1;
+}
+#endif /* MICRORL_CFG_USE_UTF8 || __DOXYGEN__ */
 
 #if MICRORL_CFG_USE_HISTORY || __DOXYGEN__
 
+#define MICRORL_HIST_LEN_MAX                ((1L << (8 * MICRORL_CFG_HISTORY_HEADER_SIZE)) - 1)
+
+#if MICRORL_CFG_USE_HISTORY_COMPRESS
+/* Size of shared prefix length field, stored after record header */
+#define MICRORL_HIST_PREFIX_SIZE            MICRORL_CFG_HISTORY_HEADER_SIZE
+#else
+#define MICRORL_HIST_PREFIX_SIZE            0
+#endif /* MICRORL_CFG_USE_HISTORY_COMPRESS */
+
+#if MICRORL_CFG_USE_HISTORY_PERSIST
+#define MICRORL_HIST_BLOCK_VERSION          1
+#define MICRORL_HIST_BLOCK_SNAPSHOT         'S'
+#define MICRORL_HIST_BLOCK_DELTA            'D'
+#define MICRORL_HIST_BLOCK_HDR_LEN          8
+/* Record format of exported history, import fails if it differs */
+#define MICRORL_HIST_FORMAT                 (MICRORL_CFG_HISTORY_HEADER_SIZE | (MICRORL_CFG_USE_HISTORY_COMPRESS ? 0x10 : 0))
+#endif /* MICRORL_CFG_USE_HISTORY_PERSIST */
+
 #if _HISTORY_DEBUG || __DOXYGEN__
 /**
  * \brief           Print history buffer content on screen
@@ -109,7 +257,7 @@ static char* prompt_default = MICRORL_CFG_PROMPT_STRING;
  */
 static void print_hist(microrl_hist_rbuf_t* prbuf) {
     printf("\n");
-    for (size_t i = 0; i < MICRORL_CFG_RING_HISTORY_LEN; i++) {
+    for (size_t i = 0; i < MICRORL_HIST_RING_LEN(prbuf); i++) {
         if (i == prbuf->begin) {
             printf("b");
         } else {
@@ -117,14 +265,14 @@ static void print_hist(microrl_hist_rbuf_t* prbuf) {
         }
     }
     printf("\n");
-    for (size_t i = 0; i < MICRORL_CFG_RING_HISTORY_LEN; i++) {
+    for (size_t i = 0; i < MICRORL_HIST_RING_LEN(prbuf); i++) {
         if (isalpha(prbuf->ring_buf[i])) {
             printf("%c", prbuf->ring_buf[i]);
         } else {
             printf("%d", prbuf->ring_buf[i]);
     }
     printf("\n");
-    for (size_t i = 0; i < MICRORL_CFG_RING_HISTORY_LEN; i++) {
+    for (size_t i = 0; i < MICRORL_HIST_RING_LEN(prbuf); i++) {
         if (i == prbuf->end) {
             printf("e");
         } else {
@@ -135,17 +283,153 @@ static void print_hist(microrl_hist_rbuf_t* prbuf) {
 }
 #endif /* _HISTORY_DEBUG || __DOXYGEN__ */
 
+/**
+ * \brief           Get position in ring buffer after offset from given one
+ * \param[in]       prbuf: Pointer to \ref microrl_hist_rbuf_t structure
+ * \param[in]       pos: Position in ring buffer
+ * \param[in]       offset: Offset, must be less than ring buffer size
+ * \return          New position
+ */
+static size_t hist_offset(microrl_hist_rbuf_t* prbuf, size_t pos, size_t offset) {
+#if !MICRORL_CFG_USE_EXT_BUFFERS
+    (void)prbuf;
+#endif /* !MICRORL_CFG_USE_EXT_BUFFERS */
+    pos += offset;
+    if (pos >= MICRORL_HIST_RING_LEN(prbuf)) {
+        pos -= MICRORL_HIST_RING_LEN(prbuf);
+    }
+    return pos;
+}
+
+/**
+ * \brief           Read record length from header
+ * \param[in]       prbuf: Pointer to \ref microrl_hist_rbuf_t structure
+ * \param[in]       header: Record header position
+ * \return          Record length, 0 for end of records
+ */
+static size_t hist_get_len(microrl_hist_rbuf_t* prbuf, size_t header) {
+#if MICRORL_CFG_HISTORY_HEADER_SIZE == 1
+    return (unsigned char)prbuf->ring_buf[header];
+#else
+    return (unsigned char)prbuf->ring_buf[header]
+           | ((size_t)(unsigned char)prbuf->ring_buf[hist_offset(prbuf, header, 1)] << 8);
+#endif /* MICRORL_CFG_HISTORY_HEADER_SIZE == 1 */
+}
+
+/**
+ * \brief           Write record length to header
+ * \param[in,out]   prbuf: Pointer to \ref microrl_hist_rbuf_t structure
+ * \param[in]       header: Record header position
+ * \param[in]       len: Record length, 0 for end of records
+ */
+static void hist_set_len(microrl_hist_rbuf_t* prbuf, size_t header, size_t len) {
+    prbuf->ring_buf[header] = (char)len;
+#if MICRORL_CFG_HISTORY_HEADER_SIZE == 2
+    prbuf->ring_buf[hist_offset(prbuf, header, 1)] = (char)(len >> 8);
+#endif /* MICRORL_CFG_HISTORY_HEADER_SIZE == 2 */
+}
+
+/**
+ * \brief           Get position of the next record header
+ * \param[in]       prbuf: Pointer to \ref microrl_hist_rbuf_t structure
+ * \param[in]       header: Record header position
+ * \return          Next record header position
+ */
+static size_t hist_next(microrl_hist_rbuf_t* prbuf, size_t header) {
+    return hist_offset(prbuf, header, MICRORL_CFG_HISTORY_HEADER_SIZE + hist_get_len(prbuf, header));
+}
+
+/**
+ * \brief           Copy data from ring buffer, wrapping around buffer end
+ * \param[in]       prbuf: Pointer to \ref microrl_hist_rbuf_t structure
+ * \param[in]       start: Data position in ring buffer
+ * \param[out]      data: Buffer for data
+ * \param[in]       len: Data length
+ */
+static void hist_read(microrl_hist_rbuf_t* prbuf, size_t start, char* data, size_t len) {
+    if (len <= (MICRORL_HIST_RING_LEN(prbuf) - start)) {
+        memcpy(data, prbuf->ring_buf + start, len);
+    } else {
+        size_t part0 = MICRORL_HIST_RING_LEN(prbuf) - start;
+        memcpy(data, prbuf->ring_buf + start, part0);
+        memcpy(data + part0, prbuf->ring_buf, len - part0);
+    }
+}
+
+/**
+ * \brief           Copy data to ring buffer, wrapping around buffer end
+ * \param[in,out]   prbuf: Pointer to \ref microrl_hist_rbuf_t structure
+ * \param[in]       start: Data position in ring buffer
+ * \param[in]       data: Data to store
+ * \param[in]       len: Data length
+ */
+static void hist_write(microrl_hist_rbuf_t* prbuf, size_t start, const char* data, size_t len) {
+    if (len <= (MICRORL_HIST_RING_LEN(prbuf) - start)) {
+        memcpy(prbuf->ring_buf + start, data, len);
+    } else {
+        size_t part0 = MICRORL_HIST_RING_LEN(prbuf) - start;
+        memcpy(prbuf->ring_buf + start, data, part0);
+        memcpy(prbuf->ring_buf, data + part0, len - part0);
+    }
+}
+
 /**
  * \brief           Remove older record from ring buffer
  * \param[in,out]   prbuf: Pointer to \ref microrl_hist_rbuf_t structure
  */
 static void hist_erase_older(microrl_hist_rbuf_t* prbuf) {
-    int new_pos = prbuf->begin + prbuf->ring_buf[prbuf->begin] + 1;
-    if (new_pos >= MICRORL_CFG_RING_HISTORY_LEN) {
-        new_pos = new_pos - MICRORL_CFG_RING_HISTORY_LEN;
+    size_t next = hist_next(prbuf, prbuf->begin);
+#if MICRORL_CFG_USE_HISTORY_COMPRESS
+    size_t prefix = 0;
+
+    if (hist_get_len(prbuf, next) != 0) {
+        prefix = hist_get_len(prbuf, hist_offset(prbuf, next, MICRORL_CFG_HISTORY_HEADER_SIZE));
     }
+    if (prefix > 0) {
+        // next record becomes the oldest one, it must keep whole line. Shared prefix is taken
+        // from removed record and copied backward right before suffix, new header goes before it
+        size_t src = hist_offset(prbuf, prbuf->begin, 2 * MICRORL_CFG_HISTORY_HEADER_SIZE);
+        size_t dst = hist_offset(prbuf, next, 2 * MICRORL_CFG_HISTORY_HEADER_SIZE);
+        size_t len = hist_get_len(prbuf, next) + prefix;
 
-    prbuf->begin = new_pos;
+        while (prefix-- > 0) {
+            dst = hist_offset(prbuf, dst, MICRORL_HIST_RING_LEN(prbuf) - 1);
+            prbuf->ring_buf[dst] = prbuf->ring_buf[hist_offset(prbuf, src, prefix)];
+        }
+#if MICRORL_CFG_USE_HISTORY_PERSIST
+        if (prbuf->mark == next) {
+            prbuf->mark = hist_offset(prbuf, dst, MICRORL_HIST_RING_LEN(prbuf) - 2 * MICRORL_CFG_HISTORY_HEADER_SIZE);
+        }
+#endif /* MICRORL_CFG_USE_HISTORY_PERSIST */
+        next = hist_offset(prbuf, dst, MICRORL_HIST_RING_LEN(prbuf) - 2 * MICRORL_CFG_HISTORY_HEADER_SIZE);
+        hist_set_len(prbuf, next, len);
+        hist_set_len(prbuf, hist_offset(prbuf, next, MICRORL_CFG_HISTORY_HEADER_SIZE), 0);
+#if MICRORL_CFG_USE_HISTORY_INDEX
+        {
+            size_t slot = prbuf->index_begin + 1;
+            if (slot >= MICRORL_CFG_HISTORY_INDEX_LEN) {
+                slot -= MICRORL_CFG_HISTORY_INDEX_LEN;
+            }
+            prbuf->index[slot] = next;
+        }
+#endif /* MICRORL_CFG_USE_HISTORY_INDEX */
+    }
+#endif /* MICRORL_CFG_USE_HISTORY_COMPRESS */
+#if MICRORL_CFG_USE_HISTORY_PERSIST
+    if ((prbuf->unsaved > 0) && (prbuf->begin == prbuf->mark)) {
+        prbuf->unsaved_lost = 1;
+    }
+#endif /* MICRORL_CFG_USE_HISTORY_PERSIST */
+    prbuf->begin = next;
+#if MICRORL_CFG_USE_STATS
+    prbuf->evictions++;
+#endif /* MICRORL_CFG_USE_STATS */
+#if MICRORL_CFG_USE_HISTORY_INDEX
+    if (++prbuf->index_begin >= MICRORL_CFG_HISTORY_INDEX_LEN) {
+        prbuf->index_begin = 0;
+    }
+    prbuf->count--;
+#endif /* MICRORL_CFG_USE_HISTORY_INDEX */
 }
 
 /**
@@ -154,57 +438,169 @@ static void hist_erase_older(microrl_hist_rbuf_t* prbuf) {
  * \param[in]       len: Length of new line to save in history
  * \return          Member of \ref microrl_hist_status_t enumeration
  */
-static microrl_hist_status_t hist_is_space_for_new(microrl_hist_rbuf_t* prbuf, int len) {
-    if (prbuf->ring_buf[prbuf->begin] == 0) {
+static microrl_hist_status_t hist_is_space_for_new(microrl_hist_rbuf_t* prbuf, size_t len) {
+    size_t space;
+
+    if (hist_get_len(prbuf, prbuf->begin) == 0) {
         return MICRORL_HIST_NOT_FULL;
     }
     if (prbuf->end >= prbuf->begin) {
-        if ((MICRORL_CFG_RING_HISTORY_LEN - prbuf->end + prbuf->begin - 1) > len) {
-            return MICRORL_HIST_NOT_FULL;
-        }
+        space = MICRORL_HIST_RING_LEN(prbuf) - prbuf->end + prbuf->begin;
     } else {
-        if ((prbuf->begin - prbuf->end - 1) > len) {
-            return MICRORL_HIST_NOT_FULL;
-        }
+        space = prbuf->begin - prbuf->end;
+    }
+    // new record header and end of records mark
+    if (space >= (len + 2 * MICRORL_CFG_HISTORY_HEADER_SIZE)) {
+        return MICRORL_HIST_NOT_FULL;
     }
     return MICRORL_HIST_FULL;
 }
 
+/**
+ * \brief           Get number of records in history
+ * \param[in]       prbuf: Pointer to \ref microrl_hist_rbuf_t structure
+ * \return          Number of records
+ */
+static size_t hist_record_count(microrl_hist_rbuf_t* prbuf) {
+#if MICRORL_CFG_USE_HISTORY_INDEX
+    return prbuf->count;
+#else
+    size_t cnt = 0;
+    size_t header = prbuf->begin;
+    while (hist_get_len(prbuf, header) != 0) {
+        header = hist_next(prbuf, header);
+        cnt++;
+    }
+    return cnt;
+#endif /* MICRORL_CFG_USE_HISTORY_INDEX */
+}
+
+/**
+ * \brief           Get position of record header in ring buffer
+ * \param[in]       prbuf: Pointer to \ref microrl_hist_rbuf_t structure
+ * \param[in]       num: Record number, 0 is the oldest one. Must be less than number of records
+ * \return          Record header position
+ */
+static size_t hist_record_header(microrl_hist_rbuf_t* prbuf, size_t num) {
+#if MICRORL_CFG_USE_HISTORY_INDEX
+    size_t slot = prbuf->index_begin + num;
+    if (slot >= MICRORL_CFG_HISTORY_INDEX_LEN) {
+        slot -= MICRORL_CFG_HISTORY_INDEX_LEN;
+    }
+    return prbuf->index[slot];
+#else
+    size_t header = prbuf->begin;
+    while (num-- > 0) {
+        header = hist_next(prbuf, header);
+    }
+    return header;
+#endif /* MICRORL_CFG_USE_HISTORY_INDEX */
+}
+
+/**
+ * \brief           Copy record from ring buffer to 'line'
+ * \param[in]       prbuf: Pointer to \ref microrl_hist_rbuf_t structure
+ * \param[in]       num: Record number, 0 is the oldest one. Must be less than number of records
+ * \param[out]      line: Buffer for record
+ * \return          Record length
+ */
+static int hist_copy_record(microrl_hist_rbuf_t* prbuf, size_t num, char* line) {
+    size_t header = hist_record_header(prbuf, num);
+#if MICRORL_CFG_USE_HISTORY_COMPRESS
+    size_t prefix = hist_get_len(prbuf, hist_offset(prbuf, header, MICRORL_CFG_HISTORY_HEADER_SIZE));
+    size_t len = hist_get_len(prbuf, header) - MICRORL_HIST_PREFIX_SIZE + prefix;
+    size_t need = len;
+
+    // take suffix from each record and walk to older ones while shared prefix is needed,
+    // the oldest record always keeps whole line
+    while (1) {
+        if (need > prefix) {
+            hist_read(prbuf, hist_offset(prbuf, header, 2 * MICRORL_CFG_HISTORY_HEADER_SIZE), line + prefix, need - prefix);
+            need = prefix;
+        }
+        if (need == 0) {
+            break;
+        }
+        header = hist_record_header(prbuf, --num);
+        prefix = hist_get_len(prbuf, hist_offset(prbuf, header, MICRORL_CFG_HISTORY_HEADER_SIZE));
+    }
+    return len;
+#else
+    size_t len = hist_get_len(prbuf, header);
+    hist_read(prbuf, hist_offset(prbuf, header, MICRORL_CFG_HISTORY_HEADER_SIZE), line, len);
+    return len;
+#endif /* MICRORL_CFG_USE_HISTORY_COMPRESS */
+}
+
 /**
  * \brief           Put line to ring buffer
  * \param[in,out]   prbuf: Pointer to \ref microrl_hist_rbuf_t structure
  * \param[in]       line: Record to save in history
  * \param[in]       len: Record length
  */
-static void hist_save_line(microrl_hist_rbuf_t* prbuf, char* line, int len) {
-    if (len > (MICRORL_CFG_RING_HISTORY_LEN - 2)) {
+static void hist_save_line(microrl_hist_rbuf_t* prbuf, const char* line, int len) {
+    size_t start;
+    size_t prefix = 0;
+
+    if (((size_t)len > (MICRORL_HIST_RING_LEN(prbuf) - 2 * MICRORL_CFG_HISTORY_HEADER_SIZE - MICRORL_HIST_PREFIX_SIZE))
+        || ((len + MICRORL_HIST_PREFIX_SIZE) > MICRORL_HIST_LEN_MAX)) {
         return;
     }
 
-    while (hist_is_space_for_new(prbuf, len) == MICRORL_HIST_FULL) {
-        hist_erase_older(prbuf);
+#if MICRORL_CFG_USE_HISTORY_COMPRESS
+    prbuf->cur = 0;
+    if (hist_get_len(prbuf, prbuf->begin) != 0) {
+        char last[MICRORL_CFG_CMDLINE_LEN];
+        int last_len = hist_copy_record(prbuf, hist_record_count(prbuf) - 1, last);
+
+        while (((int)prefix < last_len) && ((int)prefix < len) && (last[prefix] == line[prefix])) {
+            prefix++;
+        }
+        if (((int)prefix == last_len) && ((int)prefix == len)) {
+            // skip repeat of the last record
+            return;
+        }
     }
+#endif /* MICRORL_CFG_USE_HISTORY_COMPRESS */
 
-    // if it's first line
-    if (prbuf->ring_buf[prbuf->begin] == 0) {
-        prbuf->ring_buf[prbuf->begin] = len;
+    while (hist_is_space_for_new(prbuf, MICRORL_HIST_PREFIX_SIZE + len - prefix) == MICRORL_HIST_FULL) {
+        hist_erase_older(prbuf);
+    }
+#if MICRORL_CFG_USE_HISTORY_INDEX
+    if (prbuf->count >= MICRORL_CFG_HISTORY_INDEX_LEN) {
+        hist_erase_older(prbuf);
+    }
+#endif /* MICRORL_CFG_USE_HISTORY_INDEX */
+#if MICRORL_CFG_USE_HISTORY_COMPRESS
+    if (hist_get_len(prbuf, prbuf->begin) == 0) {
+        // previous record is removed, store whole line
+        prefix = 0;
+    }
+#endif /* MICRORL_CFG_USE_HISTORY_COMPRESS */
+#if MICRORL_CFG_USE_HISTORY_INDEX
+    {
+        size_t slot = prbuf->index_begin + prbuf->count++;
+        if (slot >= MICRORL_CFG_HISTORY_INDEX_LEN) {
+            slot -= MICRORL_CFG_HISTORY_INDEX_LEN;
+        }
+        prbuf->index[slot] = prbuf->end;
     }
+#endif /* MICRORL_CFG_USE_HISTORY_INDEX */
 
     // store line
-    if (len < (MICRORL_CFG_RING_HISTORY_LEN - prbuf->end - 1)) {
-        memcpy(prbuf->ring_buf + prbuf->end + 1, line, len);
-    } else {
-        int part_len = MICRORL_CFG_RING_HISTORY_LEN - prbuf->end - 1;
-        memcpy(prbuf->ring_buf + prbuf->end + 1, line, part_len);
-        memcpy(prbuf->ring_buf, line + part_len, len - part_len);
-    }
+    start = hist_offset(prbuf, prbuf->end, MICRORL_CFG_HISTORY_HEADER_SIZE);
+#if MICRORL_CFG_USE_HISTORY_COMPRESS
+    hist_set_len(prbuf, start, prefix);
+    start = hist_offset(prbuf, start, MICRORL_HIST_PREFIX_SIZE);
+#endif /* MICRORL_CFG_USE_HISTORY_COMPRESS */
+    hist_write(prbuf, start, line + prefix, len - prefix);
 
-    prbuf->ring_buf[prbuf->end] = len;
-    prbuf->end = prbuf->end + len + 1;
-    if (prbuf->end >= MICRORL_CFG_RING_HISTORY_LEN) {
-        prbuf->end -= MICRORL_CFG_RING_HISTORY_LEN;
-    }
-    prbuf->ring_buf[prbuf->end] = 0;
+    hist_set_len(prbuf, prbuf->end, MICRORL_HIST_PREFIX_SIZE + len - prefix);
+    prbuf->end = hist_offset(prbuf, start, len - prefix);
+    hist_set_len(prbuf, prbuf->end, 0);
+#if MICRORL_CFG_USE_HISTORY_PERSIST
+    prbuf->unsaved++;
+#endif /* MICRORL_CFG_USE_HISTORY_PERSIST */
     prbuf->cur = 0;
 #if _HISTORY_DEBUG
     print_hist(prbuf);
@@ -215,544 +611,3502 @@ static void hist_save_line(microrl_hist_rbuf_t* prbuf, char* line, int len) {
  * \brief           Copy saved line to 'line' and return size of line
  * \param[in]       prbuf: Pointer to \ref microrl_hist_rbuf_t structure
  * \param[out]      line: Line to restore from history
+ * \param[in]       size: Size of line buffer
  * \param[in]       dir: Record search direction, member of \ref microrl_hist_dir_t
  * \return          Size of restored line. 0 is returned, if history is empty
  */
-static int hist_restore_line(microrl_hist_rbuf_t* prbuf, char* line, microrl_hist_dir_t dir) {
-    int cnt = 0;
-    // count history record
-    int header = prbuf->begin;
-    while (prbuf->ring_buf[header] != 0) {
-        header += prbuf->ring_buf[header] + 1;
-        if (header >= MICRORL_CFG_RING_HISTORY_LEN) {
-            header -= MICRORL_CFG_RING_HISTORY_LEN;
-        }
-        cnt++;
-    }
+static int hist_restore_line(microrl_hist_rbuf_t* prbuf, char* line, size_t size, microrl_hist_dir_t dir) {
+    size_t cnt = hist_record_count(prbuf);
 
     if (dir == MICRORL_HIST_DIR_UP) {
-        if (cnt >= prbuf->cur) {
-            int header = prbuf->begin;
-            int j = 0;
-            // found record for 'prbuf->cur' index
-            while ((prbuf->ring_buf[header] != 0) && ((cnt - j - 1) != prbuf->cur)) {
-                header += prbuf->ring_buf[header] + 1;
-                if (header >= MICRORL_CFG_RING_HISTORY_LEN) {
-                    header -= MICRORL_CFG_RING_HISTORY_LEN;
-                }
-                j++;
-            }
-            if (prbuf->ring_buf[header]) {
-                prbuf->cur++;
-                // obtain saved line
-                if ((prbuf->ring_buf[header] + header) < MICRORL_CFG_RING_HISTORY_LEN) {
-                    memset(line, 0, MICRORL_CFG_CMDLINE_LEN);
-                    memcpy(line, prbuf->ring_buf + header + 1, prbuf->ring_buf[header]);
-                } else {
-                    int part0 = MICRORL_CFG_RING_HISTORY_LEN - header - 1;
-                    memset(line, 0, MICRORL_CFG_CMDLINE_LEN);
-                    memcpy(line, prbuf->ring_buf + header + 1, part0);
-                    memcpy(line + part0, prbuf->ring_buf, prbuf->ring_buf[header] - part0);
-                }
-                return prbuf->ring_buf[header];
-            }
+        if (prbuf->cur < cnt) {
+            // obtain saved line for 'prbuf->cur' index
+            prbuf->cur++;
+            memset(line, 0, size);
+            return hist_copy_record(prbuf, cnt - prbuf->cur, line);
         }
     } else {
         if (prbuf->cur > 0) {
             prbuf->cur--;
-            int header = prbuf->begin;
-            int j = 0;
-
-            while ((prbuf->ring_buf[header] != 0) && ((cnt - j) != prbuf->cur)) {
-                header += prbuf->ring_buf[header] + 1;
-                if (header >= MICRORL_CFG_RING_HISTORY_LEN) {
-                    header -= MICRORL_CFG_RING_HISTORY_LEN;
-                }
-                j++;
+            if (prbuf->cur > 0) {
+                return hist_copy_record(prbuf, cnt - prbuf->cur, line);
             }
-            if ((prbuf->ring_buf[header] + header) < MICRORL_CFG_RING_HISTORY_LEN) {
-                memcpy(line, prbuf->ring_buf + header + 1, prbuf->ring_buf[header]);
-            } else {
-                int part0 = MICRORL_CFG_RING_HISTORY_LEN - header - 1;
-                memcpy(line, prbuf->ring_buf + header + 1, part0);
-                memcpy(line + part0, prbuf->ring_buf, prbuf->ring_buf[header] - part0);
-            }
-            return prbuf->ring_buf[header];
-        } else {
-            /* empty line */
-            return 0;
         }
+        /* empty line */
+        return 0;
     }
     return -1;
 }
-#endif /* MICRORL_CFG_USE_HISTORY || __DOXYGEN__ */
-
-
 
+#if MICRORL_CFG_USE_HISTORY_PERSIST || __DOXYGEN__
+/**
+ * \brief           Write little-endian value to buffer
+ * \param[out]      buf: Output buffer
+ * \param[in]       val: Value to write
+ * \param[in]       size: Number of bytes
+ */
+static void hist_put_le(char* buf, size_t val, int size) {
+    for (int i = 0; i < size; i++) {
+        buf[i] = (char)(val >> (8 * i));
+    }
+}
 
+/**
+ * \brief           Read little-endian value from buffer
+ * \param[in]       buf: Input buffer
+ * \param[in]       size: Number of bytes
+ * \return          Read value
+ */
+static size_t hist_get_le(const char* buf, int size) {
+    size_t val = 0;
+    for (int i = size - 1; i >= 0; i--) {
+        val = (val << 8) | (unsigned char)buf[i];
+    }
+    return val;
+}
 
+/**
+ * \brief           Fill header of exported block
+ * \param[out]      buf: Buffer for \ref MICRORL_HIST_BLOCK_HDR_LEN bytes
+ * \param[in]       type: Block type, \ref MICRORL_HIST_BLOCK_SNAPSHOT or \ref MICRORL_HIST_BLOCK_DELTA
+ * \param[in]       len: Length of block data after header
+ */
+static void hist_block_header(char* buf, char type, size_t len) {
+    buf[0] = 'm';
+    buf[1] = 'h';
+    buf[2] = MICRORL_HIST_BLOCK_VERSION;
+    buf[3] = type;
+    buf[4] = MICRORL_HIST_FORMAT;
+    hist_put_le(buf + 5, len, 3);
+}
 
+/**
+ * \brief           Start new delta, records saved after this point are exported by next delta
+ * \param[in,out]   prbuf: Pointer to \ref microrl_hist_rbuf_t structure
+ */
+static void hist_checkpoint(microrl_hist_rbuf_t* prbuf) {
+    prbuf->mark = prbuf->end;
+    prbuf->unsaved = 0;
+    prbuf->unsaved_lost = 0;
+}
 
+/**
+ * \brief           Get length of line saved in record
+ * \param[in]       prbuf: Pointer to \ref microrl_hist_rbuf_t structure
+ * \param[in]       header: Record header position
+ * \return          Line length
+ */
+static size_t hist_line_len(microrl_hist_rbuf_t* prbuf, size_t header) {
+#if MICRORL_CFG_USE_HISTORY_COMPRESS
+    return hist_get_len(prbuf, header) - MICRORL_HIST_PREFIX_SIZE
+            + hist_get_len(prbuf, hist_offset(prbuf, header, MICRORL_CFG_HISTORY_HEADER_SIZE));
+#else
+    return hist_get_len(prbuf, header);
+#endif /* MICRORL_CFG_USE_HISTORY_COMPRESS */
+}
 
-#if MICRORL_CFG_USE_QUOTING || __DOXYGEN__
+#if MICRORL_CFG_USE_UTF8 || __DOXYGEN__
 /**
- * \brief           Restore end quote marks in command line
- * \param[in,out]   mrl: \ref microrl_t working instance
+ * \brief           Check all lines in history consist of whole UTF-8 chars,
+ *                  so lines restored to command line are edited char by char
+ * \param[in]       prbuf: Pointer to \ref microrl_hist_rbuf_t structure
+ * \return          \ref microrlOK on success, \ref microrlERRPAR otherwise
  */
-static void restore(microrl_t* mrl) {
-    size_t iq;
-    for (iq = 0; iq < MICRORL_CFG_QUOTED_TOKEN_NMB; ++iq) {
-        if (mrl->quotes[iq].end == 0) {
-            break;
-        }
+static microrlr_t hist_check_utf8(microrl_hist_rbuf_t* prbuf) {
+    char line[MICRORL_CFG_CMDLINE_LEN];
+    size_t cnt = hist_record_count(prbuf);
 
-        *mrl->quotes[iq].end = *mrl->quotes[iq].begin;
-        mrl->quotes[iq].begin = 0;
-        mrl->quotes[iq].end = 0;
+    for (size_t num = 0; num < cnt; num++) {
+        if (!utf8_valid(line, hist_copy_record(prbuf, num, line))) {
+            return microrlERRPAR;
+        }
     }
+    return microrlOK;
 }
-#endif /* MICRORL_CFG_USE_QUOTING || __DOXYGEN__ */
+#endif /* MICRORL_CFG_USE_UTF8 || __DOXYGEN__ */
 
 /**
- * \brief           Split command line to tokens array
- * \param[in,out]   mrl: \ref microrl_t working instance
- * \param[in]       limit: Command line symbols limit
- * \param[in]       tkn_arr: Tokens buffer stored split words
- * \return          Number of split tokens
+ * \brief           Restore ring buffer from snapshot and check all records in it
+ * \param[in,out]   prbuf: Pointer to \ref microrl_hist_rbuf_t structure
+ * \param[in]       data: Snapshot block data
+ * \param[in]       len: Snapshot block data length
+ * \param[in]       line_size: Command line buffer size, longer lines are rejected
+ * \return          \ref microrlOK on success, member of \ref microrlr_t otherwise
  */
-static int split(microrl_t* mrl, int limit, const char** tkn_arr) {
-    int i = 0;
-    int ind = 0;
-#if MICRORL_CFG_USE_QUOTING
-    int iq = 0;
-    char quote = 0;
-    for (iq = 0; iq < MICRORL_CFG_QUOTED_TOKEN_NMB; ++iq) {
-        mrl->quotes[iq].begin = 0;
-        mrl->quotes[iq].end = 0;
+static microrlr_t hist_import_snapshot(microrl_hist_rbuf_t* prbuf, const char* data, size_t len, size_t line_size) {
+    size_t begin, end, header;
+    size_t total = 0;
+#if MICRORL_CFG_USE_HISTORY_COMPRESS
+    size_t prev_len = 0;
+#endif /* MICRORL_CFG_USE_HISTORY_COMPRESS */
+
+    if (len != (8 + MICRORL_HIST_RING_LEN(prbuf))) {
+        return microrlERRMEM;
     }
-    iq = 0;
-#endif /* MICRORL_CFG_USE_QUOTING */
-    while (1) {
-        // go to the first whitespace (zero for us)
-        while ((mrl->cmdline[ind] == '\0') && (ind < limit)) {
-            ind++;
-        }
+    begin = hist_get_le(data, 4);
+    end = hist_get_le(data + 4, 4);
+    if ((begin >= MICRORL_HIST_RING_LEN(prbuf)) || (end >= MICRORL_HIST_RING_LEN(prbuf))) {
+        return microrlERRPAR;
+    }
+    prbuf->begin = begin;
+    prbuf->end = end;
+    memcpy(prbuf->ring_buf, data + 8, MICRORL_HIST_RING_LEN(prbuf));
+    prbuf->cur = 0;
+#if MICRORL_CFG_USE_HISTORY_INDEX
+    prbuf->index_begin = 0;
+    prbuf->count = 0;
+#endif /* MICRORL_CFG_USE_HISTORY_INDEX */
 
-        if (!(ind < limit)) {
-            return i;
-        }
+    // walk through records to check their lengths and build index
+    for (header = prbuf->begin; ; header = hist_next(prbuf, header)) {
+        size_t rec_len = hist_get_len(prbuf, header);
+        size_t line_len = rec_len;
 
-#if MICRORL_CFG_USE_QUOTING
-        if ((mrl->cmdline[ind] == '\'') || (mrl->cmdline[ind] == '"')) {
-            if (iq >= MICRORL_CFG_QUOTED_TOKEN_NMB) {
-                restore (mrl);
-                return -1;
+        if (header == prbuf->end) {
+#if MICRORL_CFG_USE_UTF8
+            if (rec_len == 0) {
+                return hist_check_utf8(prbuf);
             }
-            quote = mrl->cmdline[ind];
-            mrl->quotes[iq].begin = mrl->cmdline + ind;
-            ind++;
+#endif /* MICRORL_CFG_USE_UTF8 */
+            return (rec_len == 0) ? microrlOK : microrlERRPAR;
         }
-#endif /* MICRORL_CFG_USE_QUOTING */
-        tkn_arr[i++] = mrl->cmdline + ind;
-        if (i >= MICRORL_CFG_CMD_TOKEN_NMB) {
-#if MICRORL_CFG_USE_QUOTING
-            restore(mrl);
-#endif /* MICRORL_CFG_USE_QUOTING */
-            return -1;
+        total += MICRORL_CFG_HISTORY_HEADER_SIZE + rec_len;
+        if ((rec_len == 0) || (total > (MICRORL_HIST_RING_LEN(prbuf) - MICRORL_CFG_HISTORY_HEADER_SIZE))) {
+            return microrlERRPAR;
         }
-        // go to the first NOT whitespace (not zero for us)
-        while (ind < limit) {
-            if (mrl->cmdline[ind] == '\0') {
-#if MICRORL_CFG_USE_QUOTING
-                if (quote == '\0') {
-#endif /* MICRORL_CFG_USE_QUOTING */
-                    break;
-#if MICRORL_CFG_USE_QUOTING
-                }
-                mrl->cmdline[ind] = ' ';
-            } else if (mrl->cmdline[ind] == quote) {
-                if (mrl->cmdline[ind + 1] != '\0') {
-                    restore(mrl);
-                    return -1;
-                }
-                quote = 0;
-                mrl->quotes[iq++].end = mrl->cmdline + ind;
-                mrl->cmdline[ind++] = '\0';
+#if MICRORL_CFG_USE_HISTORY_COMPRESS
+        // the oldest record keeps whole line, others share a part of previous one
+        if ((rec_len < MICRORL_HIST_PREFIX_SIZE)
+            || (hist_get_len(prbuf, hist_offset(prbuf, header, MICRORL_CFG_HISTORY_HEADER_SIZE)) > prev_len)) {
+            return microrlERRPAR;
+        }
+        line_len = hist_line_len(prbuf, header);
+        prev_len = line_len;
+#endif /* MICRORL_CFG_USE_HISTORY_COMPRESS */
+        if (line_len >= line_size) {
+            return microrlERRPAR;
+        }
+#if MICRORL_CFG_USE_HISTORY_INDEX
+        if (prbuf->count >= MICRORL_CFG_HISTORY_INDEX_LEN) {
+            return microrlERRPAR;
+        }
+        prbuf->index[prbuf->count++] = header;
+#endif /* MICRORL_CFG_USE_HISTORY_INDEX */
+    }
+}
+
+/**
+ * \brief           Save lines from delta block to history
+ * \param[in,out]   prbuf: Pointer to \ref microrl_hist_rbuf_t structure
+ * \param[in]       data: Delta block data
+ * \param[in]       len: Delta block data length
+ * \param[in]       line_size: Command line buffer size, longer lines are rejected
+ * \return          \ref microrlOK on success, member of \ref microrlr_t otherwise
+ */
+static microrlr_t hist_import_delta(microrl_hist_rbuf_t* prbuf, const char* data, size_t len, size_t line_size) {
+    size_t pos = 0;
+
+    while (pos < len) {
+        size_t line_len;
+
+        if ((len - pos) < MICRORL_CFG_HISTORY_HEADER_SIZE) {
+            return microrlERRMEM;
+        }
+        line_len = hist_get_le(data + pos, MICRORL_CFG_HISTORY_HEADER_SIZE);
+        pos += MICRORL_CFG_HISTORY_HEADER_SIZE;
+        if ((line_len == 0) || (line_len >= line_size) || (line_len > (len - pos))) {
+            return microrlERRPAR;
+        }
+#if MICRORL_CFG_USE_UTF8
+        if (!utf8_valid(data + pos, line_len)) {
+            return microrlERRPAR;
+        }
+#endif /* MICRORL_CFG_USE_UTF8 */
+        hist_save_line(prbuf, data + pos, line_len);
+        pos += line_len;
+    }
+    return microrlOK;
+}
+
+/**
+ * \brief           Export whole history as snapshot block
+ *
+ * Block has \ref MICRORL_HIST_BLOCK_HDR_LEN bytes header: "mh" signature, version, block type,
+ * record format and 24 bit little-endian data length. Snapshot data is 32 bit little-endian
+ * begin and end positions followed by ring buffer. Starts new delta for \ref microrl_hist_export_delta
+ *
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       sink: Function to pass exported data to, called several times
+ */
+void microrl_hist_export(microrl_t* mrl, microrl_hist_sink_fn sink) {
+    microrl_hist_rbuf_t* prbuf = &mrl->ring_hist;
+    char hdr[MICRORL_HIST_BLOCK_HDR_LEN + 8];
+
+    hist_block_header(hdr, MICRORL_HIST_BLOCK_SNAPSHOT, 8 + MICRORL_HIST_RING_LEN(prbuf));
+    hist_put_le(hdr + MICRORL_HIST_BLOCK_HDR_LEN, prbuf->begin, 4);
+    hist_put_le(hdr + MICRORL_HIST_BLOCK_HDR_LEN + 4, prbuf->end, 4);
+    sink(mrl, hdr, sizeof(hdr));
+    sink(mrl, prbuf->ring_buf, MICRORL_HIST_RING_LEN(prbuf));
+    hist_checkpoint(prbuf);
+}
+
+/**
+ * \brief           Export lines saved after the last export as delta block
+ *
+ * Delta data is sequence of records: line length (_HISTORY_HEADER_SIZE bytes, little-endian)
+ * followed by line. Delta is appended to the previous export, so the whole export is
+ * written once and small deltas are added after it. Nothing is exported if there are
+ * no new lines. Starts new delta on success
+ *
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       sink: Function to pass exported data to, called several times
+ * \return          \ref microrlOK on success, \ref microrlERR if some new lines are removed
+ *                  from history already, use \ref microrl_hist_export then
+ */
+microrlr_t microrl_hist_export_delta(microrl_t* mrl, microrl_hist_sink_fn sink) {
+    microrl_hist_rbuf_t* prbuf = &mrl->ring_hist;
+    char line[MICRORL_CFG_CMDLINE_LEN];
+    char hdr[MICRORL_HIST_BLOCK_HDR_LEN];
+    size_t cnt, len = 0;
+
+    if (prbuf->unsaved_lost) {
+        return microrlERR;
+    }
+    if (prbuf->unsaved == 0) {
+        return microrlOK;
+    }
+    cnt = hist_record_count(prbuf);
+    for (size_t num = cnt - prbuf->unsaved; num < cnt; num++) {
+        len += MICRORL_CFG_HISTORY_HEADER_SIZE + hist_line_len(prbuf, hist_record_header(prbuf, num));
+    }
+    hist_block_header(hdr, MICRORL_HIST_BLOCK_DELTA, len);
+    sink(mrl, hdr, sizeof(hdr));
+    for (size_t num = cnt - prbuf->unsaved; num < cnt; num++) {
+        len = hist_copy_record(prbuf, num, line);
+        hist_put_le(hdr, len, MICRORL_CFG_HISTORY_HEADER_SIZE);
+        sink(mrl, hdr, MICRORL_CFG_HISTORY_HEADER_SIZE);
+        sink(mrl, line, len);
+    }
+    hist_checkpoint(prbuf);
+    return microrlOK;
+}
+
+/**
+ * \brief           Import history exported with \ref microrl_hist_export and \ref microrl_hist_export_delta
+ *
+ * Buffer contains blocks one after another, snapshot replaces whole history and delta adds
+ * lines to it. Import stops at the first byte that is not a block signature, so erased
+ * flash after the last block is allowed. History is cleared if snapshot is broken.
+ * With \ref MICRORL_CFG_USE_UTF8 lines with broken UTF-8 chars are not accepted
+ *
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       buf: Exported history
+ * \param[in]       len: Exported history length
+ * \return          \ref microrlOK on success, member of \ref microrlr_t otherwise
+ */
+microrlr_t microrl_hist_import(microrl_t* mrl, const char* buf, size_t len) {
+    microrl_hist_rbuf_t* prbuf = &mrl->ring_hist;
+    microrlr_t res = microrlOK;
+    size_t pos = 0;
+
+    while ((res == microrlOK) && ((len - pos) >= MICRORL_HIST_BLOCK_HDR_LEN)
+            && (buf[pos] == 'm') && (buf[pos + 1] == 'h')) {
+        const char* hdr = buf + pos;
+        size_t data_len = hist_get_le(hdr + 5, 3);
+
+        pos += MICRORL_HIST_BLOCK_HDR_LEN;
+        if ((hdr[2] != MICRORL_HIST_BLOCK_VERSION) || (hdr[4] != MICRORL_HIST_FORMAT)) {
+            res = microrlERRPAR;
+        } else if (data_len > (len - pos)) {
+            res = microrlERRMEM;
+        } else if (hdr[3] == MICRORL_HIST_BLOCK_SNAPSHOT) {
+            res = hist_import_snapshot(prbuf, buf + pos, data_len, MICRORL_CMDLINE_SIZE(mrl));
+            if (res != microrlOK) {
+#if MICRORL_CFG_USE_EXT_BUFFERS
+                char* ring_buf = prbuf->ring_buf;
+                size_t ring_len = prbuf->ring_len;
+
+                memset(ring_buf, 0, ring_len);
+                memset(prbuf, 0, sizeof(microrl_hist_rbuf_t));
+                prbuf->ring_buf = ring_buf;
+                prbuf->ring_len = ring_len;
+#else
+                memset(prbuf, 0, sizeof(microrl_hist_rbuf_t));
+#endif /* MICRORL_CFG_USE_EXT_BUFFERS */
+            }
+        } else if (hdr[3] == MICRORL_HIST_BLOCK_DELTA) {
+            res = hist_import_delta(prbuf, buf + pos, data_len, MICRORL_CMDLINE_SIZE(mrl));
+        } else {
+            res = microrlERRPAR;
+        }
+        pos += data_len;
+    }
+    hist_checkpoint(prbuf);
+    return res;
+}
+#endif /* MICRORL_CFG_USE_HISTORY_PERSIST || __DOXYGEN__ */
+#endif /* MICRORL_CFG_USE_HISTORY || __DOXYGEN__ */
+
+
+
+
+
+
+
+
+#if MICRORL_CFG_USE_TOKEN_INDEX || __DOXYGEN__
+/**
+ * \brief           Mark tokens from changed position of command line as outdated
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       pos: The first changed position
+ */
+static void tokens_invalidate(microrl_t* mrl, int pos) {
+    if (pos < mrl->tkn_dirty) {
+        mrl->tkn_dirty = pos;
+    }
+}
+
+/**
+ * \brief           Rescan tokens changed after the last scan. Tokens ended before
+ *                  the first changed position are kept
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ */
+static void tokens_update(microrl_t* mrl) {
+    int i = mrl->tkn_num;
+    int ind;
+    char quote;
+#if MICRORL_CFG_USE_QUOTING
+    int iq = 0;
+#endif /* MICRORL_CFG_USE_QUOTING */
+
+    if (mrl->tkn_dirty >= MICRORL_CFG_CMDLINE_LEN) {
+        return;
+    }
+    // token is kept, if its separator is not changed too
+    while ((i > 0) && (mrl->tkn_pos[i - 1] + mrl->tkn_len[i - 1] + (mrl->tkn_quote[i - 1] != '\0') >= mrl->tkn_dirty)) {
+        i--;
+    }
+    ind = (i > 0) ? (mrl->tkn_pos[i - 1] + mrl->tkn_len[i - 1] + (mrl->tkn_quote[i - 1] != '\0')) : 0;
+#if MICRORL_CFG_USE_QUOTING
+    for (int k = 0; k < i; ++k) {
+        iq += (mrl->tkn_quote[k] != '\0');
+    }
+#endif /* MICRORL_CFG_USE_QUOTING */
+
+    mrl->tkn_err_pos = -1;
+    while (1) {
+        // go to the first NOT whitespace (not zero for us)
+        while ((ind < mrl->cmdlen) && (mrl->cmdline[ind] == '\0')) {
+            ind++;
+        }
+        if (ind >= mrl->cmdlen) {
+            break;
+        }
+        if (i >= MICRORL_CFG_CMD_TOKEN_NMB - 1) {
+            mrl->tkn_err_pos = ind;
+            STATS_INC(mrl, tkn_overflows);
+            break;
+        }
+
+        quote = '\0';
+#if MICRORL_CFG_USE_QUOTING
+        if ((mrl->cmdline[ind] == '\'') || (mrl->cmdline[ind] == '"')) {
+            if (iq++ >= MICRORL_CFG_QUOTED_TOKEN_NMB) {
+                mrl->tkn_err_pos = ind;
+                STATS_INC(mrl, tkn_overflows);
+                break;
+            }
+            quote = mrl->cmdline[ind++];
+        }
+#endif /* MICRORL_CFG_USE_QUOTING */
+        mrl->tkn_pos[i] = ind;
+        mrl->tkn_quote[i] = quote;
+
+        // go to the first whitespace or end quote mark
+        while ((ind < mrl->cmdlen) && (quote ? (mrl->cmdline[ind] != quote) : (mrl->cmdline[ind] != '\0'))) {
+            ind++;
+        }
+        mrl->tkn_len[i] = ind - mrl->tkn_pos[i];
+        if (quote != '\0') {
+            if ((ind >= mrl->cmdlen) || ((ind + 1 < mrl->cmdlen) && (mrl->cmdline[ind + 1] != '\0'))) {
+                mrl->tkn_err_pos = mrl->tkn_pos[i] - 1;
+                break;
+            }
+            ind++;
+        }
+        i++;
+    }
+    mrl->tkn_num = i;
+    mrl->tkn_dirty = MICRORL_CFG_CMDLINE_LEN;
+}
+
+/**
+ * \brief           Get tokens array from token index
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       limit: Command line symbols limit
+ * \param[in]       tkn_arr: Tokens buffer stored split words
+ * \param[in]       buf: Buffer of \ref MICRORL_CFG_CMDLINE_LEN size for tokens
+ *                      which are not null-terminated in command line
+ * \return          Number of split tokens, -1 on error
+ */
+static int tokens_split(microrl_t* mrl, int limit, const char** tkn_arr, char* buf) {
+    int i;
+    int len;
+    int pos;
+
+    tokens_update(mrl);
+    if ((mrl->tkn_err_pos >= 0) && (mrl->tkn_err_pos < limit)) {
+        return -1;
+    }
+    for (i = 0; i < mrl->tkn_num; ++i) {
+        pos = mrl->tkn_pos[i];
+        len = mrl->tkn_len[i];
+        if (pos - (mrl->tkn_quote[i] != '\0') >= limit) {
+            break;
+        }
+        if (mrl->tkn_quote[i] != '\0') {
+            // end quote mark must be before limit
+            if (pos + len >= limit) {
+                return -1;
+            }
+        } else if (pos + len > limit) {
+            len = limit - pos;
+        }
+
+        if ((mrl->tkn_quote[i] == '\0') && (mrl->cmdline[pos + len] == '\0')) {
+            tkn_arr[i] = mrl->cmdline + pos;
+        } else {
+            // copy with spaces in place of zeros, which are only in quoted token
+            tkn_arr[i] = buf;
+            for (int k = 0; k < len; ++k) {
+                *buf++ = (mrl->cmdline[pos + k] == '\0') ? ' ' : mrl->cmdline[pos + k];
+            }
+            *buf++ = '\0';
+        }
+    }
+    return i;
+}
+#endif /* MICRORL_CFG_USE_TOKEN_INDEX || __DOXYGEN__ */
+
+#if MICRORL_USE_SPLIT_RESTORE || __DOXYGEN__
+/**
+ * \brief           Restore end quote marks in command line
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ */
+static void restore(microrl_t* mrl) {
+    size_t iq;
+    for (iq = 0; iq < MICRORL_CFG_QUOTED_TOKEN_NMB; ++iq) {
+        if (mrl->quotes[iq].end == 0) {
+            break;
+        }
+
+        *mrl->quotes[iq].end = *mrl->quotes[iq].begin;
+        mrl->quotes[iq].begin = 0;
+        mrl->quotes[iq].end = 0;
+    }
+}
+#endif /* MICRORL_USE_SPLIT_RESTORE || __DOXYGEN__ */
+
+#if !MICRORL_CFG_USE_TOKEN_INDEX || __DOXYGEN__
+/**
+ * \brief           Split command line to tokens array
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       limit: Command line symbols limit
+ * \param[in]       tkn_arr: Tokens buffer stored split words
+ * \return          Number of split tokens
+ */
+static int split(microrl_t* mrl, int limit, const char** tkn_arr) {
+    int i = 0;
+    int ind = 0;
+#if MICRORL_CFG_USE_QUOTING
+    int iq = 0;
+    char quote = 0;
+    for (iq = 0; iq < MICRORL_CFG_QUOTED_TOKEN_NMB; ++iq) {
+        mrl->quotes[iq].begin = 0;
+        mrl->quotes[iq].end = 0;
+    }
+    iq = 0;
+#endif /* MICRORL_CFG_USE_QUOTING */
+    while (1) {
+        // go to the first whitespace (zero for us)
+        while ((mrl->cmdline[ind] == '\0') && (ind < limit)) {
+            ind++;
+        }
+
+        if (!(ind < limit)) {
+            return i;
+        }
+
+#if MICRORL_CFG_USE_QUOTING
+        if ((mrl->cmdline[ind] == '\'') || (mrl->cmdline[ind] == '"')) {
+            if (iq >= MICRORL_CFG_QUOTED_TOKEN_NMB) {
+                restore (mrl);
+                STATS_INC(mrl, tkn_overflows);
+                return -1;
+            }
+            quote = mrl->cmdline[ind];
+            mrl->quotes[iq].begin = mrl->cmdline + ind;
+            ind++;
+        }
+#endif /* MICRORL_CFG_USE_QUOTING */
+        tkn_arr[i++] = mrl->cmdline + ind;
+        if (i >= MICRORL_CFG_CMD_TOKEN_NMB) {
+#if MICRORL_CFG_USE_QUOTING
+            restore(mrl);
+#endif /* MICRORL_CFG_USE_QUOTING */
+            STATS_INC(mrl, tkn_overflows);
+            return -1;
+        }
+        // go to the first NOT whitespace (not zero for us)
+        while (ind < limit) {
+            if (mrl->cmdline[ind] == '\0') {
+#if MICRORL_CFG_USE_QUOTING
+                if (quote == '\0') {
+#endif /* MICRORL_CFG_USE_QUOTING */
+                    break;
+#if MICRORL_CFG_USE_QUOTING
+                }
+                mrl->cmdline[ind] = ' ';
+            } else if (mrl->cmdline[ind] == quote) {
+                if (mrl->cmdline[ind + 1] != '\0') {
+                    restore(mrl);
+                    return -1;
+                }
+                quote = 0;
+                mrl->quotes[iq++].end = mrl->cmdline + ind;
+                mrl->cmdline[ind++] = '\0';
                 break;
 #endif /* MICRORL_CFG_USE_QUOTING */
             }
-            ind++;
+            ind++;
+        }
+        if (!(ind < limit)) {
+#if MICRORL_CFG_USE_QUOTING
+            if (quote != '\0') {
+                restore(mrl);
+                return -1;
+            }
+#endif /* MICRORL_CFG_USE_QUOTING */
+            return i;
+        }
+    }
+    return i;
+}
+#endif /* !MICRORL_CFG_USE_TOKEN_INDEX || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_UTF8 || __DOXYGEN__
+/**
+ * \brief           Mark display columns from changed position of command line as outdated.
+ *                  With \ref MICRORL_CFG_USE_SHADOW_LINE shown line is outdated from there too
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       pos: The first changed position
+ */
+static void colmap_invalidate(microrl_t* mrl, int pos) {
+    if (pos < mrl->col_valid) {
+        mrl->col_valid = pos;
+    }
+#if MICRORL_CFG_USE_SHADOW_LINE
+    if (pos < mrl->shadow_pos) {
+        mrl->shadow_pos = pos;
+    }
+#endif /* MICRORL_CFG_USE_SHADOW_LINE */
+}
+
+/**
+ * \brief           Get display column of command line position. Columns are kept in map
+ *                  and computed only after the last valid position, so after line edit
+ *                  only part of line from the first changed position is scanned once
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       pos: Position in command line, up to line length
+ * \return          Number of terminal columns taken by chars before position
+ */
+static int line_col(microrl_t* mrl, int pos) {
+    for (int i = mrl->col_valid; i < pos; i++) {
+        mrl->col_map[i + 1] = mrl->col_map[i] + !IS_UTF8_CONT(mrl->cmdline[i]);
+    }
+    if (pos > mrl->col_valid) {
+        mrl->col_valid = pos;
+    }
+    return mrl->col_map[pos];
+}
+
+#if MICRORL_CFG_USE_HSCROLL || __DOXYGEN__
+/**
+ * \brief           Get command line position of char shown in display column
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       col: Display column, up to number of line columns
+ * \return          Position of the first byte of char
+ */
+static int line_pos(microrl_t* mrl, int col) {
+    int lo = 0;
+    int hi = mrl->cmdlen;
+
+    line_col(mrl, hi);
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+
+        if (mrl->col_map[mid] < col) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    // column of continuation byte is counted after its char
+    while ((lo < mrl->cmdlen) && IS_UTF8_CONT(mrl->cmdline[lo])) {
+        lo++;
+    }
+    return lo;
+}
+#endif /* MICRORL_CFG_USE_HSCROLL || __DOXYGEN__ */
+
+/**
+ * \brief           Get position of the next char in command line
+ * \param[in]       mrl: \ref microrl_t working instance
+ * \param[in]       pos: Position of char, less than line length
+ * \return          Position after all bytes of char, char takes 4 bytes at most
+ */
+static int char_next(microrl_t* mrl, int pos) {
+    int end = pos + utf8_char_len(mrl->cmdline[pos]);
+
+    // stray continuation byte is a char of its own
+    do {
+        pos++;
+    } while ((pos < end) && (pos < mrl->cmdlen) && IS_UTF8_CONT(mrl->cmdline[pos]));
+    return pos;
+}
+
+/**
+ * \brief           Get position of the previous char in command line
+ * \param[in]       mrl: \ref microrl_t working instance
+ * \param[in]       pos: Position after char, greater than '0'
+ * \return          Position of the first byte of char
+ */
+static int char_prev(microrl_t* mrl, int pos) {
+    do {
+        pos--;
+    } while ((pos > 0) && IS_UTF8_CONT(mrl->cmdline[pos]));
+    return pos;
+}
+
+#if MICRORL_CFG_USE_SHADOW_LINE || MICRORL_CFG_USE_HISTORY_SEARCH || __DOXYGEN__
+/**
+ * \brief           Get number of terminal columns taken by UTF-8 text
+ * \param[in]       text: Text, not NULL-terminated
+ * \param[in]       len: Number of bytes of text
+ * \return          Number of columns
+ */
+static int text_cols(const char* text, int len) {
+    int cols = 0;
+
+    for (int i = 0; i < len; i++) {
+        cols += !IS_UTF8_CONT(text[i]);
+    }
+    return cols;
+}
+#endif /* MICRORL_CFG_USE_SHADOW_LINE || MICRORL_CFG_USE_HISTORY_SEARCH || __DOXYGEN__ */
+#endif /* MICRORL_CFG_USE_UTF8 || __DOXYGEN__ */
+
+/**
+ * \brief           Pass pending output from staging buffer to the terminal
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ */
+static void terminal_flush(microrl_t* mrl) {
+#if MICRORL_CFG_USE_OUTPUT_BUFFER
+    if (mrl->tx_len > 0) {
+#if MICRORL_CFG_USE_OUTPUT_BACKPRESSURE
+        if (mrl->try_write != NULL) {
+            size_t sent = mrl->try_write(mrl, mrl->tx_buf, mrl->tx_len);
+
+            if (sent > mrl->tx_len) {
+                sent = mrl->tx_len;
+            }
+            STATS_INC(mrl, out_calls);
+            STATS_ADD(mrl, out_bytes, sent);
+            mrl->tx_len -= sent;
+            memmove(mrl->tx_buf, mrl->tx_buf + sent, mrl->tx_len);
+            mrl->tx_stalled = mrl->tx_len > 0;
+            return;
+        }
+#endif /* MICRORL_CFG_USE_OUTPUT_BACKPRESSURE */
+        if (mrl->write != NULL) {
+            mrl->write(mrl, mrl->tx_buf, mrl->tx_len);
+        } else {
+            mrl->tx_buf[mrl->tx_len] = '\0';
+            mrl->print(mrl, mrl->tx_buf);
+        }
+        STATS_INC(mrl, out_calls);
+        STATS_ADD(mrl, out_bytes, mrl->tx_len);
+        mrl->tx_len = 0;
+    }
+#else
+    (void)mrl;
+#endif /* MICRORL_CFG_USE_OUTPUT_BUFFER */
+}
+
+/**
+ * \brief           Output len bytes of string to the terminal
+ * \note            Without \ref MICRORL_CFG_USE_OUTPUT_BUFFER string goes to print callback as is,
+ *                  so it must be NULL-terminated right after len bytes
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       str: String to output
+ * \param[in]       len: Length of string
+ */
+static void terminal_write(microrl_t* mrl, const char* str, size_t len) {
+#if MICRORL_CFG_USE_OUTPUT_BUFFER
+    while (len > 0) {
+        size_t part = MICRORL_CFG_OUTPUT_BUFFER_LEN - mrl->tx_len;
+
+        if (part == 0) {
+            terminal_flush(mrl);
+#if MICRORL_CFG_USE_OUTPUT_BACKPRESSURE
+            if (mrl->tx_len == MICRORL_CFG_OUTPUT_BUFFER_LEN) {
+                // Output is stalled and nothing is accepted, the rest is lost
+                mrl->tx_dropped += (uint32_t)len;
+                return;
+            }
+#endif /* MICRORL_CFG_USE_OUTPUT_BACKPRESSURE */
+            continue;
+        }
+        if (part > len) {
+            part = len;
+        }
+        memcpy(mrl->tx_buf + mrl->tx_len, str, part);
+        mrl->tx_len += part;
+        str += part;
+        len -= part;
+    }
+#else
+    (void)len;
+    mrl->print(mrl, str);
+    STATS_INC(mrl, out_calls);
+    STATS_ADD(mrl, out_bytes, len);
+#endif /* MICRORL_CFG_USE_OUTPUT_BUFFER */
+}
+
+/**
+ * \brief           Output NULL-terminated string to the terminal
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       str: String to output
+ */
+static void terminal_print(microrl_t* mrl, const char* str) {
+#if MICRORL_CFG_USE_OUTPUT_BUFFER
+    terminal_write(mrl, str, strlen(str));
+#else
+    mrl->print(mrl, str);
+    STATS_INC(mrl, out_calls);
+    STATS_ADD(mrl, out_bytes, strlen(str));
+#endif /* MICRORL_CFG_USE_OUTPUT_BUFFER */
+}
+
+#if MICRORL_CFG_USE_OUTPUT_BACKPRESSURE || __DOXYGEN__
+/**
+ * \brief           Check if line output must be deferred because terminal output is stalled.
+ *                  Line is marked for redraw then, which is done once output drains
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \return          '1' if line output is deferred, '0' otherwise
+ */
+static int line_deferred(microrl_t* mrl) {
+    if (mrl->tx_stalled && !IS_SEARCH_ACTIVE(mrl)) {
+        mrl->redraw_pending = 1;
+        return 1;
+    }
+    return 0;
+}
+#endif /* MICRORL_CFG_USE_OUTPUT_BACKPRESSURE || __DOXYGEN__ */
+
+/**
+ * \brief           Print default prompt defined in \ref MICRORL_CFG_PROMPT_STRING config
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ */
+inline static void print_prompt(microrl_t* mrl) {
+    terminal_print(mrl, mrl->prompt_str);
+#if MICRORL_CFG_USE_SHADOW_LINE
+    mrl->term_cursor = 0;
+#endif /* MICRORL_CFG_USE_SHADOW_LINE */
+}
+
+/**
+ * \brief           Clear last symbol in command line and move cursor
+ *                  to its position
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ */
+inline static void terminal_backspace(microrl_t* mrl) {
+#if MICRORL_CFG_USE_OUTPUT_BACKPRESSURE
+    if (line_deferred(mrl)) {
+        return;
+    }
+#endif /* MICRORL_CFG_USE_OUTPUT_BACKPRESSURE */
+    terminal_write(mrl, "\033[D \033[D", 7);
+#if MICRORL_CFG_USE_SHADOW_LINE && MICRORL_CFG_USE_UTF8
+    // shadow keeps shown bytes, remove all bytes of the last char
+    mrl->term_cursor--;
+    mrl->shadow_cols--;
+    do {
+        mrl->shadow_len--;
+    } while ((mrl->shadow_len > 0) && IS_UTF8_CONT(mrl->shadow[mrl->shadow_len]));
+#elif MICRORL_CFG_USE_SHADOW_LINE
+    mrl->shadow_len = --mrl->term_cursor;
+#endif /* MICRORL_CFG_USE_SHADOW_LINE && MICRORL_CFG_USE_UTF8 */
+}
+
+/* Decimal digits of numbers from 00 to 99 */
+static const char digit_pairs[201] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/**
+ * \brief           Convert number to decimal digits, two digits per step.
+ *                  Digits are written backwards, so no reverse pass is needed
+ * \param[in]       end: Position right after the last digit
+ * \param[in]       val: Number to convert
+ * \return          Position of the first digit
+ */
+static char* format_dec(char* end, unsigned long val) {
+    while (val >= 100) {
+        const char* pair = &digit_pairs[(val % 100) * 2];
+
+        val /= 100;
+        *--end = pair[1];
+        *--end = pair[0];
+    }
+    if (val >= 10) {
+        *--end = digit_pairs[val * 2 + 1];
+        *--end = digit_pairs[val * 2];
+    } else {
+        *--end = (char)('0' + val);
+    }
+    return end;
+}
+
+/**
+ * \brief           Set cursor at current position + offset (positive or negative)
+ *                  in string. The provided string must be at least 7 bytes long
+ * \param[in]       str: The original string before moving the cursor
+ * \param[in]       offset: Positive or negative interval to move cursor
+ * \return          The original string after moving the cursor
+ */
+static char * generate_move_cursor(char* str, int offset) {
+    char tmp_str[4];
+    char* num;
+    char c = 'C';
+    if (offset > 999) {
+        offset = 999;
+    }
+    if (offset < -999) {
+        offset = -999;
+    }
+    if (offset < 0) {
+        offset = -offset;
+        c = 'D';
+    } else if (offset == 0) {
+        *str = '\0';
+        return str;
+    }
+
+    *str++ = '\033';
+    *str++ = '[';
+    num = format_dec(tmp_str + sizeof(tmp_str), (unsigned long)offset);
+    while (num < (tmp_str + sizeof(tmp_str))) {
+        *str++ = *num++;
+    }
+    *str++ = c;
+    *str = '\0';
+    return str;
+}
+
+#if !MICRORL_CFG_USE_HSCROLL
+/**
+ * \brief           Set cursor at current position + offset (positive or negative)
+ *                  in terminal's command line
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       offset: Positive or negative interval to move cursor
+ */
+static void terminal_move_cursor(microrl_t* mrl, int offset) {
+    char str[16] = {0,};
+    if (offset != 0) {
+        char* endstr = generate_move_cursor(str, offset);
+        terminal_write(mrl, str, endstr - str);
+#if MICRORL_CFG_USE_SHADOW_LINE
+        mrl->term_cursor += offset;
+#endif /* MICRORL_CFG_USE_SHADOW_LINE */
+    }
+}
+#endif /* !MICRORL_CFG_USE_HSCROLL */
+
+/**
+ * \brief           Get char shown on terminal for command line position,
+ *                  whitespace for '\0' and '*' for password char.
+ *                  With \ref MICRORL_CFG_USE_UTF8 it is byte of char to show
+ * \param[in]       mrl: \ref microrl_t working instance
+ * \param[in]       pos: Position in command line
+ * \return          Char to show
+ */
+static char display_char(microrl_t* mrl, int pos) {
+    if (((pos + 1) >= mrl->start_password) && (mrl->echo == MICRORL_ECHO_ONCE)) {
+#if MICRORL_CFG_USE_UTF8
+        // one '*' for every char, '\0' for the rest bytes of char
+        if (IS_UTF8_CONT(mrl->cmdline[pos])) {
+            return '\0';
+        }
+#endif /* MICRORL_CFG_USE_UTF8 */
+        return '*';
+    }
+    return (mrl->cmdline[pos] == '\0') ? ' ' : mrl->cmdline[pos];
+}
+
+#if MICRORL_CFG_USE_SHADOW_LINE || __DOXYGEN__
+#if MICRORL_CFG_USE_HSCROLL || __DOXYGEN__
+/**
+ * \brief           Scroll view if cursor is out of it. Cursor is placed at the middle of view then
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ */
+static void view_scroll(microrl_t* mrl) {
+#if MICRORL_CFG_USE_UTF8
+    int len, cur, offset, right;
+
+    // line may be replaced, view starts at char boundary inside line
+    if (mrl->view_offset > mrl->cmdlen) {
+        mrl->view_offset = mrl->cmdlen;
+    }
+    while ((mrl->view_offset > 0) && IS_UTF8_CONT(mrl->cmdline[mrl->view_offset])) {
+        mrl->view_offset--;
+    }
+    len = LINE_COL(mrl, mrl->cmdlen);
+    cur = LINE_COL(mrl, mrl->cursor);
+    offset = LINE_COL(mrl, mrl->view_offset);
+#else
+    int len = mrl->cmdlen;
+    int cur = mrl->cursor;
+    int offset = mrl->view_offset;
+    int right;
+#endif /* MICRORL_CFG_USE_UTF8 */
+
+    right = offset + MICRORL_VIEW_WIDTH;
+
+    if (len > right) {
+        // '>' mark takes the last column
+        right -= 2;
+    }
+    if (len <= MICRORL_VIEW_WIDTH) {
+        mrl->view_offset = 0;
+    } else if (((offset > 0) && (cur <= offset)) || (cur > right)) {
+        offset = cur - MICRORL_VIEW_WIDTH / 2;
+        if (offset < 0) {
+            offset = 0;
+        }
+        mrl->view_offset = LINE_POS(mrl, offset);
+    }
+}
+#endif /* MICRORL_CFG_USE_HSCROLL || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_UTF8 || __DOXYGEN__
+/**
+ * \brief           Get number of bytes shown on terminal for part of command line,
+ *                  every password char is shown as one '*'
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       from: The first position of part
+ * \param[in]       to: Position after part
+ * \return          Number of shown bytes
+ */
+static int view_bytes(microrl_t* mrl, int from, int to) {
+    int password = to;
+
+    if (mrl->echo == MICRORL_ECHO_ONCE) {
+        // the first position shown by display_char() as '*'
+        password = mrl->start_password - 1;
+        if (password < from) {
+            password = from;
+        } else if (password > to) {
+            password = to;
+        }
+    }
+    return (password - from) + LINE_COL(mrl, to) - LINE_COL(mrl, password);
+}
+
+/**
+ * \brief           Get part of view which is shown on terminal already. Command line before
+ *                  \ref microrl_t::shadow_pos is shown unchanged, unless view is scrolled
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in,out]   pos: Position of char in the first column of view,
+ *                  changed to position of char in the first column to render
+ * \param[out]      col: Number of columns shown already
+ * \return          Number of bytes shown already
+ */
+static int view_shown(microrl_t* mrl, int* pos, int* col) {
+    int first = *pos;
+    int last = mrl->shadow_pos;
+    int limit = mrl->shadow_cols;
+    int len;
+
+#if MICRORL_CFG_USE_HSCROLL
+    // '>' mark in the last column shows up and goes away
+    if (limit > (MICRORL_VIEW_WIDTH - 1)) {
+        limit = MICRORL_VIEW_WIDTH - 1;
+    }
+#endif /* MICRORL_CFG_USE_HSCROLL */
+    if (last > mrl->cmdlen) {
+        last = mrl->cmdlen;
+    }
+    // line start is in column 0, without map lookup
+    *col = (last > first) ? (LINE_COL(mrl, last) - ((first > 0) ? LINE_COL(mrl, first) : 0)) : 0;
+    if (*col > limit) {
+#if MICRORL_CFG_USE_HSCROLL
+        *col = limit;
+        last = LINE_POS(mrl, LINE_COL(mrl, first) + limit);
+#else
+        *col = 0;
+#endif /* MICRORL_CFG_USE_HSCROLL */
+    }
+    if (*col == 0) {
+        return 0;
+    }
+    *pos = last;
+    len = view_bytes(mrl, first, last);
+#if MICRORL_CFG_USE_HSCROLL
+    if (first > 0) {
+        // the first column shows '<' mark
+        len -= view_bytes(mrl, first, char_next(mrl, first)) - 1;
+    }
+#endif /* MICRORL_CFG_USE_HSCROLL */
+    return len;
+}
+
+/**
+ * \brief           Get text shown on terminal after prompt, one char for every column.
+ *                  Columns before the first rendered one are left in buffer as is
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[out]      view: Buffer of \ref MICRORL_SHADOW_LEN bytes for text
+ * \param[in]       pos: Position of char in the first rendered column
+ * \param[in]       col: The first rendered column
+ * \param[in]       len: Number of bytes before the first rendered column
+ * \param[out]      cols: Number of columns taken by text
+ * \return          Number of bytes of text
+ */
+static int view_render(microrl_t* mrl, char* view, int pos, int col, int len, int* cols) {
+    int stop = mrl->cmdlen;
+#if MICRORL_CFG_USE_HSCROLL
+    int more = 0;
+
+    if ((col == 0) && (mrl->view_offset > 0) && (pos < stop)) {
+        view[len++] = '<';
+        pos = char_next(mrl, pos);
+        col++;
+    }
+    if ((LINE_COL(mrl, stop) - LINE_COL(mrl, pos) + col) > MICRORL_VIEW_WIDTH) {
+        // the last column shows '>' mark
+        more = 1;
+        stop = LINE_POS(mrl, LINE_COL(mrl, pos) + MICRORL_VIEW_WIDTH - 1 - col);
+    }
+    if ((stop - pos) > (MICRORL_SHADOW_LEN - len - more)) {
+        stop = pos + MICRORL_SHADOW_LEN - len - more;
+#else
+    if ((stop - pos) > (MICRORL_SHADOW_LEN - len)) {
+        stop = pos + MICRORL_SHADOW_LEN - len;
+#endif /* MICRORL_CFG_USE_HSCROLL */
+        // view is cut where shadow is full
+        while ((stop > pos) && IS_UTF8_CONT(mrl->cmdline[stop])) {
+            stop--;
+        }
+    }
+    *cols = col + LINE_COL(mrl, stop) - LINE_COL(mrl, pos);
+    if (mrl->echo == MICRORL_ECHO_ONCE) {
+        for (; pos < stop; pos++) {
+            char ch = display_char(mrl, pos);
+
+            if (ch != '\0') {
+                view[len++] = ch;
+            }
+        }
+    } else {
+        for (; pos < stop; pos++) {
+            view[len++] = (mrl->cmdline[pos] == '\0') ? ' ' : mrl->cmdline[pos];
+        }
+    }
+#if MICRORL_CFG_USE_HSCROLL
+    if (more) {
+        view[len++] = '>';
+        (*cols)++;
+    }
+#endif /* MICRORL_CFG_USE_HSCROLL */
+    return len;
+}
+
+/**
+ * \brief           Update terminal to show command line, print only chars which differ
+ *                  from shown ones and clear rest of line if new line is shorter.
+ *                  Shadow keeps shown bytes, changed part of them is widened to whole chars.
+ *                  Part of line shown unchanged is neither rendered nor compared
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ */
+static void terminal_redraw(microrl_t* mrl) {
+    char view[MICRORL_SHADOW_LEN];
+    char str[MICRORL_CFG_PRINT_BUFFER_LEN];
+    char* j = str;
+    int pos = 0;
+    int col = 0;
+    int skip = 0;
+    int clear = 1;
+    int cols, len, start, end;
+#if MICRORL_CFG_USE_HSCROLL
+    int offset = mrl->view_offset;
+    int cur;
+
+    view_scroll(mrl);
+    pos = mrl->view_offset;
+    cur = LINE_COL(mrl, mrl->cursor) - LINE_COL(mrl, pos);
+    if ((mrl->shadow_len >= 0) && (mrl->view_offset == offset)) {
+        skip = view_shown(mrl, &pos, &col);
+    }
+#else
+    int cur = LINE_COL(mrl, mrl->cursor);
+
+    if (mrl->shadow_len >= 0) {
+        skip = view_shown(mrl, &pos, &col);
+    }
+#endif /* MICRORL_CFG_USE_HSCROLL */
+    start = skip;
+    end = len = view_render(mrl, view, pos, col, skip, &cols);
+
+    if (mrl->shadow_len >= 0) {
+        while ((start < end) && (start < mrl->shadow_len) && (view[start] == mrl->shadow[start])) {
+            start++;
+        }
+        while ((start > 0) && (start < end) && IS_UTF8_CONT(view[start])) {
+            start--;
+        }
+        if ((len == mrl->shadow_len) && (cols == mrl->shadow_cols)) {
+            while ((end > start) && (view[end - 1] == mrl->shadow[end - 1])) {
+                end--;
+            }
+            while ((end < len) && IS_UTF8_CONT(view[end])) {
+                end++;
+            }
+        }
+        clear = cols < mrl->shadow_cols;
+    }
+
+    if ((start < end) || clear) {
+        col += text_cols(view + skip, start - skip);
+        j = generate_move_cursor(j, col - mrl->term_cursor);
+        for (int i = start; i < end; i++) {
+            mrl->shadow[i] = view[i];
+            *j++ = view[i];
+            if ((j - str) == (MICRORL_CFG_PRINT_BUFFER_LEN - 1)) {
+                *j = '\0';
+                terminal_write(mrl, str, j - str);
+                j = str;
+            }
+        }
+        mrl->term_cursor = (end == len) ? cols : (col + text_cols(view + start, end - start));
+        if (clear) {
+            if ((j - str + 3 + 1) > MICRORL_CFG_PRINT_BUFFER_LEN) {
+                *j = '\0';
+                terminal_write(mrl, str, j - str);
+                j = str;
+            }
+            *j++ = '\033';   // delete all past end of text
+            *j++ = '[';
+            *j++ = 'K';
+        }
+    }
+    mrl->shadow_len = len;
+    mrl->shadow_cols = cols;
+    mrl->shadow_pos = mrl->cmdlen;
+
+    if ((j - str + 6 + 1) > MICRORL_CFG_PRINT_BUFFER_LEN) {
+        *j = '\0';
+        terminal_write(mrl, str, j - str);
+        j = str;
+    }
+    j = generate_move_cursor(j, cur - mrl->term_cursor);
+    mrl->term_cursor = cur;
+    if (j != str) {
+        terminal_write(mrl, str, j - str);
+    }
+}
+#else
+/**
+ * \brief           Get char shown on terminal in column after prompt
+ * \param[in]       mrl: \ref microrl_t working instance
+ * \param[in]       col: Column after prompt
+ * \return          Char to show
+ */
+static char view_char(microrl_t* mrl, int col) {
+#if MICRORL_CFG_USE_HSCROLL
+    if ((col == 0) && (mrl->view_offset > 0)) {
+        return '<';
+    }
+    if ((col == (MICRORL_VIEW_WIDTH - 1)) && (mrl->cmdlen > (mrl->view_offset + MICRORL_VIEW_WIDTH))) {
+        return '>';
+    }
+    col += mrl->view_offset;
+#endif /* MICRORL_CFG_USE_HSCROLL */
+    return display_char(mrl, col);
+}
+
+/**
+ * \brief           Update terminal to show command line, print only chars which differ
+ *                  from shown ones and clear rest of line if new line is shorter
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ */
+static void terminal_redraw(microrl_t* mrl) {
+    char str[MICRORL_CFG_PRINT_BUFFER_LEN];
+    char* j = str;
+    int start = 0;
+    int clear = 1;
+#if MICRORL_CFG_USE_HSCROLL
+    int len, cur;
+
+    view_scroll(mrl);
+    len = mrl->cmdlen - mrl->view_offset;
+    if (len > MICRORL_VIEW_WIDTH) {
+        len = MICRORL_VIEW_WIDTH;
+    }
+    cur = mrl->cursor - mrl->view_offset;
+#else
+    int len = mrl->cmdlen;
+    int cur = mrl->cursor;
+#endif /* MICRORL_CFG_USE_HSCROLL */
+    int end = len;
+
+    if (mrl->shadow_len >= 0) {
+        while ((start < end) && (start < mrl->shadow_len) && (view_char(mrl, start) == mrl->shadow[start])) {
+            start++;
+        }
+        if (len == mrl->shadow_len) {
+            while ((end > start) && (view_char(mrl, end - 1) == mrl->shadow[end - 1])) {
+                end--;
+            }
+        }
+        clear = len < mrl->shadow_len;
+    }
+
+    if ((start < end) || clear) {
+        j = generate_move_cursor(j, start - mrl->term_cursor);
+        for (int i = start; i < end; i++) {
+            mrl->shadow[i] = view_char(mrl, i);
+            *j++ = mrl->shadow[i];
+            if ((j - str) == (MICRORL_CFG_PRINT_BUFFER_LEN - 1)) {
+                *j = '\0';
+                terminal_write(mrl, str, j - str);
+                j = str;
+            }
+        }
+        mrl->term_cursor = end;
+        if (clear) {
+            if ((j - str + 3 + 1) > MICRORL_CFG_PRINT_BUFFER_LEN) {
+                *j = '\0';
+                terminal_write(mrl, str, j - str);
+                j = str;
+            }
+            *j++ = '\033';   // delete all past end of text
+            *j++ = '[';
+            *j++ = 'K';
+        }
+    }
+    mrl->shadow_len = len;
+
+    if ((j - str + 6 + 1) > MICRORL_CFG_PRINT_BUFFER_LEN) {
+        *j = '\0';
+        terminal_write(mrl, str, j - str);
+        j = str;
+    }
+    j = generate_move_cursor(j, cur - mrl->term_cursor);
+    mrl->term_cursor = cur;
+    if (j != str) {
+        terminal_write(mrl, str, j - str);
+    }
+}
+#endif /* MICRORL_CFG_USE_UTF8 || __DOXYGEN__ */
+#endif /* MICRORL_CFG_USE_SHADOW_LINE || __DOXYGEN__ */
+
+/**
+ * \brief           Print command line to screen, replace '\0' to wihitespace
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       pos: Start position from which the line will be printed
+ * \param[in]       reset: Reset the cursor position
+ */
+static void terminal_print_line(microrl_t* mrl, int pos, int reset) {
+#if MICRORL_CFG_USE_SHADOW_LINE
+    (void)pos;
+    (void)reset;
+#if MICRORL_CFG_USE_OUTPUT_BACKPRESSURE
+    if (line_deferred(mrl)) {
+        return;
+    }
+#endif /* MICRORL_CFG_USE_OUTPUT_BACKPRESSURE */
+    if (mrl->echo != MICRORL_ECHO_OFF) {
+        terminal_redraw(mrl);
+    }
+#else
+    if (mrl->echo != MICRORL_ECHO_OFF) {
+        char str[MICRORL_CFG_PRINT_BUFFER_LEN];
+        char* j = str;
+
+        if (reset) {
+#if MICRORL_CFG_USE_CARRIAGE_RETURN
+            *j++ = '\r';
+            j = generate_move_cursor(j, MICRORL_CFG_PROMPT_LEN + LINE_COL(mrl, pos));
+#else
+            j = generate_move_cursor(j, -(MICRORL_CFG_CMDLINE_LEN + MICRORL_CFG_PROMPT_LEN + 2));
+            j = generate_move_cursor(j, MICRORL_CFG_PROMPT_LEN + LINE_COL(mrl, pos));
+#endif /* MICRORL_CFG_USE_CARRIAGE_RETURN */
+        }
+
+        for (int i = pos; i < mrl->cmdlen; i++) {
+            *j++ = (mrl->cmdline[i] == '\0') ? ' ' : mrl->cmdline[i];
+            if ((j - str) == (MICRORL_CFG_PRINT_BUFFER_LEN - 1)) {
+                *j = '\0';
+                terminal_write(mrl, str, j - str);
+                j = str;
+            }
+        }
+
+        if ((j - str + 3 + 6 + 1) > MICRORL_CFG_PRINT_BUFFER_LEN) {
+            *j = '\0';
+            terminal_write(mrl, str, j - str);
+            j = str;
+        }
+
+        *j++ = '\033';   // delete all past end of text
+        *j++ = '[';
+        *j++ = 'K';
+        j = generate_move_cursor(j, LINE_COL(mrl, mrl->cursor) - LINE_COL(mrl, mrl->cmdlen));
+        terminal_write(mrl, str, j - str);
+    }
+#endif /* MICRORL_CFG_USE_SHADOW_LINE */
+}
+
+/**
+ * \brief           Move input cursor in command line and on terminal
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       offset: Positive or negative interval to move cursor, in bytes of command line
+ */
+static void cursor_move(microrl_t* mrl, int offset) {
+#if MICRORL_CFG_USE_HSCROLL
+    mrl->cursor += offset;
+    // view scrolls when cursor leaves it
+    terminal_print_line(mrl, mrl->cursor, 0);
+#else
+    int col = LINE_COL(mrl, mrl->cursor);
+
+    mrl->cursor += offset;
+#if MICRORL_CFG_USE_OUTPUT_BACKPRESSURE
+    if (line_deferred(mrl)) {
+        return;
+    }
+#endif /* MICRORL_CFG_USE_OUTPUT_BACKPRESSURE */
+    terminal_move_cursor(mrl, LINE_COL(mrl, mrl->cursor) - col);
+#endif /* MICRORL_CFG_USE_HSCROLL */
+}
+
+/**
+ * \brief           Echo part of command line just inserted at the end of line,
+ *                  replace '\0' to whitespace and password chars to '*'
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       pos: Start position of inserted part
+ * \param[in]       len: Length of inserted part
+ */
+static void terminal_echo(microrl_t* mrl, int pos, int len) {
+#if MICRORL_CFG_USE_HSCROLL
+    // view scrolls when line gets longer
+    (void)len;
+    terminal_print_line(mrl, pos, 0);
+#else
+    char str[MICRORL_CFG_PRINT_BUFFER_LEN];
+    char* j = str;
+
+#if MICRORL_CFG_USE_OUTPUT_BACKPRESSURE
+    if (line_deferred(mrl)) {
+        return;
+    }
+#endif /* MICRORL_CFG_USE_OUTPUT_BACKPRESSURE */
+    for (int i = pos; i < (pos + len); i++) {
+        char ch = display_char(mrl, i);
+
+#if MICRORL_CFG_USE_UTF8
+        if (ch == '\0') {
+            continue;
+        }
+#if MICRORL_CFG_USE_SHADOW_LINE
+        mrl->shadow[mrl->shadow_len++] = ch;
+        mrl->shadow_cols += !IS_UTF8_CONT(ch);
+#endif /* MICRORL_CFG_USE_SHADOW_LINE */
+#elif MICRORL_CFG_USE_SHADOW_LINE
+        mrl->shadow[i] = ch;
+#endif /* MICRORL_CFG_USE_UTF8 */
+        *j++ = ch;
+        if ((j - str) == (MICRORL_CFG_PRINT_BUFFER_LEN - 1)) {
+            *j = '\0';
+            terminal_write(mrl, str, j - str);
+            j = str;
+        }
+    }
+    if (j != str) {
+        *j = '\0';
+        terminal_write(mrl, str, j - str);
+    }
+#if MICRORL_CFG_USE_SHADOW_LINE && MICRORL_CFG_USE_UTF8
+    mrl->term_cursor = LINE_COL(mrl, pos + len);
+#elif MICRORL_CFG_USE_SHADOW_LINE
+    mrl->shadow_len = pos + len;
+    mrl->term_cursor = pos + len;
+#endif /* MICRORL_CFG_USE_SHADOW_LINE && MICRORL_CFG_USE_UTF8 */
+#endif /* MICRORL_CFG_USE_HSCROLL */
+}
+
+#if MICRORL_CFG_USE_OUTPUT_BACKPRESSURE || __DOXYGEN__
+/**
+ * \brief           Redraw line deferred while output was stalled
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ */
+static void terminal_redraw_pending(microrl_t* mrl) {
+    if (mrl->redraw_pending && !IS_SEARCH_ACTIVE(mrl)) {
+        mrl->redraw_pending = 0;
+        if (mrl->echo != MICRORL_ECHO_OFF) {
+            terminal_redraw(mrl);
+        }
+    }
+}
+#endif /* MICRORL_CFG_USE_OUTPUT_BACKPRESSURE || __DOXYGEN__ */
+
+/**
+ * \brief           Pass pending output to the terminal at the end of input event
+ *
+ * With \ref MICRORL_CFG_USE_OUTPUT_BACKPRESSURE line is redrawn once to its current state,
+ * if its redraws were deferred and output is drained now
+ *
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ */
+static void terminal_sync(microrl_t* mrl) {
+    terminal_flush(mrl);
+#if MICRORL_CFG_USE_OUTPUT_BACKPRESSURE
+    if (!mrl->tx_stalled && mrl->redraw_pending) {
+        terminal_redraw_pending(mrl);
+        terminal_flush(mrl);
+    }
+#endif /* MICRORL_CFG_USE_OUTPUT_BACKPRESSURE */
+}
+
+/**
+ * \brief           Print end line symbol defined in \ref MICRORL_CFG_END_LINE config
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ */
+inline static void terminal_newline(microrl_t* mrl) {
+#if MICRORL_CFG_USE_OUTPUT_BACKPRESSURE
+    // Line must be shown in its final state before output below it
+    terminal_redraw_pending(mrl);
+#endif /* MICRORL_CFG_USE_OUTPUT_BACKPRESSURE */
+    terminal_write(mrl, MICRORL_CFG_END_LINE, sizeof(MICRORL_CFG_END_LINE) - 1);
+#if MICRORL_CFG_USE_SHADOW_LINE
+    mrl->shadow_len = 0;
+    mrl->term_cursor = 0;
+#if MICRORL_CFG_USE_UTF8
+    mrl->shadow_cols = 0;
+#endif /* MICRORL_CFG_USE_UTF8 */
+#endif /* MICRORL_CFG_USE_SHADOW_LINE */
+#if MICRORL_CFG_USE_HSCROLL
+    mrl->view_offset = 0;
+#endif /* MICRORL_CFG_USE_HSCROLL */
+}
+
+#if MICRORL_CFG_USE_PASTE_BURST || __DOXYGEN__
+/**
+ * \brief           Redraw line from the earliest dirty position, if there is one
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ */
+static void terminal_redraw_dirty(microrl_t* mrl) {
+    if (mrl->dirty_pos >= 0) {
+        int pos = mrl->dirty_pos;
+
+        mrl->dirty_pos = -1;
+        terminal_print_line(mrl, pos, 0);
+        STATS_INC(mrl, redraw_insert);
+    }
+}
+
+/**
+ * \brief           Detect paste burst for the input event being processed now
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       bulk: Input is a block of chars
+ */
+static void burst_detect(microrl_t* mrl, int bulk) {
+    mrl->burst = bulk;
+    if (mrl->get_time != NULL) {
+        uint32_t now = mrl->get_time(mrl);
+
+        if ((uint32_t)(now - mrl->last_input_time) < MICRORL_CFG_PASTE_BURST_TIME) {
+            mrl->burst = 1;
+        }
+        mrl->last_input_time = now;
+    }
+}
+#endif /* MICRORL_CFG_USE_PASTE_BURST || __DOXYGEN__ */
+
+/**
+ * \brief           Set initial state of MicroRL library data cleared before
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       print: Callback function for character output
+ */
+static void init_state(microrl_t* mrl, microrl_print_fn print) {
+    mrl->prompt_str = MICRORL_CFG_PROMPT_STRING;
+    mrl->print = print;
+#if MICRORL_CFG_ENABLE_INIT_PROMPT
+    print_prompt(mrl);
+    terminal_flush(mrl);
+#endif /* MICRORL_CFG_ENABLE_INIT_PROMPT */
+    mrl->echo = MICRORL_ECHO_ON;
+    mrl->start_password = -1;
+#if MICRORL_CFG_USE_PASTE_BURST
+    mrl->dirty_pos = -1;
+#endif /* MICRORL_CFG_USE_PASTE_BURST */
+#if MICRORL_CFG_USE_COMPLETE_CACHE
+    mrl->compl_key_len = -1;
+#endif /* MICRORL_CFG_USE_COMPLETE_CACHE */
+}
+
+#if !MICRORL_CFG_USE_EXT_BUFFERS || __DOXYGEN__
+/**
+ * \brief           Initialize MicroRL library data
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       print: Callback function for character output
+ * \return          \ref microrlOK on success, member of \ref microrlr_t otherwise
+ */
+microrlr_t microrl_init(microrl_t* mrl, microrl_print_fn print) {
+    memset(mrl, 0, sizeof(microrl_t));
+    init_state(mrl, print);
+
+    return microrlOK;
+}
+#endif /* !MICRORL_CFG_USE_EXT_BUFFERS || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_EXT_BUFFERS || __DOXYGEN__
+/**
+ * \brief           Initialize MicroRL library data with buffers provided by application.
+ *                  Buffers must stay valid while instance is used
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       print: Callback function for character output
+ * \param[in]       cmdline: Command line input buffer
+ * \param[in]       cmdline_len: Command line buffer size, \ref MICRORL_CFG_CMDLINE_LEN maximum.
+ *                      Last byte is used for NULL terminator
+ * \param[in]       hist_buf: History ring buffer, ignored if history is disabled
+ * \param[in]       hist_len: History ring buffer size, \ref MICRORL_CFG_RING_HISTORY_LEN maximum
+ * \return          \ref microrlOK on success, member of \ref microrlr_t otherwise
+ */
+microrlr_t microrl_init_ex(microrl_t* mrl, microrl_print_fn print, char* cmdline, size_t cmdline_len,
+                           char* hist_buf, size_t hist_len) {
+    if ((cmdline == NULL) || (cmdline_len < 2) || (cmdline_len > MICRORL_CFG_CMDLINE_LEN)) {
+        return microrlERRPAR;
+    }
+#if MICRORL_CFG_USE_HISTORY
+    // history must keep at least one char line with its header and end of records mark
+    if ((hist_buf == NULL) || (hist_len > MICRORL_CFG_RING_HISTORY_LEN)
+        || (hist_len < (2 * MICRORL_CFG_HISTORY_HEADER_SIZE + MICRORL_HIST_PREFIX_SIZE + 1))) {
+        return microrlERRPAR;
+    }
+#else
+    (void)hist_buf;
+    (void)hist_len;
+#endif /* MICRORL_CFG_USE_HISTORY */
+
+    memset(mrl, 0, sizeof(microrl_t));
+    memset(cmdline, 0, cmdline_len);
+    mrl->cmdline = cmdline;
+    mrl->cmdline_len = cmdline_len;
+#if MICRORL_CFG_USE_HISTORY
+    memset(hist_buf, 0, hist_len);
+    mrl->ring_hist.ring_buf = hist_buf;
+    mrl->ring_hist.ring_len = hist_len;
+#endif /* MICRORL_CFG_USE_HISTORY */
+    init_state(mrl, print);
+
+    return microrlOK;
+}
+#endif /* MICRORL_CFG_USE_EXT_BUFFERS || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_COMPLETE || __DOXYGEN__
+/**
+ * \brief           Set pointer to callback complition func, that called when user press 'Tab'
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       get_completion: Auto-complete string callback
+ */
+void microrl_set_complete_callback(microrl_t* mrl, microrl_get_compl_fn get_completion) {
+    mrl->get_completion = get_completion;
+}
+
+/**
+ * \brief           Set pointer to callback iterating complition variants one by one, that called
+ *                  when user press 'Tab'. It's used instead of complition func, if set
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       compl_iter: Auto-complete iterator callback
+ */
+void microrl_set_complete_iter_callback(microrl_t* mrl, microrl_compl_iter_fn compl_iter) {
+    mrl->compl_iter = compl_iter;
+}
+#endif /* MICRORL_CFG_USE_COMPLETE || __DOXYGEN__ */
+
+/**
+ * \brief           Pointer to callback func, that called when user press 'Enter'
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       execute: Command execute callback
+ */
+void microrl_set_execute_callback(microrl_t* mrl, microrl_exec_fn execute) {
+    mrl->execute = execute;
+}
+
+#if MICRORL_CFG_USE_COMMANDS || __DOXYGEN__
+/**
+ * \brief           Set table of commands to dispatch entered line and complete it.
+ *                  Lines which are not found in table are passed to execute callback
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       cmds: Table of top level commands sorted by name, NULL to disable registry
+ * \param[in]       num: Number of entries in table
+ */
+void microrl_set_commands(microrl_t* mrl, const microrl_cmd_t* cmds, size_t num) {
+    mrl->cmds = cmds;
+    mrl->cmds_num = num;
+}
+#endif /* MICRORL_CFG_USE_COMMANDS || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_OUTPUT_BUFFER || __DOXYGEN__
+/**
+ * \brief           Set callback for buffer output. When set, coalesced output is passed
+ *                  to it with explicit length instead of print callback
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       write: Buffer output callback
+ */
+void microrl_set_write_callback(microrl_t* mrl, microrl_write_fn write) {
+    mrl->write = write;
+}
+
+#if MICRORL_CFG_USE_OUTPUT_BACKPRESSURE || __DOXYGEN__
+/**
+ * \brief           Set callback for non-blocking output. When set, it is used instead of
+ *                  write and print callbacks, bytes it does not accept are kept in staging buffer.
+ *                  While output is stalled, command line redraws are collapsed to one
+ *                  redraw of its current state, done when output drains
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       try_write: Non-blocking output callback
+ */
+void microrl_set_try_write_callback(microrl_t* mrl, microrl_try_write_fn try_write) {
+    mrl->try_write = try_write;
+}
+#endif /* MICRORL_CFG_USE_OUTPUT_BACKPRESSURE || __DOXYGEN__ */
+
+/**
+ * \brief           Pass all pending output to the terminal
+ *
+ * Library flushes output itself at the end of each input event and before calling
+ * execute and Ctrl+C callbacks, so it is needed only in special cases.
+ * With non-blocking output callback call it when terminal link can accept data again
+ *
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ */
+void microrl_flush(microrl_t* mrl) {
+    terminal_sync(mrl);
+}
+#endif /* MICRORL_CFG_USE_OUTPUT_BUFFER || __DOXYGEN__ */
+
+#if MICRORL_USE_TIME || __DOXYGEN__
+/**
+ * \brief           Set callback for monotonic time, used to measure intervals between input events
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       get_time: Monotonic time callback
+ */
+void microrl_set_time_callback(microrl_t* mrl, microrl_get_time_fn get_time) {
+    mrl->get_time = get_time;
+    if (get_time != NULL) {
+        mrl->last_input_time = get_time(mrl);
+    }
+}
+#endif /* MICRORL_USE_TIME || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_CTRL_C || __DOXYGEN__
+/**
+ * \brief           Set callback for Ctrl+C terminal signal
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       sigint: Ctrl+C terminal signal callback
+ */
+void microrl_set_sigint_callback(microrl_t* mrl, microrl_sigint_fn sigint) {
+    mrl->sigint = sigint;
+}
+#endif /* MICRORL_CFG_USE_CTRL_C || __DOXYGEN__ */
+
+/**
+ * \brief           Set echo mode used to mask user input
+ *
+ * Use \ref MICRORL_ECHO_ONCE to disable echo for password input, echo mode will enabled after user press Enter.
+ * Use \ref MICRORL_ECHO_ON or \ref MICRORL_ECHO_OFF to turn on or off the echo manualy.
+ *
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       echo: Member of \ref microrl_echo_t enumeration
+ */
+void microrl_set_echo(microrl_t* mrl, microrl_echo_t echo) {
+    mrl->echo = echo;
+#if MICRORL_CFG_USE_SHADOW_LINE && MICRORL_CFG_USE_UTF8
+    // password chars may be shown in other way now
+    mrl->shadow_pos = 0;
+#endif /* MICRORL_CFG_USE_SHADOW_LINE && MICRORL_CFG_USE_UTF8 */
+}
+
+#if MICRORL_CFG_USE_STATS || __DOXYGEN__
+/**
+ * \brief           Get instance statistics
+ * \param[in]       mrl: \ref microrl_t working instance
+ * \param[out]      stats: Copy of statistics counters
+ */
+void microrl_get_stats(const microrl_t* mrl, microrl_stats_t* stats) {
+    *stats = mrl->stats;
+#if MICRORL_CFG_USE_HISTORY
+    stats->hist_evictions = mrl->ring_hist.evictions;
+#else
+    stats->hist_evictions = 0;
+#endif /* MICRORL_CFG_USE_HISTORY */
+}
+#endif /* MICRORL_CFG_USE_STATS || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_TRACE || __DOXYGEN__
+/**
+ * \brief           Set callback for trace of library functions
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       trace: Trace callback, NULL to stop tracing
+ * \param[in]       get_stamp: Time stamp callback, can be NULL
+ */
+void microrl_set_trace_callback(microrl_t* mrl, microrl_trace_fn trace, microrl_get_stamp_fn get_stamp) {
+    mrl->trace = trace;
+    mrl->get_stamp = get_stamp;
+}
+#endif /* MICRORL_CFG_USE_TRACE || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_HISTORY || __DOXYGEN__
+/**
+ * \brief           Restore record to command line from history buffer
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       dir: Member of \ref microrl_hist_dir_t enumeration
+ */
+static void hist_search(microrl_t* mrl, microrl_hist_dir_t dir) {
+    int len;
+
+    TRACE_ENTER(mrl, MICRORL_TRACE_HIST_SEARCH);
+    len = hist_restore_line(&mrl->ring_hist, mrl->cmdline, MICRORL_CMDLINE_SIZE(mrl), dir);
+    if (len >= 0) {
+        mrl->cmdline[len] = '\0';
+        mrl->cursor = mrl->cmdlen = len;
+#if MICRORL_CFG_USE_TOKEN_INDEX
+        tokens_invalidate(mrl, 0);
+#endif /* MICRORL_CFG_USE_TOKEN_INDEX */
+#if MICRORL_CFG_USE_UTF8
+        colmap_invalidate(mrl, 0);
+#endif /* MICRORL_CFG_USE_UTF8 */
+        terminal_print_line(mrl, 0, 1);
+        STATS_INC(mrl, redraw_history);
+    }
+    TRACE_LEAVE(mrl, MICRORL_TRACE_HIST_SEARCH);
+}
+#endif /* MICRORL_CFG_USE_HISTORY || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_HISTORY_SEARCH || __DOXYGEN__
+
+#define MICRORL_SEARCH_PROMPT               "(reverse-i-search)`"
+#define MICRORL_SEARCH_FAILED_PROMPT        "(failed reverse-i-search)`"
+#define MICRORL_SEARCH_DELIMITER            "': "
+
+/**
+ * \brief           Move cursor to the left margin of terminal line
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       cols: Max number of columns cursor can be away from the left margin
+ */
+static void terminal_line_start(microrl_t* mrl, int cols) {
+#if MICRORL_CFG_USE_CARRIAGE_RETURN
+    (void)cols;
+    terminal_write(mrl, "\r", 1);
+#else
+    terminal_move_cursor(mrl, -cols);
+#endif /* MICRORL_CFG_USE_CARRIAGE_RETURN */
+}
+
+/**
+ * \brief           Print text stored in command line format, replace '\0' to whitespace
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       text: Text to print
+ * \param[in]       len: Length of text
+ */
+static void terminal_print_text(microrl_t* mrl, const char* text, int len) {
+    char str[MICRORL_CFG_PRINT_BUFFER_LEN];
+    char* j = str;
+
+    for (int i = 0; i < len; i++) {
+        *j++ = (text[i] == '\0') ? ' ' : text[i];
+        if (((j - str) == (MICRORL_CFG_PRINT_BUFFER_LEN - 1)) || ((i + 1) == len)) {
+            *j = '\0';
+            terminal_write(mrl, str, j - str);
+            j = str;
+        }
+    }
+}
+
+/**
+ * \brief           Find the newest record with search pattern
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       count: Number of records to look through, starting from the oldest one
+ * \return          '1' if record found, '0' otherwise
+ */
+static int search_find(microrl_t* mrl, size_t count) {
+    char line[MICRORL_CFG_CMDLINE_LEN];
+
+    if (mrl->search_len == 0) {
+        return 0;
+    }
+    while (count-- > 0) {
+        int len = hist_copy_record(&mrl->ring_hist, count, line);
+        for (int i = 0; (i + mrl->search_len) <= len; i++) {
+            if (memcmp(line + i, mrl->search_pattern, mrl->search_len) == 0) {
+                mrl->search_match = count;
+                mrl->search_found = 1;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+#if MICRORL_CFG_USE_HSCROLL || __DOXYGEN__
+/**
+ * \brief           Print part of text stored in command line format which fits in given columns
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       text: Text to print
+ * \param[in]       len: Length of text
+ * \param[in]       cols: Max number of columns to print
+ * \return          Number of printed columns
+ */
+static int terminal_print_cols(microrl_t* mrl, const char* text, int len, int cols) {
+    int printed = 0;
+    int i = 0;
+
+    while ((i < len) && (printed < cols)) {
+#if MICRORL_CFG_USE_UTF8
+        do {
+            i++;
+        } while ((i < len) && IS_UTF8_CONT(text[i]));
+#else
+        i++;
+#endif /* MICRORL_CFG_USE_UTF8 */
+        printed++;
+    }
+    terminal_print_text(mrl, text, i);
+    return printed;
+}
+
+/**
+ * \brief           Print whole search line instead of command line. Line is cut to terminal width,
+ *                  the last column shows '>' mark then
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       cols: Max number of columns printed currently in line
+ */
+static void search_print(microrl_t* mrl, int cols) {
+    const char* prompt = mrl->search_failed ? MICRORL_SEARCH_FAILED_PROMPT : MICRORL_SEARCH_PROMPT;
+    int prompt_len = mrl->search_failed ? (sizeof(MICRORL_SEARCH_FAILED_PROMPT) - 1) : (sizeof(MICRORL_SEARCH_PROMPT) - 1);
+    int width = MICRORL_CFG_TERMINAL_WIDTH - 1;
+    char line[MICRORL_CFG_CMDLINE_LEN];
+    int len = 0;
+    int total, shown, head;
+
+    if (mrl->search_found) {
+        len = hist_copy_record(&mrl->ring_hist, mrl->search_match, line);
+    }
+#if MICRORL_CFG_USE_UTF8
+    total = text_cols(mrl->search_pattern, mrl->search_len) + text_cols(line, len);
+#else
+    total = mrl->search_len + len;
+#endif /* MICRORL_CFG_USE_UTF8 */
+    total += prompt_len + sizeof(MICRORL_SEARCH_DELIMITER) - 1;
+    if (total > width) {
+        width--;
+    }
+
+    terminal_line_start(mrl, cols);
+    shown = terminal_print_cols(mrl, prompt, prompt_len, width);
+    shown += terminal_print_cols(mrl, mrl->search_pattern, mrl->search_len, width - shown);
+    head = shown;
+    shown += terminal_print_cols(mrl, MICRORL_SEARCH_DELIMITER, sizeof(MICRORL_SEARCH_DELIMITER) - 1, width - shown);
+    shown += terminal_print_cols(mrl, line, len, width - shown);
+    if (total > width) {
+        terminal_write(mrl, ">", 1);
+        shown++;
+    }
+    terminal_write(mrl, "\033[K", 3);
+    mrl->search_tail = shown - head;
+}
+#else
+/**
+ * \brief           Print found record after search pattern and clear rest of line
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ */
+static void search_print_tail(microrl_t* mrl) {
+    char line[MICRORL_CFG_CMDLINE_LEN];
+    int len = 0;
+
+    terminal_write(mrl, MICRORL_SEARCH_DELIMITER, sizeof(MICRORL_SEARCH_DELIMITER) - 1);
+    if (mrl->search_found) {
+        len = hist_copy_record(&mrl->ring_hist, mrl->search_match, line);
+        terminal_print_text(mrl, line, len);
+    }
+    terminal_write(mrl, "\033[K", 3);
+#if MICRORL_CFG_USE_UTF8
+    len = text_cols(line, len);
+#endif /* MICRORL_CFG_USE_UTF8 */
+    mrl->search_tail = sizeof(MICRORL_SEARCH_DELIMITER) - 1 + len;
+}
+
+/**
+ * \brief           Print whole search line instead of command line
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       cols: Max number of columns printed currently in line
+ */
+static void search_print(microrl_t* mrl, int cols) {
+    terminal_line_start(mrl, cols);
+    if (mrl->search_failed) {
+        terminal_print(mrl, MICRORL_SEARCH_FAILED_PROMPT);
+    } else {
+        terminal_print(mrl, MICRORL_SEARCH_PROMPT);
+    }
+    terminal_print_text(mrl, mrl->search_pattern, mrl->search_len);
+    search_print_tail(mrl);
+}
+#endif /* MICRORL_CFG_USE_HSCROLL || __DOXYGEN__ */
+
+/**
+ * \brief           Search record for changed pattern and update search line
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       count: Number of records to look through, starting from the oldest one
+ * \param[in]       removed: '1' if last pattern char was removed, '0' if char was added
+ */
+static void search_update(microrl_t* mrl, size_t count, int removed) {
+    char failed = (search_find(mrl, count) == 0) && (mrl->search_len > 0);
+
+#if MICRORL_CFG_USE_HSCROLL
+    // line may be cut anywhere, it is printed again
+    (void)removed;
+    mrl->search_failed = failed;
+    search_print(mrl, sizeof(MICRORL_SEARCH_FAILED_PROMPT) + MICRORL_CFG_HISTORY_SEARCH_LEN + mrl->search_tail);
+#else
+    if (failed != mrl->search_failed) {
+        mrl->search_failed = failed;
+        search_print(mrl, sizeof(MICRORL_SEARCH_FAILED_PROMPT) + MICRORL_CFG_HISTORY_SEARCH_LEN + mrl->search_tail);
+    } else {
+        terminal_move_cursor(mrl, -(mrl->search_tail + removed));
+        if (!removed) {
+            terminal_print_text(mrl, mrl->search_pattern + mrl->search_len - 1, 1);
+        }
+        search_print_tail(mrl);
+    }
+#endif /* MICRORL_CFG_USE_HSCROLL */
+}
+
+/**
+ * \brief           Finish reverse history search and print command line
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       accept: '1' to take found record to command line, '0' to keep command line
+ */
+static void search_finish(microrl_t* mrl, int accept) {
+    mrl->search_active = 0;
+    if (accept && mrl->search_found) {
+        microrl_hist_rbuf_t* prbuf = &mrl->ring_hist;
+
+        memset(mrl->cmdline, 0, MICRORL_CMDLINE_SIZE(mrl));
+        mrl->cmdlen = hist_copy_record(prbuf, mrl->search_match, mrl->cmdline);
+        mrl->cursor = mrl->cmdlen;
+        prbuf->cur = hist_record_count(prbuf) - mrl->search_match;
+#if MICRORL_CFG_USE_TOKEN_INDEX
+        tokens_invalidate(mrl, 0);
+#endif /* MICRORL_CFG_USE_TOKEN_INDEX */
+#if MICRORL_CFG_USE_UTF8
+        colmap_invalidate(mrl, 0);
+#endif /* MICRORL_CFG_USE_UTF8 */
+    }
+    terminal_line_start(mrl, sizeof(MICRORL_SEARCH_FAILED_PROMPT) + MICRORL_CFG_HISTORY_SEARCH_LEN + mrl->search_tail);
+    print_prompt(mrl);
+    terminal_print_line(mrl, 0, 0);
+}
+
+/**
+ * \brief           Handle input char during reverse history search
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       ch: Input character
+ * \return          '1' if char is processed, '0' if search is finished and char must be processed as usual
+ */
+static int search_process(microrl_t* mrl, int ch) {
+    switch (ch) {
+        case MICRORL_KEY_DC2: { // ^R, search older record
+            if (mrl->search_found && !mrl->search_failed) {
+                if (search_find(mrl, mrl->search_match)) {
+#if MICRORL_CFG_USE_HSCROLL
+                    search_print(mrl, sizeof(MICRORL_SEARCH_FAILED_PROMPT) + MICRORL_CFG_HISTORY_SEARCH_LEN + mrl->search_tail);
+#else
+                    terminal_move_cursor(mrl, -mrl->search_tail);
+                    search_print_tail(mrl);
+#endif /* MICRORL_CFG_USE_HSCROLL */
+                } else {
+                    mrl->search_failed = 1;
+                    search_print(mrl, sizeof(MICRORL_SEARCH_FAILED_PROMPT) + MICRORL_CFG_HISTORY_SEARCH_LEN + mrl->search_tail);
+                }
+            }
+            return 1;
+        }
+        case MICRORL_KEY_DEL:
+        case MICRORL_KEY_BS: {
+            if (mrl->search_len > 0) {
+                mrl->search_len--;
+#if MICRORL_CFG_USE_UTF8
+                // the whole char is removed, it takes one column
+                while ((mrl->search_len > 0) && IS_UTF8_CONT(mrl->search_pattern[mrl->search_len])) {
+                    mrl->search_len--;
+                }
+#endif /* MICRORL_CFG_USE_UTF8 */
+                mrl->search_found = 0;
+                search_update(mrl, hist_record_count(&mrl->ring_hist), 1);
+            }
+            return 1;
+        }
+        case MICRORL_KEY_BEL:   // ^G
+        case MICRORL_KEY_ETX: { // ^C
+            search_finish(mrl, 0);
+            return 1;
+        }
+        default: {
+            if (IS_PRINTABLE_CHAR(ch)) {
+                if (mrl->search_len < MICRORL_CFG_HISTORY_SEARCH_LEN) {
+                    size_t count = hist_record_count(&mrl->ring_hist);
+                    if (mrl->search_found) {
+                        count = mrl->search_match + 1;
+                    }
+                    mrl->search_pattern[mrl->search_len++] = (ch == ' ') ? '\0' : ch;
+                    search_update(mrl, count, 0);
+                }
+                return 1;
+            }
+            search_finish(mrl, 1);
+            return 0;
+        }
+    }
+}
+
+/**
+ * \brief           Start reverse history search
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ */
+static void search_start(microrl_t* mrl) {
+#if MICRORL_CFG_USE_SHADOW_LINE
+    mrl->shadow_len = -1;
+#endif /* MICRORL_CFG_USE_SHADOW_LINE */
+    mrl->search_active = 1;
+    mrl->search_len = 0;
+    mrl->search_found = 0;
+    mrl->search_failed = 0;
+    search_print(mrl, MICRORL_CFG_CMDLINE_LEN + MICRORL_CFG_PROMPT_LEN + 2);
+}
+#endif /* MICRORL_CFG_USE_HISTORY_SEARCH || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_LOG || __DOXYGEN__
+/**
+ * \brief           End log text with end line symbol, if it is not ended yet
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ */
+static void log_end(microrl_t* mrl) {
+    if (mrl->log_active) {
+        mrl->log_active = 0;
+        if (!mrl->log_eol) {
+            terminal_newline(mrl);
+        }
+    }
+}
+
+/**
+ * \brief           Finish log output and print prompt and command line again
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ */
+static void log_finish(microrl_t* mrl) {
+    if (!mrl->log_active) {
+        return;
+    }
+    log_end(mrl);
+    if (IS_EXEC_PENDING(mrl)) {
+        // Prompt is printed when command is done
+        return;
+    }
+#if MICRORL_CFG_USE_SHADOW_LINE
+    mrl->shadow_len = 0;
+#if MICRORL_CFG_USE_UTF8
+    mrl->shadow_cols = 0;
+#endif /* MICRORL_CFG_USE_UTF8 */
+#endif /* MICRORL_CFG_USE_SHADOW_LINE */
+#if MICRORL_CFG_USE_HISTORY_SEARCH
+    if (IS_SEARCH_ACTIVE(mrl)) {
+        search_print(mrl, 0);
+        return;
+    }
+#endif /* MICRORL_CFG_USE_HISTORY_SEARCH */
+    print_prompt(mrl);
+#if MICRORL_CFG_USE_PASTE_BURST
+    mrl->dirty_pos = -1;
+#endif /* MICRORL_CFG_USE_PASTE_BURST */
+    terminal_print_line(mrl, 0, 0);
+}
+
+/**
+ * \brief           Print log text above command line
+ *
+ * Prompt and command line are erased before the first log text, and printed again
+ * by \ref microrl_tick or next input. Log text of all calls made between them is
+ * printed with one erase and one redraw. Lines of log text should end with
+ * \ref MICRORL_CFG_END_LINE. Call it from the same thread as other
+ * functions of instance, log from other contexts must be queued by application
+ *
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       buf: Log text, not NULL-terminated
+ * \param[in]       len: Length of log text
+ */
+void microrl_log(microrl_t* mrl, const char* buf, size_t len) {
+    if (len == 0) {
+        return;
+    }
+    mrl->log_eol = buf[len - 1] == '\n';
+    if (!mrl->log_active) {
+        mrl->log_active = 1;
+        if (!IS_EXEC_PENDING(mrl)) {
+#if MICRORL_CFG_USE_CARRIAGE_RETURN
+            terminal_write(mrl, "\r\033[K", 4);
+#else
+            char str[16];
+            int cols = MICRORL_CFG_CMDLINE_LEN + MICRORL_CFG_PROMPT_LEN + 2;
+            char* j;
+
+#if MICRORL_CFG_USE_HISTORY_SEARCH
+            if (IS_SEARCH_ACTIVE(mrl)) {
+                cols = sizeof(MICRORL_SEARCH_FAILED_PROMPT) + MICRORL_CFG_HISTORY_SEARCH_LEN + mrl->search_tail;
+            }
+#endif /* MICRORL_CFG_USE_HISTORY_SEARCH */
+            j = generate_move_cursor(str, -cols);
+            *j++ = '\033';
+            *j++ = '[';
+            *j++ = 'K';
+            *j = '\0';
+            terminal_write(mrl, str, j - str);
+#endif /* MICRORL_CFG_USE_CARRIAGE_RETURN */
+        }
+    }
+#if MICRORL_CFG_USE_OUTPUT_BUFFER
+    terminal_write(mrl, buf, len);
+#else
+    // Print callback needs NULL-terminated string
+    while (len > 0) {
+        char str[MICRORL_CFG_PRINT_BUFFER_LEN];
+        size_t part = (len < (sizeof(str) - 1)) ? len : (sizeof(str) - 1);
+
+        memcpy(str, buf, part);
+        str[part] = '\0';
+        terminal_write(mrl, str, part);
+        buf += part;
+        len -= part;
+    }
+#endif /* MICRORL_CFG_USE_OUTPUT_BUFFER */
+}
+#endif /* MICRORL_CFG_USE_LOG || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_PRINTF || __DOXYGEN__
+/* Maximum number of decimal or hexadecimal digits of unsigned long */
+#define MICRORL_NUM_LEN                     (sizeof(unsigned long) * 3)
+
+/**
+ * \brief           Output of formatted print. Without \ref MICRORL_CFG_USE_OUTPUT_BUFFER text
+ *                  is collected in print buffer, because print callback needs NULL-terminated string
+ */
+typedef struct {
+    microrl_t* mrl;                             /*!< Working instance */
+    int count;                                  /*!< Number of printed chars */
+#if !MICRORL_CFG_USE_OUTPUT_BUFFER || __DOXYGEN__
+    size_t len;                                 /*!< Number of chars in print buffer */
+    char buf[MICRORL_CFG_PRINT_BUFFER_LEN];     /*!< Print buffer */
+#endif /* !MICRORL_CFG_USE_OUTPUT_BUFFER || __DOXYGEN__ */
+} microrl_printf_out_t;
+
+/**
+ * \brief           Pass collected text of formatted print to the terminal
+ * \param[in,out]   out: Output of formatted print
+ */
+static void printf_flush(microrl_printf_out_t* out) {
+#if MICRORL_CFG_USE_OUTPUT_BUFFER
+    (void)out;
+#else
+    if (out->len > 0) {
+        out->buf[out->len] = '\0';
+        terminal_print(out->mrl, out->buf);
+        out->len = 0;
+    }
+#endif /* MICRORL_CFG_USE_OUTPUT_BUFFER */
+}
+
+/**
+ * \brief           Output chars of formatted print
+ * \param[in,out]   out: Output of formatted print
+ * \param[in]       str: Chars to output, not NULL-terminated
+ * \param[in]       len: Number of chars
+ */
+static void printf_write(microrl_printf_out_t* out, const char* str, size_t len) {
+    out->count += (int)len;
+#if MICRORL_CFG_USE_OUTPUT_BUFFER
+    terminal_write(out->mrl, str, len);
+#else
+    while (len > 0) {
+        size_t part = sizeof(out->buf) - 1 - out->len;
+
+        if (part == 0) {
+            printf_flush(out);
+            continue;
+        }
+        if (part > len) {
+            part = len;
+        }
+        memcpy(out->buf + out->len, str, part);
+        out->len += part;
+        str += part;
+        len -= part;
+    }
+#endif /* MICRORL_CFG_USE_OUTPUT_BUFFER */
+}
+
+/**
+ * \brief           Output field of formatted print padded to width
+ * \param[in,out]   out: Output of formatted print
+ * \param[in]       str: Field chars, not NULL-terminated
+ * \param[in]       len: Number of field chars
+ * \param[in]       width: Minimum field width
+ * \param[in]       pad: Pad char, '0' pads number after its sign, ' ' before it
+ * \param[in]       left: Field is aligned to the left and padded with spaces after it
+ */
+static void printf_field(microrl_printf_out_t* out, const char* str, size_t len, int width, char pad, int left) {
+    int fill = width - (int)len;
+
+    if ((pad == '0') && (len > 0) && (*str == '-')) {
+        printf_write(out, str++, 1);
+        len--;
+    }
+    while (!left && (fill-- > 0)) {
+        printf_write(out, &pad, 1);
+    }
+    printf_write(out, str, len);
+    while (left && (fill-- > 0)) {
+        printf_write(out, " ", 1);
+    }
+}
+
+/**
+ * \brief           Print formatted text to the terminal
+ *
+ * Supports subset of printf format: `%[-][0][width][l]type`, where type is one of
+ * `d`, `i`, `u`, `x`, `X`, `c`, `s` and `%`. Other conversions are printed as is.
+ * Numbers are converted without libc and text goes to output staging buffer directly
+ * with \ref MICRORL_CFG_USE_OUTPUT_BUFFER, so it is passed to the terminal with other output
+ * of input event. Call \ref microrl_flush after print done outside of library callbacks
+ *
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       fmt: Format string
+ * \return          Number of printed chars
+ */
+int microrl_printf(microrl_t* mrl, const char* fmt, ...) {
+    microrl_printf_out_t out;
+    va_list args;
+
+    out.mrl = mrl;
+    out.count = 0;
+#if !MICRORL_CFG_USE_OUTPUT_BUFFER
+    out.len = 0;
+#endif /* !MICRORL_CFG_USE_OUTPUT_BUFFER */
+    va_start(args, fmt);
+    while (*fmt != '\0') {
+        char num[MICRORL_NUM_LEN + 1];
+        char* end = num + sizeof(num);
+        char* pos = end;
+        const char* spec = fmt;
+        const char* str;
+        size_t len;
+        int width = 0;
+        int left = 0;
+        int is_long = 0;
+        char pad = ' ';
+
+        while ((*fmt != '\0') && (*fmt != '%')) {
+            fmt++;
+        }
+        if (fmt > spec) {
+            printf_write(&out, spec, fmt - spec);
+            continue;
+        }
+        for (fmt++; (*fmt == '-') || (*fmt == '0'); fmt++) {
+            if (*fmt == '-') {
+                left = 1;
+            } else {
+                pad = '0';
+            }
+        }
+        while ((*fmt >= '0') && (*fmt <= '9')) {
+            width = width * 10 + (*fmt++ - '0');
+        }
+        if (*fmt == 'l') {
+            is_long = 1;
+            fmt++;
+        }
+        switch (*fmt) {
+            case 'd':
+            case 'i': {
+                long val = is_long ? va_arg(args, long) : va_arg(args, int);
+
+                pos = format_dec(end, (val < 0) ? (0UL - (unsigned long)val) : (unsigned long)val);
+                if (val < 0) {
+                    *--pos = '-';
+                }
+                break;
+            }
+            case 'u': {
+                pos = format_dec(end, is_long ? va_arg(args, unsigned long) : va_arg(args, unsigned int));
+                break;
+            }
+            case 'x':
+            case 'X': {
+                const char* digits = (*fmt == 'x') ? "0123456789abcdef" : "0123456789ABCDEF";
+                unsigned long val = is_long ? va_arg(args, unsigned long) : va_arg(args, unsigned int);
+
+                do {
+                    *--pos = digits[val & 0x0F];
+                    val >>= 4;
+                } while (val != 0);
+                break;
+            }
+            case 'c': {
+                *--pos = (char)va_arg(args, int);
+                pad = ' ';
+                break;
+            }
+            case 's': {
+                str = va_arg(args, const char*);
+                if (str == NULL) {
+                    str = "(null)";
+                }
+                printf_field(&out, str, strlen(str), width, ' ', left);
+                fmt++;
+                continue;
+            }
+            case '\0': {
+                // format is ended by '%'
+                printf_write(&out, spec, fmt - spec);
+                continue;
+            }
+            default: {
+                // '%' and unsupported conversions are printed as is
+                if ((*fmt == '%') && (fmt == (spec + 1))) {
+                    spec++;
+                }
+                printf_write(&out, spec, fmt + 1 - spec);
+                fmt++;
+                continue;
+            }
+        }
+        len = end - pos;
+        printf_field(&out, pos, len, width, left ? ' ' : pad, left);
+        fmt++;
+    }
+    va_end(args);
+    printf_flush(&out);
+    return out.count;
+}
+#endif /* MICRORL_CFG_USE_PRINTF || __DOXYGEN__ */
+
+/**
+ * \brief           Insert len char of text at cursor position
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       text: Record to store in cmdline of \ref microrl_t
+ * \param[in]       len: Length of text to store
+ * \return          \ref microrlOK on success, \ref microrlERR if text doesn't fit in command line
+ *                  or, with \ref MICRORL_CFG_USE_UTF8, it has broken UTF-8 chars
+ */
+microrlr_t microrl_insert_text(microrl_t* mrl, const char* text, int len) {
+#if MICRORL_CFG_USE_UTF8
+    if (!utf8_valid(text, len)) {
+        return microrlERR;
+    }
+#endif /* MICRORL_CFG_USE_UTF8 */
+    if ((mrl->cmdlen + len) < MICRORL_CMDLINE_SIZE(mrl)) {
+        char* ins = mrl->cmdline + mrl->cursor;
+        char* end = ins + len;
+
+        if ((mrl->echo == MICRORL_ECHO_ONCE) & (mrl->start_password == -1)) {
+            mrl->start_password = mrl->cmdlen;
+        }
+        memmove(end, ins, mrl->cmdlen - mrl->cursor);
+        memcpy(ins, text, len);
+#if MICRORL_CFG_USE_TOKEN_INDEX
+        tokens_invalidate(mrl, mrl->cursor);
+#endif /* MICRORL_CFG_USE_TOKEN_INDEX */
+#if MICRORL_CFG_USE_UTF8
+        colmap_invalidate(mrl, mrl->cursor);
+#endif /* MICRORL_CFG_USE_UTF8 */
+        while ((ins = memchr(ins, ' ', end - ins)) != NULL) {
+            *ins++ = '\0';
+        }
+        mrl->cursor += len;
+        mrl->cmdlen += len;
+        mrl->cmdline[mrl->cmdlen] = '\0';
+        return microrlOK;
+    }
+    return microrlERR;
+}
+
+/**
+ * \brief           Insert run of printable chars at cursor position and echo it
+ *
+ * Leading whitespaces on empty line are skipped, chars which don't fit
+ * in command line are dropped, like it does for every char separately.
+ * During paste burst line isn't redrawn, only dirty position is updated.
+ *
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       text: Printable chars to insert
+ * \param[in]       len: Number of chars
+ */
+static void insert_printable(microrl_t* mrl, const char* text, int len) {
+    int pos = mrl->cursor;
+
+    mrl->last_endl = 0;
+    if (mrl->cmdlen == 0) {
+        while ((len > 0) && (*text == ' ')) {
+            text++;
+            len--;
+        }
+    }
+    if (len > (MICRORL_CMDLINE_SIZE(mrl) - 1 - mrl->cmdlen)) {
+        len = MICRORL_CMDLINE_SIZE(mrl) - 1 - mrl->cmdlen;
+#if MICRORL_CFG_USE_UTF8
+        // char which doesn't fit is dropped whole
+        while ((len > 0) && IS_UTF8_CONT(text[len])) {
+            len--;
+        }
+#endif /* MICRORL_CFG_USE_UTF8 */
+    }
+    if ((len > 0) && (microrl_insert_text(mrl, text, len) == microrlOK)) {
+#if MICRORL_CFG_USE_PASTE_BURST
+        if ((mrl->dirty_pos >= 0) || (mrl->burst && (mrl->cursor != mrl->cmdlen))) {
+            if ((mrl->dirty_pos < 0) || (pos < mrl->dirty_pos)) {
+                mrl->dirty_pos = pos;
+            }
+            return;
+        }
+#endif /* MICRORL_CFG_USE_PASTE_BURST */
+        if (mrl->cursor == mrl->cmdlen) {
+            terminal_echo(mrl, pos, len);
+        } else {
+            terminal_print_line(mrl, pos, 0);
+            STATS_INC(mrl, redraw_insert);
+        }
+    }
+}
+
+#if MICRORL_CFG_USE_UTF8 || __DOXYGEN__
+/**
+ * \brief           Insert received printable bytes at cursor position, only whole UTF-8 chars
+ *                  are inserted. Bytes of char split between input calls are kept until
+ *                  char is complete, bytes of broken chars are dropped
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       text: Received printable bytes
+ * \param[in]       len: Number of bytes
+ */
+static void utf8_insert(microrl_t* mrl, const char* text, int len) {
+    int i = 0;
+
+    while (i < len) {
+        int run = i;
+        int n;
+
+        if (mrl->utf8_need > 0) {
+            if (!IS_UTF8_CONT(text[i])) {
+                // char is broken, byte is handled as the first byte of next char
+                mrl->utf8_need = 0;
+                continue;
+            }
+            mrl->utf8_seq[(int)mrl->utf8_len++] = text[i++];
+            if (mrl->utf8_len == mrl->utf8_need) {
+                mrl->utf8_need = 0;
+                insert_printable(mrl, mrl->utf8_seq, mrl->utf8_len);
+            }
+            continue;
+        }
+        // run of whole chars is inserted at once
+        while (((n = utf8_char_len(text[run])) > 0) && ((run + n) <= len)) {
+            int k = 1;
+
+            while ((k < n) && IS_UTF8_CONT(text[run + k])) {
+                k++;
+            }
+            if (k < n) {
+                break;
+            }
+            run += n;
+            if (run == len) {
+                break;
+            }
+        }
+        if (run > i) {
+            insert_printable(mrl, text + i, run - i);
+            i = run;
+        } else if (n > 0) {
+            // the first byte of char split between input calls or broken one
+            mrl->utf8_seq[0] = text[i++];
+            mrl->utf8_len = 1;
+            mrl->utf8_need = n;
+        } else {
+            i++;
+        }
+    }
+}
+#endif /* MICRORL_CFG_USE_UTF8 || __DOXYGEN__ */
+
+/**
+ * \brief           Remove len chars backwards at cursor
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       len: Number of chars to remove
+ */
+static void microrl_backspace(microrl_t* mrl, int len) {
+    if (mrl->cursor >= len) {
+        memmove(mrl->cmdline + mrl->cursor - len,
+                mrl->cmdline + mrl->cursor,
+                mrl->cmdlen - mrl->cursor + len);
+        mrl->cursor -= len;
+        mrl->cmdline[mrl->cmdlen] = '\0';
+        mrl->cmdlen -= len;
+#if MICRORL_CFG_USE_TOKEN_INDEX
+        tokens_invalidate(mrl, mrl->cursor);
+#endif /* MICRORL_CFG_USE_TOKEN_INDEX */
+#if MICRORL_CFG_USE_UTF8
+        colmap_invalidate(mrl, mrl->cursor);
+#endif /* MICRORL_CFG_USE_UTF8 */
+    }
+}
+
+/**
+ * \brief           Remove one char forward at cursor
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ */
+static void microrl_delete(microrl_t* mrl) {
+    if ((mrl->cmdlen > 0) && (mrl->cursor != mrl->cmdlen)) {
+#if MICRORL_CFG_USE_UTF8
+      int len = CHAR_NEXT(mrl, mrl->cursor) - mrl->cursor;
+
+      memmove(mrl->cmdline + mrl->cursor,
+              mrl->cmdline + mrl->cursor + len,
+              mrl->cmdlen - mrl->cursor - len);
+      mrl->cmdlen -= len;
+      memset(mrl->cmdline + mrl->cmdlen, 0, len);
+#else
+      memmove(mrl->cmdline + mrl->cursor,
+              mrl->cmdline + mrl->cursor + 1,
+              mrl->cmdlen - mrl->cursor + 1);
+      mrl->cmdline[mrl->cmdlen] = '\0';
+      mrl->cmdlen--;
+#endif /* MICRORL_CFG_USE_UTF8 */
+#if MICRORL_CFG_USE_TOKEN_INDEX
+      tokens_invalidate(mrl, mrl->cursor);
+#endif /* MICRORL_CFG_USE_TOKEN_INDEX */
+#if MICRORL_CFG_USE_UTF8
+      colmap_invalidate(mrl, mrl->cursor);
+#endif /* MICRORL_CFG_USE_UTF8 */
+    }
+}
+
+#if MICRORL_CFG_USE_ESC_SEQ || __DOXYGEN__
+/* Classes of ESC seq chars */
+#define MICRORL_ESC_CL_CTRL                 0   /* Control char */
+#define MICRORL_ESC_CL_ESC                  1   /* ESC, new sequence starts */
+#define MICRORL_ESC_CL_INTER                2   /* Intermediate char, 0x20 - 0x2F */
+#define MICRORL_ESC_CL_DIGIT                3   /* Parameter digit */
+#define MICRORL_ESC_CL_SEP                  4   /* Parameter separator, ':' or ';' */
+#define MICRORL_ESC_CL_PRIV                 5   /* Private parameter char, 0x3C - 0x3F */
+#define MICRORL_ESC_CL_SS3                  6   /* 'O', starts SS3 sequence after ESC */
+#define MICRORL_ESC_CL_CSI                  7   /* '[', starts CSI sequence after ESC */
+#define MICRORL_ESC_CL_FINAL                8   /* Final char, 0x40 - 0x7E */
+#define MICRORL_ESC_CL_OTHER                9   /* DEL and non-ASCII chars */
+#define MICRORL_ESC_CL_NUM                  10
+
+/* Actions of ESC seq parser, combined with the next state in table */
+#define MICRORL_ESC_ACT_NONE                0x00
+#define MICRORL_ESC_ACT_PARAM               0x10    /* Add digit to parameter */
+#define MICRORL_ESC_ACT_SEP                 0x20    /* Start next parameter */
+#define MICRORL_ESC_ACT_KEY                 0x30    /* Sequence is complete, handle the key */
+#define MICRORL_ESC_ACT_START               0x40    /* Start new sequence */
+#define MICRORL_ESC_ACT_ABORT               0x50    /* Sequence is broken, handle char as input */
+#define MICRORL_ESC_ACT_MASK                0xF0
+
+/* Parser table, row for each state except MICRORL_ESC_NONE, column for each char class */
+static const uint8_t escape_table[MICRORL_ESC_SS3][MICRORL_ESC_CL_NUM] = {
+    /* MICRORL_ESC_START */ {
+        MICRORL_ESC_ACT_ABORT | MICRORL_ESC_NONE,   MICRORL_ESC_ACT_START | MICRORL_ESC_START,
+        MICRORL_ESC_NONE,                           MICRORL_ESC_NONE,
+        MICRORL_ESC_NONE,                           MICRORL_ESC_NONE,
+        MICRORL_ESC_SS3,                            MICRORL_ESC_CSI,
+        MICRORL_ESC_NONE,                           MICRORL_ESC_ACT_ABORT | MICRORL_ESC_NONE
+    },
+    /* MICRORL_ESC_CSI */ {
+        MICRORL_ESC_ACT_ABORT | MICRORL_ESC_NONE,   MICRORL_ESC_ACT_START | MICRORL_ESC_START,
+        MICRORL_ESC_CSI_INTER,                      MICRORL_ESC_ACT_PARAM | MICRORL_ESC_CSI,
+        MICRORL_ESC_ACT_SEP | MICRORL_ESC_CSI,      MICRORL_ESC_CSI,
+        MICRORL_ESC_ACT_KEY | MICRORL_ESC_NONE,     MICRORL_ESC_ACT_KEY | MICRORL_ESC_NONE,
+        MICRORL_ESC_ACT_KEY | MICRORL_ESC_NONE,     MICRORL_ESC_ACT_ABORT | MICRORL_ESC_NONE
+    },
+    /* MICRORL_ESC_CSI_INTER */ {
+        MICRORL_ESC_ACT_ABORT | MICRORL_ESC_NONE,   MICRORL_ESC_ACT_START | MICRORL_ESC_START,
+        MICRORL_ESC_CSI_INTER,                      MICRORL_ESC_NONE,
+        MICRORL_ESC_NONE,                           MICRORL_ESC_NONE,
+        MICRORL_ESC_NONE,                           MICRORL_ESC_NONE,
+        MICRORL_ESC_NONE,                           MICRORL_ESC_ACT_ABORT | MICRORL_ESC_NONE
+    },
+    /* MICRORL_ESC_SS3 */ {
+        MICRORL_ESC_ACT_ABORT | MICRORL_ESC_NONE,   MICRORL_ESC_ACT_START | MICRORL_ESC_START,
+        MICRORL_ESC_NONE,                           MICRORL_ESC_ACT_PARAM | MICRORL_ESC_SS3,
+        MICRORL_ESC_ACT_SEP | MICRORL_ESC_SS3,      MICRORL_ESC_NONE,
+        MICRORL_ESC_ACT_KEY | MICRORL_ESC_NONE,     MICRORL_ESC_ACT_KEY | MICRORL_ESC_NONE,
+        MICRORL_ESC_ACT_KEY | MICRORL_ESC_NONE,     MICRORL_ESC_ACT_ABORT | MICRORL_ESC_NONE
+    }
+};
+
+/**
+ * \brief           Get class of ESC seq char
+ * \param[in]       ch: Input character
+ * \return          Char class, one of MICRORL_ESC_CL_ values
+ */
+static int escape_char_class(unsigned char ch) {
+    if (ch == MICRORL_KEY_ESC) {
+        return MICRORL_ESC_CL_ESC;
+    } else if (ch < 0x20) {
+        return MICRORL_ESC_CL_CTRL;
+    } else if (ch < 0x30) {
+        return MICRORL_ESC_CL_INTER;
+    } else if (ch < 0x3A) {
+        return MICRORL_ESC_CL_DIGIT;
+    } else if (ch < 0x3C) {
+        return MICRORL_ESC_CL_SEP;
+    } else if (ch < 0x40) {
+        return MICRORL_ESC_CL_PRIV;
+    } else if (ch == 'O') {
+        return MICRORL_ESC_CL_SS3;
+    } else if (ch == '[') {
+        return MICRORL_ESC_CL_CSI;
+    } else if (ch < 0x7F) {
+        return MICRORL_ESC_CL_FINAL;
+    }
+    return MICRORL_ESC_CL_OTHER;
+}
+
+/**
+ * \brief           Start receiving of new escape sequence
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ */
+static void escape_start(microrl_t* mrl) {
+    mrl->escape_seq = MICRORL_ESC_START;
+    mrl->escape_param = 0;
+    mrl->escape_nparam = 0;
+#if MICRORL_CFG_USE_ESC_TIMEOUT
+    if (mrl->get_time != NULL) {
+        mrl->escape_time = mrl->get_time(mrl);
+    }
+#endif /* MICRORL_CFG_USE_ESC_TIMEOUT */
+}
+
+#if MICRORL_CFG_USE_ESC_TIMEOUT || __DOXYGEN__
+/**
+ * \brief           Drop incomplete escape sequence if its receiving time is elapsed
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ */
+static void escape_timeout(microrl_t* mrl) {
+    if (IS_ESCAPE_ACTIVE(mrl) && (mrl->get_time != NULL)
+        && ((uint32_t)(mrl->get_time(mrl) - mrl->escape_time) >= MICRORL_CFG_ESC_TIMEOUT_TIME)) {
+        mrl->escape_seq = MICRORL_ESC_NONE;
+    }
+}
+#endif /* MICRORL_CFG_USE_ESC_TIMEOUT || __DOXYGEN__ */
+
+/**
+ * \brief           Handle key of complete escape sequence
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       ch: Final character of sequence
+ */
+static void escape_key(microrl_t* mrl, char ch) {
+    switch (ch) {
+        case 'A': { // up
+#if MICRORL_CFG_USE_HISTORY
+            if (mrl->echo == MICRORL_ECHO_ON) {
+                hist_search(mrl, MICRORL_HIST_DIR_UP);
+            }
+#endif /* MICRORL_CFG_USE_HISTORY */
+            break;
+        }
+        case 'B': { // down
+#if MICRORL_CFG_USE_HISTORY
+            if (mrl->echo == MICRORL_ECHO_ON) {
+                hist_search(mrl, MICRORL_HIST_DIR_DOWN);
+            }
+#endif /* MICRORL_CFG_USE_HISTORY */
+            break;
+        }
+        case 'C': { // right
+            if (mrl->cursor < mrl->cmdlen) {
+                cursor_move(mrl, CHAR_NEXT(mrl, mrl->cursor) - mrl->cursor);
+            }
+            break;
+        }
+        case 'D': { // left
+            if (mrl->cursor > 0) {
+                cursor_move(mrl, CHAR_PREV(mrl, mrl->cursor) - mrl->cursor);
+            }
+            break;
+        }
+        case 'H': { // home
+            cursor_move(mrl, -mrl->cursor);
+            break;
+        }
+        case 'F': { // end
+            cursor_move(mrl, mrl->cmdlen - mrl->cursor);
+            break;
+        }
+        case '~': { // VT220 editing keys, key code is parameter
+            if ((mrl->escape_param == 1) || (mrl->escape_param == 7)) {
+                cursor_move(mrl, -mrl->cursor);
+            } else if ((mrl->escape_param == 4) || (mrl->escape_param == 8)) {
+                cursor_move(mrl, mrl->cmdlen - mrl->cursor);
+            } else if (mrl->escape_param == 3) {
+                microrl_delete(mrl);
+                terminal_print_line(mrl, mrl->cursor, 0);
+                STATS_INC(mrl, redraw_backspace);
+            } else {
+                STATS_INC(mrl, esc_unknown);
+            }
+            break;
+        }
+        default:
+            STATS_INC(mrl, esc_unknown);
+            break;
+    }
+}
+
+/**
+ * \brief           Handle char of escape sequence
+ *
+ * Parses CSI ('ESC [' parameters, intermediates, final char) and SS3 ('ESC O' final char)
+ * sequences, unknown sequences are skipped whole
+ *
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       ch: Input character
+ * \return          '1' if char is part of escape sequence, '0' if sequence is broken and char must be handled as input
+ */
+static int escape_process(microrl_t* mrl, int ch) {
+    uint8_t next = escape_table[mrl->escape_seq - 1][escape_char_class((unsigned char)ch)];
+
+    mrl->escape_seq = (microrl_esq_code_t)(next & ~MICRORL_ESC_ACT_MASK);
+    switch (next & MICRORL_ESC_ACT_MASK) {
+        case MICRORL_ESC_ACT_PARAM: {
+            if ((mrl->escape_nparam == 0) && (mrl->escape_param < 100)) {
+                mrl->escape_param = mrl->escape_param * 10 + (ch - '0');
+            }
+            break;
         }
-        if (!(ind < limit)) {
-#if MICRORL_CFG_USE_QUOTING
-            if (quote != '\0') {
-                restore(mrl);
-                return -1;
+        case MICRORL_ESC_ACT_SEP: {
+            if (mrl->escape_nparam < 0xFF) {
+                mrl->escape_nparam++;
             }
-#endif /* MICRORL_CFG_USE_QUOTING */
-            return i;
+            break;
+        }
+        case MICRORL_ESC_ACT_KEY: {
+            escape_key(mrl, ch);
+            break;
+        }
+        case MICRORL_ESC_ACT_START: {
+            escape_start(mrl);
+            break;
+        }
+        case MICRORL_ESC_ACT_ABORT: {
+            STATS_INC(mrl, esc_unknown);
+            return 0;
         }
+        default:
+            if (mrl->escape_seq == MICRORL_ESC_NONE) {
+                // sequence is ended without key handling, it is skipped whole
+                STATS_INC(mrl, esc_unknown);
+            }
+            break;
     }
-    return i;
+    return 1;
 }
+#endif /* MICRORL_CFG_USE_ESC_SEQ || __DOXYGEN__ */
 
+#if MICRORL_CFG_USE_COMMANDS || __DOXYGEN__
 /**
- * \brief           Print default prompt defined in \ref MICRORL_CFG_PROMPT_STRING config
- * \param[in,out]   mrl: \ref microrl_t working instance
+ * \brief           Find the first command in sorted table, which name is not less
+ *                  than key, comparing `len` chars at most
+ * \param[in]       cmds: Sorted table of commands
+ * \param[in]       num: Number of entries in table
+ * \param[in]       key: Command name or its prefix
+ * \param[in]       len: Number of chars to compare
+ * \return          Index of found command, `num` if all commands are less than key
  */
-inline static void print_prompt(microrl_t* mrl) {
-    mrl->print(mrl, mrl->prompt_str);
+static size_t cmd_lower_bound(const microrl_cmd_t* cmds, size_t num, const char* key, size_t len) {
+    size_t lo = 0;
+    size_t hi = num;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strncmp(cmds[mid].name, key, len) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
 }
 
 /**
- * \brief           Clear last symbol in command line and move cursor
- *                  to its position
- * \param[in,out]   mrl: \ref microrl_t working instance
+ * \brief           Find command by name in sorted table
+ * \param[in]       cmds: Sorted table of commands
+ * \param[in]       num: Number of entries in table
+ * \param[in]       name: Command name
+ * \return          Pointer to found command, NULL if not found
  */
-inline static void terminal_backspace(microrl_t* mrl) {
-    mrl->print(mrl, "\033[D \033[D");
+static const microrl_cmd_t* cmd_find(const microrl_cmd_t* cmds, size_t num, const char* name) {
+    size_t i;
+
+    // compare with terminating zero to find exact name only
+    i = cmd_lower_bound(cmds, num, name, strlen(name) + 1);
+    if ((i < num) && (strcmp(cmds[i].name, name) == 0)) {
+        return &cmds[i];
+    }
+    return NULL;
 }
 
 /**
- * \brief           Print end line symbol defined in \ref MICRORL_CFG_END_LINE config
+ * \brief           Find the deepest command matching to line tokens
  * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       argc: Number of tokens
+ * \param[in]       argv: Line tokens
+ * \param[out]      depth: Number of tokens matched to commands
+ * \return          Pointer to found command, NULL if the first token is not found
  */
-inline static void terminal_newline(microrl_t* mrl) {
-    mrl->print(mrl, MICRORL_CFG_END_LINE);
+static const microrl_cmd_t* commands_walk(microrl_t* mrl, int argc, const char* const *argv, int* depth) {
+    const microrl_cmd_t* cmd = NULL;
+    const microrl_cmd_t* next;
+    const microrl_cmd_t* cmds = mrl->cmds;
+    size_t num = mrl->cmds_num;
+
+    *depth = 0;
+    while ((*depth < argc) && ((next = cmd_find(cmds, num, argv[*depth])) != NULL)) {
+        cmd = next;
+        cmds = cmd->children;
+        num = cmd->children_num;
+        (*depth)++;
+    }
+    return cmd;
 }
 
 /**
- * \brief           Set cursor at current position + offset (positive or negative)
- *                  in string. The provided string must be at least 7 bytes long
- * \param[in]       str: The original string before moving the cursor
- * \param[in]       offset: Positive or negative interval to move cursor
- * \return          The original string after moving the cursor
+ * \brief           Print commands table with help texts
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       cmds: Table of commands
+ * \param[in]       num: Number of entries in table
  */
-static char * generate_move_cursor(char* str, int offset) {
-    char c = 'C';
-    if (offset > 999) {
-        offset = 999;
+static void commands_print(microrl_t* mrl, const microrl_cmd_t* cmds, size_t num) {
+    size_t i;
+    size_t len;
+    size_t width = 0;
+
+    for (i = 0; i < num; ++i) {
+        len = strlen(cmds[i].name);
+        if (len > width) {
+            width = len;
+        }
     }
-    if (offset < -999) {
-        offset = -999;
+
+    for (i = 0; i < num; ++i) {
+        terminal_print(mrl, cmds[i].name);
+        if (cmds[i].help != NULL) {
+            for (len = strlen(cmds[i].name); len < width + 2; ++len) {
+                terminal_write(mrl, " ", 1);
+            }
+            terminal_print(mrl, cmds[i].help);
+        }
+        terminal_newline(mrl);
     }
-    if (offset < 0) {
-        offset = -offset;
-        c = 'D';
-    } else if (offset == 0) {
-        *str = '\0';
-        return str;
+}
+
+#if MICRORL_CFG_USE_COMMAND_ARGS || __DOXYGEN__
+/**
+ * \brief           Parse unsigned number
+ * \param[in]       str: Number string
+ * \param[in]       base: Number base, 10 or 16
+ * \param[out]      val: Parsed value
+ * \return          '1' on success, '0' if string is not a number or number is too big
+ */
+static int arg_parse_num(const char* str, unsigned int base, unsigned long* val) {
+    unsigned long v = 0;
+    unsigned int d;
+
+    if (*str == '\0') {
+        return 0;
+    }
+    for (; *str != '\0'; ++str) {
+        if ((*str >= '0') && (*str <= '9')) {
+            d = *str - '0';
+        } else if ((base == 16) && ((*str | 0x20) >= 'a') && ((*str | 0x20) <= 'f')) {
+            d = (*str | 0x20) - 'a' + 10;
+        } else {
+            return 0;
+        }
+        if (v > (ULONG_MAX - d) / base) {
+            return 0;
+        }
+        v = v * base + d;
     }
+    *val = v;
+    return 1;
+}
 
-#if MICRORL_CFG_USE_LIBC_STDIO
-    str += sprintf(str, "\033[%d%c", offset, c);
-#else
-    *str++ = '\033';
-    *str++ = '[';
-    char tmp_str[4] = {0,};
-    size_t i = 0;
-    size_t j;
-    while (offset > 0) {
-        tmp_str[i++] = (offset % 10) + '0';
-        offset /= 10;
+/**
+ * \brief           Parse argument token to its value
+ * \param[in]       arg: Argument schema entry
+ * \param[in]       str: Argument token
+ * \param[out]      val: Argument value
+ * \return          '1' on success, '0' if token doesn't match argument type
+ */
+static int arg_parse(const microrl_arg_t* arg, const char* str, microrl_argval_t* val) {
+    unsigned long v;
+    long i;
+
+    val->str = str;
+    switch (arg->type) {
+        case MICRORL_ARG_INT:
+            if (!arg_parse_num(str + (*str == '-'), 10, &v)
+                || (v > (unsigned long)LONG_MAX + (*str == '-'))) {
+                return 0;
+            }
+            // negate in unsigned to get LONG_MIN without overflow
+            val->num = (*str == '-') ? (long)(0UL - v) : (long)v;
+            break;
+        case MICRORL_ARG_HEX:
+            if ((str[0] == '0') && ((str[1] | 0x20) == 'x')) {
+                str += 2;
+            }
+            if (!arg_parse_num(str, 16, &val->unum)) {
+                return 0;
+            }
+            break;
+        case MICRORL_ARG_ENUM:
+            for (i = 0; (arg->keywords[i] != NULL) && (strcmp(arg->keywords[i], str) != 0); ++i) {}
+            if (arg->keywords[i] == NULL) {
+                return 0;
+            }
+            val->num = i;
+            break;
+        default:
+            break;
     }
-    for (j = 0; j < i; ++j) {
-        *str++ = tmp_str[i - j - 1];
+    return 1;
+}
+
+/**
+ * \brief           Find flag with the token name in arguments schema
+ * \param[in]       args: Arguments schema
+ * \param[in]       num: Number of entries in schema
+ * \param[in]       str: Token
+ * \return          Index of flag, `num` if token is not a flag
+ */
+static size_t arg_find_flag(const microrl_arg_t* args, size_t num, const char* str) {
+    size_t i;
+
+    for (i = 0; i < num; ++i) {
+        if ((args[i].type == MICRORL_ARG_FLAG) && (strcmp(args[i].name, str) == 0)) {
+            break;
+        }
     }
-    *str++ = c;
-    *str = '\0';
-#endif /* MICRORL_CFG_USE_LIBC_STDIO */
-    return str;
+    return i;
 }
 
 /**
- * \brief           Set cursor at current position + offset (positive or negative)
- *                  in terminal's command line
+ * \brief           Print argument parsing error
  * \param[in,out]   mrl: \ref microrl_t working instance
- * \param[in]       offset: Positive or negative interval to move cursor
+ * \param[in]       index: Index of bad token, used if name is NULL
+ * \param[in]       name: Name of bad argument, can be NULL
+ * \param[in]       msg: Error description
  */
-static void terminal_move_cursor(microrl_t* mrl, int offset) {
-    char str[16] = {0,};
-    if (offset != 0) {
-        generate_move_cursor(str, offset);
-        mrl->print(mrl, str);
-    }
+static void args_error(microrl_t* mrl, int index, const char* name, const char* msg) {
+    char num[4];
+    int i = sizeof(num) - 1;
+
+    num[i] = '\0';
+    do {
+        num[--i] = '0' + index % 10;
+        index /= 10;
+    } while ((index > 0) && (i > 0));
+    terminal_print(mrl, "ERROR:argument ");
+    terminal_print(mrl, (name != NULL) ? name : (num + i));
+    terminal_print(mrl, msg);
+    terminal_newline(mrl);
 }
 
 /**
- * \brief           Print command line to screen, replace '\0' to wihitespace
+ * \brief           Parse command arguments to `argval` by command schema in one pass over tokens
  * \param[in,out]   mrl: \ref microrl_t working instance
- * \param[in]       pos: Start position from which the line will be printed
- * \param[in]       reset: Reset the cursor position
+ * \param[in]       cmd: Command with arguments schema
+ * \param[in]       argc: Number of tokens
+ * \param[in]       argv: Tokens, the first one is command name
+ * \return          '1' on success, '0' if error is printed
  */
-static void terminal_print_line(microrl_t* mrl, int pos, int reset) {
-    if (mrl->echo != MICRORL_ECHO_OFF) {
-        char str[MICRORL_CFG_PRINT_BUFFER_LEN];
-        char* j = str;
+static int args_parse(microrl_t* mrl, const microrl_cmd_t* cmd, int argc, const char* const *argv) {
+    static const char* const type_msg[] = {
+        [MICRORL_ARG_INT] = " must be decimal number",
+        [MICRORL_ARG_HEX] = " must be hexadecimal number",
+        [MICRORL_ARG_ENUM] = " is not a keyword",
+        [MICRORL_ARG_STR] = "",
+        [MICRORL_ARG_FLAG] = "",
+    };
+    size_t num = cmd->args_num;
+    size_t pos = 0;
+    size_t j;
+    int i;
 
-        if (reset) {
-#if MICRORL_CFG_USE_CARRIAGE_RETURN
-            *j++ = '\r';
-            j = generate_move_cursor(j, MICRORL_CFG_PROMPT_LEN + pos);
-#else
-            j = generate_move_cursor(j, -(MICRORL_CFG_CMDLINE_LEN + MICRORL_CFG_PROMPT_LEN + 2));
-            j = generate_move_cursor(j, MICRORL_CFG_PROMPT_LEN + pos);
-#endif /* MICRORL_CFG_USE_CARRIAGE_RETURN */
-        }
+    if (num > MICRORL_CFG_CMD_TOKEN_NMB) {
+        num = MICRORL_CFG_CMD_TOKEN_NMB;
+    }
+    memset(mrl->argval, 0, sizeof(mrl->argval));
 
-        for (size_t i = pos; i < mrl->cmdlen; i++) {
-            *j++ = (mrl->cmdline[i] == '\0') ? ' ' : mrl->cmdline[i];
-            if ((j - str) == strlen(str)) {
-                *j = '\0';
-                mrl->print(mrl, str);
-                j = str;
-            }
+    for (i = 1; i < argc; ++i) {
+        j = arg_find_flag(cmd->args, num, argv[i]);
+        if (j < num) {
+            mrl->argval[j].str = argv[i];
+            mrl->argval[j].num = 1;
+            continue;
         }
-
-        if ((j - str + 3 + 6 + 1) > MICRORL_CFG_PRINT_BUFFER_LEN) {
-            *j = '\0';
-            mrl->print(mrl, str);
-            j = str;
+        while ((pos < num) && (cmd->args[pos].type == MICRORL_ARG_FLAG)) {
+            pos++;
+        }
+        if (pos >= num) {
+            args_error(mrl, i, NULL, " is unexpected");
+            return 0;
+        }
+        if (!arg_parse(&cmd->args[pos], argv[i], &mrl->argval[pos])) {
+            args_error(mrl, i, NULL, type_msg[cmd->args[pos].type]);
+            return 0;
         }
+        pos++;
+    }
 
-        *j++ = '\033';   // delete all past end of text
-        *j++ = '[';
-        *j++ = 'K';
-        generate_move_cursor(j, mrl->cursor - mrl->cmdlen);
-        mrl->print(mrl, str);
+    for (; pos < num; ++pos) {
+        if ((cmd->args[pos].type != MICRORL_ARG_FLAG) && !cmd->args[pos].optional) {
+            args_error(mrl, 0, cmd->args[pos].name, " is missing");
+            return 0;
+        }
     }
+    return 1;
 }
+#endif /* MICRORL_CFG_USE_COMMAND_ARGS || __DOXYGEN__ */
 
 /**
- * \brief           Initialize MicroRL library data
+ * \brief           Dispatch entered line to commands table
  * \param[in,out]   mrl: \ref microrl_t working instance
- * \param[in]       print: Callback function for character output
- * \return          \ref microrlOK on success, member of \ref microrlr_t otherwise
+ * \param[in]       argc: Number of tokens
+ * \param[in]       argv: Line tokens
+ * \param[out]      res: Result of command handler, it is not changed if handler is not called
+ * \return          '1' if line is handled, '0' if command is not found
  */
-microrlr_t microrl_init(microrl_t* mrl, microrl_print_fn print) {
-    memset(mrl, 0, sizeof(microrl_t));
+static int commands_execute(microrl_t* mrl, int argc, const char* const *argv, int* res) {
+    const microrl_cmd_t* cmd;
+    int depth;
 
-    mrl->prompt_str = prompt_default;
-    mrl->print = print;
-#if MICRORL_CFG_ENABLE_INIT_PROMPT
-    print_prompt(mrl);
-#endif /* MICRORL_CFG_ENABLE_INIT_PROMPT */
-    mrl->echo = MICRORL_ECHO_ON;
-    mrl->start_password = -1;
+    cmd = commands_walk(mrl, argc, argv, &depth);
+    if (cmd == NULL) {
+        return 0;
+    }
 
-    return microrlOK;
+    if (cmd->handler != NULL) {
+#if MICRORL_CFG_USE_COMMAND_ARGS
+        if ((cmd->args != NULL) && !args_parse(mrl, cmd, argc - depth + 1, argv + depth - 1)) {
+            return 1;
+        }
+#endif /* MICRORL_CFG_USE_COMMAND_ARGS */
+        terminal_flush(mrl);
+        *res = cmd->handler(mrl, argc - depth + 1, argv + depth - 1);
+    } else if (cmd->children_num > 0) {
+        commands_print(mrl, cmd->children, cmd->children_num);
+    } else {
+        return 0;
+    }
+    return 1;
 }
+#endif /* MICRORL_CFG_USE_COMMANDS || __DOXYGEN__ */
 
 #if MICRORL_CFG_USE_COMPLETE || __DOXYGEN__
+
 /**
- * \brief           Set pointer to callback complition func, that called when user press 'Tab'
+ * \brief           Completion variant getter prototype. Variants are got in increasing
+ *                  order of index, each pass starts from 0
  * \param[in,out]   mrl: \ref microrl_t working instance
- * \param[in]       get_completion: Auto-complete string callback
+ * \param[in]       ctx: Source of variants
+ * \param[in]       index: Number of variant
+ * \return          Variant with number `index`, NULL if there are fewer variants
  */
-void microrl_set_complete_callback(microrl_t* mrl, microrl_get_compl_fn get_completion) {
-    mrl->get_completion = get_completion;
-}
-#endif /* MICRORL_CFG_USE_COMPLETE || __DOXYGEN__ */
+typedef const char* (*microrl_compl_get_fn)(microrl_t* mrl, const void* ctx, size_t index);
 
 /**
- * \brief           Pointer to callback func, that called when user press 'Enter'
- * \param[in,out]   mrl: \ref microrl_t working instance
- * \param[in]       execute: Command execute callback
+ * \brief           Arguments of completion iterator callback
  */
-void microrl_set_execute_callback(microrl_t* mrl, microrl_exec_fn execute) {
-    mrl->execute = execute;
-}
+typedef struct {
+    int argc;                                       /*!< Number of tokens */
+    const char* const *argv;                        /*!< Line tokens */
+} microrl_compl_args_t;
 
-#if MICRORL_CFG_USE_CTRL_C || __DOXYGEN__
 /**
- * \brief           Set callback for Ctrl+C terminal signal
+ * \brief           Get variant from NULL-terminated array
  * \param[in,out]   mrl: \ref microrl_t working instance
- * \param[in]       sigint: Ctrl+C terminal signal callback
+ * \param[in]       ctx: NULL-terminated array of variants
+ * \param[in]       index: Number of variant
+ * \return          Variant with number `index`, NULL if there are fewer variants
  */
-void microrl_set_sigint_callback(microrl_t* mrl, microrl_sigint_fn sigint) {
-    mrl->sigint = sigint;
+static const char* compl_array_get(microrl_t* mrl, const void* ctx, size_t index) {
+    (void)mrl;
+    return ((char* const*)ctx)[index];
 }
-#endif /* MICRORL_CFG_USE_CTRL_C || __DOXYGEN__ */
 
 /**
- * \brief           Set echo mode used to mask user input
- *
- * Use \ref MICRORL_ECHO_ONCE to disable echo for password input, echo mode will enabled after user press Enter.
- * Use \ref MICRORL_ECHO_ON or \ref MICRORL_ECHO_OFF to turn on or off the echo manualy.
- *
+ * \brief           Get variant from completion iterator callback
  * \param[in,out]   mrl: \ref microrl_t working instance
- * \param[in]       echo: Member of \ref microrl_echo_t enumeration
+ * \param[in]       ctx: Arguments of callback, \ref microrl_compl_args_t
+ * \param[in]       index: Number of variant
+ * \return          Variant with number `index`, NULL if there are fewer variants
  */
-void microrl_set_echo(microrl_t* mrl, microrl_echo_t echo) {
-    mrl->echo = echo;
+static const char* compl_iter_get(microrl_t* mrl, const void* ctx, size_t index) {
+    const microrl_compl_args_t* args = ctx;
+    return mrl->compl_iter(mrl, args->argc, args->argv, index);
 }
 
-#if MICRORL_CFG_USE_HISTORY || __DOXYGEN__
 /**
- * \brief           Restore record to command line from history buffer
+ * \brief           Print completion variants in columns fitting to terminal width,
+ *                  the whole row is passed to output at once
  * \param[in,out]   mrl: \ref microrl_t working instance
- * \param[in]       dir: Member of \ref microrl_hist_dir_t enumeration
+ * \param[in]       get: Variant getter
+ * \param[in]       ctx: Source of variants
+ * \param[in]       width: Length of the longest variant
  */
-static void hist_search(microrl_t* mrl, microrl_hist_dir_t dir) {
-    int len = hist_restore_line(&mrl->ring_hist, mrl->cmdline, dir);
-    if (len >= 0) {
-        mrl->cmdline[len] = '\0';
-        mrl->cursor = mrl->cmdlen = len;
-        terminal_print_line(mrl, 0, 1);
+static void complete_list(microrl_t* mrl, microrl_compl_get_fn get, const void* ctx, size_t width) {
+    char row[MICRORL_CFG_TERMINAL_WIDTH];
+    const char* variant;
+    size_t cols;
+    size_t col = 0;
+    size_t n = 0;
+    size_t len;
+
+    // variants are separated by 2 spaces, the last column is not used to avoid line wrap
+    width += 2;
+    cols = (MICRORL_CFG_TERMINAL_WIDTH - 1 + 2) / width;
+
+    for (size_t i = 0; (variant = get(mrl, ctx, i)) != NULL; ++i) {
+        len = strlen(variant);
+        if (cols < 2) {
+            terminal_write(mrl, variant, len);
+            terminal_newline(mrl);
+            continue;
+        }
+
+        memset(row + n, ' ', col * width - n);
+        n = col * width;
+        memcpy(row + n, variant, len);
+        n += len;
+        if (++col == cols) {
+            row[n] = '\0';
+            terminal_write(mrl, row, n);
+            terminal_newline(mrl);
+            col = 0;
+            n = 0;
+        }
+    }
+    if (n > 0) {
+        row[n] = '\0';
+        terminal_write(mrl, row, n);
+        terminal_newline(mrl);
     }
 }
-#endif /* MICRORL_CFG_USE_HISTORY || __DOXYGEN__ */
 
-#if MICRORL_CFG_USE_ESC_SEQ || __DOXYGEN__
 /**
- * \brief           Handle escape sequences
+ * \brief           Complete token with variants, print variants if there are some
  * \param[in,out]   mrl: \ref microrl_t working instance
- * \param[in]       ch: Input character
- * \return          '1' if escape sequence processed, '0' otherwise
+ * \param[in]       token: Token being completed
+ * \param[in]       get: Variant getter
+ * \param[in]       ctx: Source of variants
  */
-static int escape_process(microrl_t* mrl, char ch) {
-    if (ch == '[') {
-        mrl->escape_seq = MICRORL_ESC_BRACKET;
-        return 0;
-    } else if (mrl->escape_seq == MICRORL_ESC_BRACKET) {
-        if (ch == 'A') {
-#if MICRORL_CFG_USE_HISTORY
-            if (mrl->echo == MICRORL_ECHO_ON) {
-                hist_search(mrl, MICRORL_HIST_DIR_UP);
-            }
-#endif /* MICRORL_CFG_USE_HISTORY */
-            return 1;
-        } else if (ch == 'B') {
-#if MICRORL_CFG_USE_HISTORY
-            if (mrl->echo == MICRORL_ECHO_ON) {
-                hist_search(mrl, MICRORL_HIST_DIR_DOWN);
-            }
-#endif /* MICRORL_CFG_USE_HISTORY */
-            return 1;
-        } else if (ch == 'C') {
-            if (mrl->cursor < mrl->cmdlen) {
-                terminal_move_cursor(mrl, 1);
-                mrl->cursor++;
-            }
-            return 1;
-        } else if (ch == 'D') {
-            if (mrl->cursor > 0) {
-                terminal_move_cursor(mrl, -1);
-                mrl->cursor--;
-            }
-            return 1;
-        } else if (ch == '7') {
-            mrl->escape_seq = MICRORL_ESC_HOME;
-            return 0;
-        } else if (ch == '8') {
-            mrl->escape_seq = MICRORL_ESC_END;
-            return 0;
+static void complete_variants(microrl_t* mrl, const char* token, microrl_compl_get_fn get, const void* ctx) {
+    char common[MICRORL_CFG_CMDLINE_LEN];
+    const char* variant = get(mrl, ctx, 0);
+    size_t token_len = strlen(token);
+    size_t count;
+    size_t width;
+    size_t len;
+    size_t i;
+    int pos = mrl->cursor;
+
+    if (variant == NULL) {
+        return;
+    }
+
+    // common part can only shrink, so keep copy of it and compare each next variant with it
+    len = width = strlen(variant);
+    if (len > sizeof(common)) {
+        len = sizeof(common);
+    }
+    memcpy(common, variant, len);
+    for (count = 1; (variant = get(mrl, ctx, count)) != NULL; ++count) {
+        for (i = 0; (i < len) && (variant[i] == common[i]); ++i) {}
+#if MICRORL_CFG_USE_UTF8
+        // common part ends before the first differing char, not inside it
+        while ((i > token_len) && (i < len) && IS_UTF8_CONT(common[i])) {
+            --i;
         }
-    } else if (ch == '~') {
-        if (mrl->escape_seq == MICRORL_ESC_HOME) {
-            terminal_move_cursor(mrl, -mrl->cursor);
-            mrl->cursor = 0;
-            return 1;
-        } else if (mrl->escape_seq == MICRORL_ESC_END) {
-            terminal_move_cursor(mrl, mrl->cmdlen - mrl->cursor);
-            mrl->cursor = mrl->cmdlen;
-            return 1;
+#endif /* MICRORL_CFG_USE_UTF8 */
+        len = i;
+        i = strlen(variant);
+        if (i > width) {
+            width = i;
         }
     }
 
-    /* unknown escape sequence, stop */
-    return 1;
+    if (count > 1) {
+        terminal_newline(mrl);
+        complete_list(mrl, get, ctx, width);
+        print_prompt(mrl);
+        pos = 0;
+    }
+
+#if MICRORL_USE_SPLIT_RESTORE
+    restore(mrl);
+#endif /* MICRORL_USE_SPLIT_RESTORE */
+    if (len > token_len) {
+        microrl_insert_text(mrl, common + token_len, len - token_len);
+    }
+    if (count == 1) {
+        microrl_insert_text(mrl, " ", 1);
+    }
+    terminal_print_line(mrl, pos, 0);
+    STATS_INC(mrl, redraw_complete);
 }
-#endif /* MICRORL_CFG_USE_ESC_SEQ || __DOXYGEN__ */
 
+#if MICRORL_CFG_USE_COMMANDS || __DOXYGEN__
 /**
- * \brief           Insert len char of text at cursor position
+ * \brief           Range of commands table
+ */
+typedef struct {
+    const microrl_cmd_t* cmds;                      /*!< The first command in range */
+    size_t num;                                     /*!< Number of commands in range */
+} microrl_cmd_range_t;
+
+/**
+ * \brief           Get variant from range of commands table
  * \param[in,out]   mrl: \ref microrl_t working instance
- * \param[in]       text: Record to store in cmdline of \ref microrl_t
- * \param[in]       len: Length of text to store
- * \return          \ref microrlOK on success, \ref microrlERR otherwise
+ * \param[in]       ctx: Range of commands, \ref microrl_cmd_range_t
+ * \param[in]       index: Number of variant
+ * \return          Variant with number `index`, NULL if there are fewer variants
  */
-microrlr_t microrl_insert_text(microrl_t* mrl, char* text, int len) {
-    if ((mrl->cmdlen + len) < MICRORL_CFG_CMDLINE_LEN) {
-        if ((mrl->echo == MICRORL_ECHO_ONCE) & (mrl->start_password == -1)) {
-            mrl->start_password = mrl->cmdlen;
+static const char* compl_cmds_get(microrl_t* mrl, const void* ctx, size_t index) {
+    const microrl_cmd_range_t* range = ctx;
+    (void)mrl;
+    return (index < range->num) ? range->cmds[index].name : NULL;
+}
+
+#if MICRORL_CFG_USE_COMMAND_ARGS || __DOXYGEN__
+/**
+ * \brief           Keywords for argument completion
+ */
+typedef struct {
+    const microrl_arg_t* args;                      /*!< Arguments schema to complete flags from */
+    size_t num;                                     /*!< Number of entries in schema */
+    const char* const *keywords;                    /*!< Keywords of enumeration argument, can be NULL */
+    const char* token;                              /*!< Token being completed */
+    size_t len;                                     /*!< Length of token */
+} microrl_arg_compl_t;
+
+/**
+ * \brief           Get variant from enumeration keywords and flags matching to token
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       ctx: Keywords for completion, \ref microrl_arg_compl_t
+ * \param[in]       index: Number of variant
+ * \return          Variant with number `index`, NULL if there are fewer variants
+ */
+static const char* compl_args_get(microrl_t* mrl, const void* ctx, size_t index) {
+    const microrl_arg_compl_t* compl = ctx;
+    size_t i;
+    (void)mrl;
+
+    for (i = 0; (compl->keywords != NULL) && (compl->keywords[i] != NULL); ++i) {
+        if ((strncmp(compl->keywords[i], compl->token, compl->len) == 0) && (index-- == 0)) {
+            return compl->keywords[i];
         }
-        memmove(mrl->cmdline + mrl->cursor + len,
-                mrl->cmdline + mrl->cursor,
-                mrl->cmdlen - mrl->cursor);
-        for (size_t i = 0; i < len; i++) {
-            mrl->cmdline[mrl->cursor + i] = text[i];
-            if (mrl->cmdline[mrl->cursor + i] == ' ') {
-                mrl->cmdline[mrl->cursor + i] = 0;
-            }
+    }
+    for (i = 0; i < compl->num; ++i) {
+        if ((compl->args[i].type == MICRORL_ARG_FLAG)
+            && (strncmp(compl->args[i].name, compl->token, compl->len) == 0) && (index-- == 0)) {
+            return compl->args[i].name;
         }
-        mrl->cursor += len;
-        mrl->cmdlen += len;
-        mrl->cmdline[mrl->cmdlen] = '\0';
-        return microrlOK;
     }
-    return microrlERR;
+    return NULL;
 }
 
 /**
- * \brief           Remove len chars backwards at cursor
+ * \brief           Complete the last token from command arguments schema
  * \param[in,out]   mrl: \ref microrl_t working instance
- * \param[in]       len: Number of chars to remove
+ * \param[in]       cmd: Command with arguments schema
+ * \param[in]       argc: Number of tokens, the last one is being completed
+ * \param[in]       argv: Tokens, the first one is command name
  */
-static void microrl_backspace(microrl_t* mrl, int len) {
-    if (mrl->cursor >= len) {
-        memmove(mrl->cmdline + mrl->cursor - len,
-                mrl->cmdline + mrl->cursor,
-                mrl->cmdlen - mrl->cursor + len);
-        mrl->cursor -= len;
-        mrl->cmdline[mrl->cmdlen] = '\0';
-        mrl->cmdlen -= len;
+static void args_complete(microrl_t* mrl, const microrl_cmd_t* cmd, int argc, const char* const *argv) {
+    microrl_arg_compl_t compl;
+    size_t pos = 0;
+    int i;
+
+    compl.args = cmd->args;
+    compl.num = (cmd->args_num > MICRORL_CFG_CMD_TOKEN_NMB) ? MICRORL_CFG_CMD_TOKEN_NMB : cmd->args_num;
+    compl.keywords = NULL;
+    compl.token = argv[argc - 1];
+    compl.len = strlen(compl.token);
+
+    // find schema entry of the last token, skipping flags like parser does
+    for (i = 1; i < argc; ++i) {
+        if ((i < argc - 1) && (arg_find_flag(compl.args, compl.num, argv[i]) < compl.num)) {
+            continue;
+        }
+        while ((pos < compl.num) && (compl.args[pos].type == MICRORL_ARG_FLAG)) {
+            pos++;
+        }
+        if ((i == argc - 1) && (pos < compl.num) && (compl.args[pos].type == MICRORL_ARG_ENUM)) {
+            compl.keywords = compl.args[pos].keywords;
+        }
+        pos++;
     }
+    complete_variants(mrl, compl.token, compl_args_get, &compl);
 }
+#endif /* MICRORL_CFG_USE_COMMAND_ARGS || __DOXYGEN__ */
 
 /**
- * \brief           Remove one char forward at cursor
+ * \brief           Complete the last token from commands table
  * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       argc: Number of tokens, the last one is being completed
+ * \param[in]       argv: Line tokens
  */
-static void microrl_delete(microrl_t* mrl) {
-    if ((mrl->cmdlen > 0) && (mrl->cursor != mrl->cmdlen)) {
-      memmove(mrl->cmdline + mrl->cursor,
-              mrl->cmdline + mrl->cursor + 1,
-              mrl->cmdlen - mrl->cursor + 1);
-      mrl->cmdline[mrl->cmdlen] = '\0';
-      mrl->cmdlen--;
+static void commands_complete(microrl_t* mrl, int argc, const char* const *argv) {
+    const microrl_cmd_t* cmd;
+    const microrl_cmd_t* cmds = mrl->cmds;
+    size_t num = mrl->cmds_num;
+    const char* token = argv[argc - 1];
+    size_t token_len = strlen(token);
+    microrl_cmd_range_t range;
+    size_t last;
+    int depth;
+
+    if (argc > 1) {
+        cmd = commands_walk(mrl, argc - 1, argv, &depth);
+        if (cmd == NULL) {
+            return;
+        }
+#if MICRORL_CFG_USE_COMMAND_ARGS
+        if ((cmd->args != NULL) && ((depth != argc - 1) || (cmd->children_num == 0))) {
+            args_complete(mrl, cmd, argc - depth + 1, argv + depth - 1);
+            return;
+        }
+#endif /* MICRORL_CFG_USE_COMMAND_ARGS */
+        if (depth != argc - 1) {
+            return;
+        }
+        cmds = cmd->children;
+        num = cmd->children_num;
     }
-}
 
-#if MICRORL_CFG_USE_COMPLETE || __DOXYGEN__
+    // commands with the same prefix are adjacent in sorted table
+    last = cmd_lower_bound(cmds, num, token, token_len);
+    range.cmds = cmds + last;
+    while ((last < num) && (strncmp(cmds[last].name, token, token_len) == 0)) {
+        last++;
+    }
+    range.num = last - (size_t)(range.cmds - cmds);
+    complete_variants(mrl, token, compl_cmds_get, &range);
+}
+#endif /* MICRORL_CFG_USE_COMMANDS || __DOXYGEN__ */
 
+#if MICRORL_CFG_USE_COMPLETE_CACHE || __DOXYGEN__
 /**
- * \brief           
- * \param[in]       arr: 
- * \return          
+ * \brief           Get completion variants from cache, if the last completion was
+ *                  for the same token with shorter or the same prefix
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       token: Token being completed
+ * \param[in]       tkn_pos: Position of token in command line
+ * \return          NULL-terminated list of variants, NULL if cache can't answer
  */
-static int common_len(char** arr) {
+static char** compl_cache_lookup(microrl_t* mrl, const char* token, int tkn_pos) {
+    size_t len = strlen(token);
     size_t i;
-    char* shortest = arr[0];
-    size_t shortlen = strlen(shortest);
+    size_t j;
+
+    if ((mrl->compl_key_len < 0) || (tkn_pos != mrl->compl_tkn_pos) || (mrl->cursor < mrl->compl_key_len)
+        || (memcmp(mrl->compl_key, mrl->cmdline, mrl->compl_key_len) != 0)
+        || (memchr(mrl->cmdline + mrl->compl_key_len, '\0', mrl->cursor - mrl->compl_key_len) != NULL)) {
+        return NULL;
+    }
 
-    for (i = 0; arr[i] != NULL; ++i) {
-        if (strlen(arr[i]) < shortlen) {
-            shortest = arr[i];
-            shortlen = strlen(shortest);
+    // token is extended, so narrow cached variants down to new prefix
+    for (i = 0, j = 0; mrl->compl_list[i] != NULL; ++i) {
+        if (strncmp(mrl->compl_list[i], token, len) == 0) {
+            mrl->compl_list[j++] = mrl->compl_list[i];
         }
     }
+    mrl->compl_list[j] = NULL;
 
-    for (i = 0; i < shortlen; ++i) {
-        for (size_t j = 0; arr[j] != 0; ++j) {
-            if (shortest[i] != arr[j][i]) {
-                return i;
-            }
+    memcpy(mrl->compl_key + mrl->compl_key_len, mrl->cmdline + mrl->compl_key_len,
+           mrl->cursor - mrl->compl_key_len);
+    mrl->compl_key_len = mrl->cursor;
+    return mrl->compl_list;
+}
+
+/**
+ * \brief           Copy completion variants to cache
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       tkn_pos: Position of completed token in command line
+ * \param[in]       get: Variant getter
+ * \param[in]       ctx: Source of variants
+ * \return          '1' if variants are cached, '0' if they do not fit to cache
+ */
+static int compl_cache_store(microrl_t* mrl, int tkn_pos, microrl_compl_get_fn get, const void* ctx) {
+    const char* variant;
+    size_t used = 0;
+    size_t len;
+    size_t i;
+
+    mrl->compl_key_len = -1;
+    for (i = 0; (variant = get(mrl, ctx, i)) != NULL; ++i) {
+        len = strlen(variant) + 1;
+        if ((i >= MICRORL_CFG_COMPLETE_CACHE_NMB) || (used + len > MICRORL_CFG_COMPLETE_CACHE_LEN)) {
+            return 0;
         }
+        mrl->compl_list[i] = memcpy(mrl->compl_buf + used, variant, len);
+        used += len;
     }
+    mrl->compl_list[i] = NULL;
 
-    return i;
+    memcpy(mrl->compl_key, mrl->cmdline, mrl->cursor);
+    mrl->compl_key_len = mrl->cursor;
+    mrl->compl_tkn_pos = tkn_pos;
+    return 1;
 }
+#endif /* MICRORL_CFG_USE_COMPLETE_CACHE || __DOXYGEN__ */
 
 /**
  * \brief           Auto-complete activities to complete input in
@@ -761,65 +4115,136 @@ static int common_len(char** arr) {
  */
 static void microrl_get_complite(microrl_t* mrl) {
     const char* tkn_arr[MICRORL_CFG_CMD_TOKEN_NMB];
-    char** compl_token;
+    microrl_compl_args_t args;
+    microrl_compl_get_fn get;
+    const void* ctx;
+#if MICRORL_CFG_USE_COMPLETE_CACHE
+    int tkn_pos;
+#endif /* MICRORL_CFG_USE_COMPLETE_CACHE */
 
-    if (mrl->get_completion == NULL) { // callback was not set
+#if MICRORL_CFG_USE_COMMANDS
+    if ((mrl->compl_iter == NULL) && (mrl->get_completion == NULL) && (mrl->cmds == NULL)) {
+#else
+    if ((mrl->compl_iter == NULL) && (mrl->get_completion == NULL)) { // callback was not set
+#endif /* MICRORL_CFG_USE_COMMANDS */
         return;
     }
+    TRACE_ENTER(mrl, MICRORL_TRACE_COMPLETE);
 
+#if MICRORL_CFG_USE_TOKEN_INDEX
+    char tkn_buf[MICRORL_CFG_CMDLINE_LEN];
+    int status = tokens_split(mrl, mrl->cursor, tkn_arr, tkn_buf);
+#else
     int status = split(mrl, mrl->cursor, tkn_arr);
+#endif /* MICRORL_CFG_USE_TOKEN_INDEX */
     if (status < 0) {
+        TRACE_LEAVE(mrl, MICRORL_TRACE_COMPLETE);
         return;
     }
 
     if (mrl->cmdline[mrl->cursor - 1] == '\0') {
         tkn_arr[status++] = "";
     }
-    compl_token = mrl->get_completion(mrl, status, tkn_arr);
-#if MICRORL_CFG_USE_QUOTING
-    restore(mrl);
-#endif /* MICRORL_CFG_USE_QUOTING */
-    if (compl_token[0] != NULL) {
-        size_t i = 0;
-        size_t len;
-        int pos = mrl->cursor;
+#if MICRORL_CFG_USE_COMMANDS
+    if ((mrl->compl_iter == NULL) && (mrl->get_completion == NULL)) {
+        commands_complete(mrl, status, tkn_arr);
+#if MICRORL_USE_SPLIT_RESTORE
+        restore(mrl);
+#endif /* MICRORL_USE_SPLIT_RESTORE */
+        TRACE_LEAVE(mrl, MICRORL_TRACE_COMPLETE);
+        return;
+    }
+#endif /* MICRORL_CFG_USE_COMMANDS */
 
-        if (compl_token[1] == NULL) {
-            len = strlen(compl_token[0]);
+#if MICRORL_CFG_USE_COMPLETE_CACHE
+    tkn_pos = (tkn_arr[status - 1][0] == '\0') ? mrl->cursor : (int)(tkn_arr[status - 1] - mrl->cmdline);
+    get = compl_array_get;
+    ctx = compl_cache_lookup(mrl, tkn_arr[status - 1], tkn_pos);
+    if (ctx == NULL) {
+#endif /* MICRORL_CFG_USE_COMPLETE_CACHE */
+        if (mrl->compl_iter != NULL) {
+            args.argc = status;
+            args.argv = tkn_arr;
+            get = compl_iter_get;
+            ctx = &args;
         } else {
-            len = common_len(compl_token);
-            terminal_newline(mrl);
-            while (compl_token[i] != NULL) {
-                mrl->print(mrl, compl_token[i]);
-                mrl->print(mrl, " ");
-                i++;
-            }
-            terminal_newline(mrl);
-            print_prompt(mrl);
-            pos = 0;
+            get = compl_array_get;
+            ctx = mrl->get_completion(mrl, status, tkn_arr);
         }
-
-        if (len != 0) {
-            microrl_insert_text(mrl, compl_token[0] + strlen(tkn_arr[status - 1]),
-                                len - strlen(tkn_arr[status - 1]));
-            if (compl_token[1] == NULL) {
-                microrl_insert_text(mrl, " ", 1);
-            }
+#if MICRORL_CFG_USE_COMPLETE_CACHE
+        if (compl_cache_store(mrl, tkn_pos, get, ctx)) {
+            get = compl_array_get;
+            ctx = mrl->compl_list;
         }
-        terminal_print_line(mrl, pos, 0);
     }
+#endif /* MICRORL_CFG_USE_COMPLETE_CACHE */
+    complete_variants(mrl, tkn_arr[status - 1], get, ctx);
+#if MICRORL_USE_SPLIT_RESTORE
+    restore(mrl);
+#endif /* MICRORL_USE_SPLIT_RESTORE */
+    TRACE_LEAVE(mrl, MICRORL_TRACE_COMPLETE);
 }
 
 #endif /* MICRORL_CFG_USE_COMPLETE || __DOXYGEN__ */
 
+#if MICRORL_CFG_USE_ASYNC_EXEC || __DOXYGEN__
+/**
+ * \brief           Keep char received while command is pending
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       ch: Input character
+ */
+static void typeahead_put(microrl_t* mrl, int ch) {
+#if MICRORL_CFG_USE_CTRL_C
+    if (ch == MICRORL_KEY_ETX) {
+        // Interrupt is for pending command, chars typed for after it are dropped
+        mrl->typeahead_len = 0;
+        if (mrl->sigint != NULL) {
+            terminal_flush(mrl);
+            mrl->sigint(mrl);
+        }
+        return;
+    }
+#endif /* MICRORL_CFG_USE_CTRL_C */
+    if (mrl->typeahead_len < MICRORL_CFG_TYPEAHEAD_LEN) {
+        mrl->typeahead[mrl->typeahead_len++] = (char)ch;
+    }
+}
+#endif /* MICRORL_CFG_USE_ASYNC_EXEC || __DOXYGEN__ */
+
+/**
+ * \brief           Finish executed command and print prompt
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       res: Result of execute callback or command handler
+ */
+static void exec_finish(microrl_t* mrl, int res) {
+#if MICRORL_CFG_USE_LOG
+    // Log text printed by command is ended, prompt is printed below
+    log_end(mrl);
+#endif /* MICRORL_CFG_USE_LOG */
+#if MICRORL_CFG_USE_ASYNC_EXEC
+    if (res == MICRORL_EXEC_PENDING) {
+        mrl->exec_pending = 1;
+        return;
+    }
+    mrl->exec_status = res;
+#else
+    (void)res;
+#endif /* MICRORL_CFG_USE_ASYNC_EXEC */
+    print_prompt(mrl);
+}
+
 /**
  * \brief           Processing input string and calling execute() callback
  * \param[in,out]   mrl: \ref microrl_t working instance
  */
 static void new_line_handler(microrl_t* mrl) {
     const char* tkn_arr[MICRORL_CFG_CMD_TOKEN_NMB];
-    int status;
+#if MICRORL_CFG_USE_TOKEN_INDEX
+    char tkn_buf[MICRORL_CFG_CMDLINE_LEN];
+#endif /* MICRORL_CFG_USE_TOKEN_INDEX */
+    int status, res = 0;
 
+    TRACE_ENTER(mrl, MICRORL_TRACE_NEW_LINE);
     terminal_newline(mrl);
 #if MICRORL_CFG_USE_HISTORY
     if ((mrl->cmdlen > 0) && (mrl->echo == MICRORL_ECHO_ON)) {
@@ -830,44 +4255,187 @@ static void new_line_handler(microrl_t* mrl) {
         microrl_set_echo(mrl, MICRORL_ECHO_ON);
         mrl->start_password = -1;
     }
+#if MICRORL_CFG_USE_TOKEN_INDEX
+    status = tokens_split(mrl, mrl->cmdlen, tkn_arr, tkn_buf);
+#else
     status = split(mrl, mrl->cmdlen, tkn_arr);
+#endif /* MICRORL_CFG_USE_TOKEN_INDEX */
     if (status == -1) {
 //        mrl->print(mrl, "ERROR: Max token amount exseed\n");
 #if MICRORL_CFG_USE_QUOTING
-        mrl->print(mrl, "ERROR:too many tokens or invalid quoting");
+        terminal_print(mrl, "ERROR:too many tokens or invalid quoting");
 #else
-        mrl->print(mrl, "ERROR:too many tokens");
+        terminal_print(mrl, "ERROR:too many tokens");
 #endif /* MICRORL_CFG_USE_QUOTING */
-        mrl->print(mrl, MICRORL_CFG_END_LINE);
+        terminal_newline(mrl);
+    }
+#if MICRORL_CFG_USE_COMMANDS
+    if ((status > 0) && (mrl->cmds != NULL) && commands_execute(mrl, status, tkn_arr, &res)) {
+        status = 0;
     }
+#endif /* MICRORL_CFG_USE_COMMANDS */
     if ((status > 0) && (mrl->execute != NULL)) {
-        mrl->execute(mrl, status, tkn_arr);
+        terminal_flush(mrl);
+        res = mrl->execute(mrl, status, tkn_arr);
     }
-    print_prompt(mrl);
+    exec_finish(mrl, res);
     mrl->cmdlen = 0;
     mrl->cursor = 0;
-    memset(mrl->cmdline, 0, MICRORL_CFG_CMDLINE_LEN);
+    memset(mrl->cmdline, 0, MICRORL_CMDLINE_SIZE(mrl));
+#if MICRORL_CFG_USE_COMPLETE_CACHE
+    mrl->compl_key_len = -1;
+#endif /* MICRORL_CFG_USE_COMPLETE_CACHE */
+#if MICRORL_CFG_USE_TOKEN_INDEX
+    tokens_invalidate(mrl, 0);
+#endif /* MICRORL_CFG_USE_TOKEN_INDEX */
+#if MICRORL_CFG_USE_UTF8
+    colmap_invalidate(mrl, 0);
+#endif /* MICRORL_CFG_USE_UTF8 */
 #if MICRORL_CFG_USE_HISTORY
     mrl->ring_hist.cur = 0;
 #endif /* MICRORL_CFG_USE_HISTORY */
+    TRACE_LEAVE(mrl, MICRORL_TRACE_NEW_LINE);
 }
 
+#if MICRORL_CFG_USE_SCRIPT || __DOXYGEN__
 /**
- * \brief           Insert char to command line
+ * \brief           Execute one line of script placed to command line
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       line: Line text, without end line chars
+ * \param[in]       len: Length of line
+ * \return          \ref microrlOK on success, member of \ref microrlr_t otherwise
+ */
+static microrlr_t script_line(microrl_t* mrl, const char* line, size_t len) {
+    const char* tkn_arr[MICRORL_CFG_CMD_TOKEN_NMB];
+#if MICRORL_CFG_USE_TOKEN_INDEX
+    char tkn_buf[MICRORL_CFG_CMDLINE_LEN];
+#endif /* MICRORL_CFG_USE_TOKEN_INDEX */
+    int status, res = 0;
+    size_t i;
+
+    if (len >= (size_t)MICRORL_CMDLINE_SIZE(mrl)) {
+        return microrlERRMEM;
+    }
+    for (i = 0; i < len; ++i) {
+        mrl->cmdline[i] = ((line[i] == ' ') || (line[i] == '\t')) ? '\0' : line[i];
+    }
+    mrl->cmdline[len] = '\0';
+    mrl->cmdlen = (microrl_pos_t)len;
+#if MICRORL_CFG_USE_UTF8
+    colmap_invalidate(mrl, 0);
+#endif /* MICRORL_CFG_USE_UTF8 */
+#if MICRORL_CFG_USE_TOKEN_INDEX
+    tokens_invalidate(mrl, 0);
+    status = tokens_split(mrl, mrl->cmdlen, tkn_arr, tkn_buf);
+#else
+    status = split(mrl, mrl->cmdlen, tkn_arr);
+#endif /* MICRORL_CFG_USE_TOKEN_INDEX */
+    if (status < 0) {
+        return microrlERRPAR;
+    }
+#if MICRORL_CFG_USE_COMMANDS
+    if ((status > 0) && (mrl->cmds != NULL) && commands_execute(mrl, status, tkn_arr, &res)) {
+        status = 0;
+    }
+#endif /* MICRORL_CFG_USE_COMMANDS */
+    if ((status > 0) && (mrl->execute != NULL)) {
+        res = mrl->execute(mrl, status, tkn_arr);
+    }
+    return (res == 0) ? microrlOK : microrlERR;
+}
+
+/**
+ * \brief           Execute lines of text as commands entered to command line
  *
- * For example calls in usart RX interrupt
+ * Lines are separated by '\n' or "\r\n", tokens are separated by whitespaces or tabs
+ * and can be quoted like in command line. Each line is passed to command registry
+ * or execute callback at once, nothing is echoed or saved to history and prompt and
+ * command line being edited are not printed again. Commands must finish before
+ * callback returns, \ref MICRORL_EXEC_PENDING result is an error here
  *
  * \param[in,out]   mrl: \ref microrl_t working instance
- * \param[in]       ch: Printing to terminal character 
+ * \param[in]       buf: Script text
+ * \param[in]       len: Length of script text
+ * \param[in]       stop_on_error: '1' to stop on the first failed line, '0' to execute all lines
+ * \return          \ref microrlOK if all lines succeeded, otherwise result of the first failed line:
+ *                      \ref microrlERR if command result is not zero, \ref microrlERRPAR on too many
+ *                      tokens or invalid quoting, \ref microrlERRMEM if line is too long
  */
-void microrl_insert_char(microrl_t* mrl, int ch) {
-#if MICRORL_CFG_USE_ESC_SEQ
-    if (mrl->escape != 0) {
-        if (escape_process(mrl, ch)) {
-            mrl->escape = 0;
+microrlr_t microrl_exec_script(microrl_t* mrl, const char* buf, size_t len, int stop_on_error) {
+    char saved[MICRORL_CFG_CMDLINE_LEN];
+    microrl_pos_t saved_len = mrl->cmdlen;
+    microrlr_t res = microrlOK;
+    size_t pos = 0;
+
+    // Line being edited is kept, command line buffer is used to split script lines
+    memcpy(saved, mrl->cmdline, MICRORL_CMDLINE_SIZE(mrl));
+    terminal_flush(mrl);
+    while (pos < len) {
+        const char* line = buf + pos;
+        const char* end = memchr(line, '\n', len - pos);
+        size_t line_len = (end != NULL) ? (size_t)(end - line) : (len - pos);
+        microrlr_t line_res;
+
+        pos += line_len + 1;
+        if ((line_len > 0) && (line[line_len - 1] == '\r')) {
+            line_len--;
         }
-    } else {
+        line_res = script_line(mrl, line, line_len);
+        if (line_res != microrlOK) {
+            if (res == microrlOK) {
+                res = line_res;
+            }
+            if (stop_on_error) {
+                break;
+            }
+        }
+    }
+    memcpy(mrl->cmdline, saved, MICRORL_CMDLINE_SIZE(mrl));
+    mrl->cmdlen = saved_len;
+#if MICRORL_CFG_USE_TOKEN_INDEX
+    tokens_invalidate(mrl, 0);
+#endif /* MICRORL_CFG_USE_TOKEN_INDEX */
+#if MICRORL_CFG_USE_UTF8
+    colmap_invalidate(mrl, 0);
+#endif /* MICRORL_CFG_USE_UTF8 */
+    return res;
+}
+#endif /* MICRORL_CFG_USE_SCRIPT || __DOXYGEN__ */
+
+/**
+ * \brief           Process one input char, output is left in staging buffer
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       ch: Input character
+ */
+static void insert_char(microrl_t* mrl, int ch) {
+#if MICRORL_CFG_USE_ASYNC_EXEC
+    if (IS_EXEC_PENDING(mrl)) {
+        typeahead_put(mrl, ch);
+        return;
+    }
+#endif /* MICRORL_CFG_USE_ASYNC_EXEC */
+#if MICRORL_CFG_USE_ESC_TIMEOUT
+    escape_timeout(mrl);
+#endif /* MICRORL_CFG_USE_ESC_TIMEOUT */
+#if MICRORL_CFG_USE_PASTE_BURST
+    if (IS_ESCAPE_ACTIVE(mrl) || !IS_PRINTABLE_CHAR(ch)) {
+        terminal_redraw_dirty(mrl);
+    }
+#endif /* MICRORL_CFG_USE_PASTE_BURST */
+#if MICRORL_CFG_USE_UTF8
+    if (!IS_PRINTABLE_CHAR(ch)) {
+        // control char breaks incomplete char
+        mrl->utf8_need = 0;
+    }
+#endif /* MICRORL_CFG_USE_UTF8 */
+#if MICRORL_CFG_USE_ESC_SEQ
+    if (!IS_ESCAPE_ACTIVE(mrl) || !escape_process(mrl, ch)) {
 #endif /* MICRORL_CFG_USE_ESC_SEQ */
+#if MICRORL_CFG_USE_HISTORY_SEARCH
+        if (mrl->search_active && search_process(mrl, ch)) {
+            return;
+        }
+#endif /* MICRORL_CFG_USE_HISTORY_SEARCH */
         if ((ch == MICRORL_KEY_CR) || (ch == MICRORL_KEY_LF)) {
             // Only trigger a newline if ch doen't follow its companion's
             // triggering a newline.
@@ -891,7 +4459,7 @@ void microrl_insert_char(microrl_t* mrl, int ch) {
             //-----------------------------------------------------
             case MICRORL_KEY_ESC: {
 #if MICRORL_CFG_USE_ESC_SEQ
-                mrl->escape = 1;
+                escape_start(mrl);
 #endif /* MICRORL_CFG_USE_ESC_SEQ */
                 break;
             }
@@ -901,39 +4469,48 @@ void microrl_insert_char(microrl_t* mrl, int ch) {
                     microrl_backspace(mrl, mrl->cursor);
                 }
                 terminal_print_line(mrl, 0, 1);
+                STATS_INC(mrl, redraw_backspace);
                 break;
             }
             //-----------------------------------------------------
             case MICRORL_KEY_VT: { // ^K
-                mrl->print(mrl, "\033[K");
+#if MICRORL_CFG_USE_SHADOW_LINE
+                mrl->cmdlen = mrl->cursor;
+                terminal_print_line(mrl, mrl->cursor, 0);
+                STATS_INC(mrl, redraw_backspace);
+#else
+                terminal_write(mrl, "\033[K", 3);
                 mrl->cmdlen = mrl->cursor;
+#endif /* MICRORL_CFG_USE_SHADOW_LINE */
+#if MICRORL_CFG_USE_TOKEN_INDEX
+                tokens_invalidate(mrl, mrl->cursor);
+#endif /* MICRORL_CFG_USE_TOKEN_INDEX */
+#if MICRORL_CFG_USE_UTF8
+                colmap_invalidate(mrl, mrl->cursor);
+#endif /* MICRORL_CFG_USE_UTF8 */
                 break;
             }
             //-----------------------------------------------------
             case MICRORL_KEY_ENQ: { // ^E
-                terminal_move_cursor(mrl, mrl->cmdlen - mrl->cursor);
-                mrl->cursor = mrl->cmdlen;
+                cursor_move(mrl, mrl->cmdlen - mrl->cursor);
                 break;
             }
             //-----------------------------------------------------
             case MICRORL_KEY_SOH: { // ^A
-                terminal_move_cursor(mrl, -mrl->cursor);
-                mrl->cursor = 0;
+                cursor_move(mrl, -mrl->cursor);
                 break;
             }
             //-----------------------------------------------------
             case MICRORL_KEY_ACK: { // ^F
                 if (mrl->cursor < mrl->cmdlen) {
-                    terminal_move_cursor(mrl, 1);
-                    mrl->cursor++;
+                    cursor_move(mrl, CHAR_NEXT(mrl, mrl->cursor) - mrl->cursor);
                 }
                 break;
             }
             //-----------------------------------------------------
             case MICRORL_KEY_STX: { // ^B
                 if (mrl->cursor != 0) {
-                    terminal_move_cursor(mrl, -1);
-                    mrl->cursor--;
+                    cursor_move(mrl, CHAR_PREV(mrl, mrl->cursor) - mrl->cursor);
                 }
                 break;
             }
@@ -955,12 +4532,19 @@ void microrl_insert_char(microrl_t* mrl, int ch) {
             case MICRORL_KEY_DEL: // Backspace
             case MICRORL_KEY_BS: { // ^H
                 if (mrl->cursor > 0) {
-                    microrl_backspace(mrl, 1);
+                    microrl_backspace(mrl, mrl->cursor - CHAR_PREV(mrl, mrl->cursor));
+#if MICRORL_CFG_USE_HSCROLL
+                    // view scrolls when line gets shorter
+                    terminal_print_line(mrl, mrl->cursor, 0);
+                    STATS_INC(mrl, redraw_backspace);
+#else
                     if (mrl->cursor == mrl->cmdlen) {
                         terminal_backspace(mrl);
                     } else {
                         terminal_print_line(mrl, mrl->cursor, 1);
+                        STATS_INC(mrl, redraw_backspace);
                     }
+#endif /* MICRORL_CFG_USE_HSCROLL */
                 }
                 break;
             }
@@ -968,10 +4552,17 @@ void microrl_insert_char(microrl_t* mrl, int ch) {
             case MICRORL_KEY_EOT: { // ^D
                 microrl_delete(mrl);
                 terminal_print_line(mrl, mrl->cursor, 0);
+                STATS_INC(mrl, redraw_backspace);
                 break;
             }
             //-----------------------------------------------------
             case MICRORL_KEY_DC2: { // ^R
+#if MICRORL_CFG_USE_HISTORY_SEARCH
+                if (mrl->echo == MICRORL_ECHO_ON) {
+                    search_start(mrl);
+                    break;
+                }
+#endif /* MICRORL_CFG_USE_HISTORY_SEARCH */
                 terminal_newline(mrl);
                 print_prompt(mrl);
                 terminal_print_line(mrl, 0, 0);
@@ -981,6 +4572,7 @@ void microrl_insert_char(microrl_t* mrl, int ch) {
 #if MICRORL_CFG_USE_CTRL_C
             case MICRORL_KEY_ETX: {
                 if (mrl->sigint != NULL) {
+                    terminal_flush(mrl);
                     mrl->sigint(mrl);
                 }
                 break;
@@ -988,21 +4580,13 @@ void microrl_insert_char(microrl_t* mrl, int ch) {
 #endif /* MICRORL_CFG_USE_CTRL_C */
             //-----------------------------------------------------
             default: {
-                if (((ch == ' ') && (mrl->cmdlen == 0)) || IS_CONTROL_CHAR(ch)) {
-                    break;
-                }
-                if (microrl_insert_text(mrl, (char*)&ch, 1) == microrlOK) {
-                    if (mrl->cursor == mrl->cmdlen) {
-                        char nch [] = {0, 0};
-                        if ((mrl->cursor >= mrl->start_password) & (mrl->echo == MICRORL_ECHO_ONCE)) {
-                            nch[0] = '*';
-                        } else {
-                            nch[0] = ch;
-                        }
-                        mrl->print(mrl, nch);
-                    } else {
-                        terminal_print_line(mrl, mrl->cursor - 1, 0);
-                    }
+                if (!IS_CONTROL_CHAR(ch)) {
+                    char c = ch;
+#if MICRORL_CFG_USE_UTF8
+                    utf8_insert(mrl, &c, 1);
+#else
+                    insert_printable(mrl, &c, 1);
+#endif /* MICRORL_CFG_USE_UTF8 */
                 }
             }
         }
@@ -1010,3 +4594,221 @@ void microrl_insert_char(microrl_t* mrl, int ch) {
     }
 #endif /* MICRORL_CFG_USE_ESC_SEQ */
 }
+
+/**
+ * \brief           Insert char to command line
+ *
+ * For example calls in usart RX interrupt
+ *
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       ch: Printing to terminal character 
+ */
+void microrl_insert_char(microrl_t* mrl, int ch) {
+#if MICRORL_CFG_USE_LOG
+    log_finish(mrl);
+#endif /* MICRORL_CFG_USE_LOG */
+#if MICRORL_CFG_USE_PASTE_BURST
+    burst_detect(mrl, 0);
+#endif /* MICRORL_CFG_USE_PASTE_BURST */
+    STATS_INC(mrl, in_bytes);
+    insert_char(mrl, ch);
+    terminal_sync(mrl);
+}
+
+/**
+ * \brief           Insert block of received chars to command line
+ *
+ * Does the same as \ref microrl_insert_char for every char of block, but runs of
+ * printable chars are inserted and echoed at once and output is flushed once per block.
+ * With \ref MICRORL_CFG_USE_PASTE_BURST block is handled as paste burst.
+ * For example calls with data from DMA or socket read
+ *
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       buf: Received chars
+ * \param[in]       len: Number of received chars
+ */
+void microrl_process_input(microrl_t* mrl, const char* buf, size_t len) {
+    size_t i = 0;
+
+#if MICRORL_CFG_USE_LOG
+    log_finish(mrl);
+#endif /* MICRORL_CFG_USE_LOG */
+#if MICRORL_CFG_USE_PASTE_BURST
+    burst_detect(mrl, 1);
+#endif /* MICRORL_CFG_USE_PASTE_BURST */
+    STATS_ADD(mrl, in_bytes, len);
+    while (i < len) {
+        size_t run = 0;
+
+        if (!IS_ESCAPE_ACTIVE(mrl) && !IS_SEARCH_ACTIVE(mrl) && !IS_EXEC_PENDING(mrl)) {
+            while (((i + run) < len) && IS_PRINTABLE_CHAR(buf[i + run])) {
+                run++;
+            }
+        }
+        if (run > 0) {
+#if MICRORL_CFG_USE_UTF8
+            utf8_insert(mrl, buf + i, run);
+#else
+            insert_printable(mrl, buf + i, run);
+#endif /* MICRORL_CFG_USE_UTF8 */
+            i += run;
+        } else {
+            insert_char(mrl, buf[i++]);
+        }
+    }
+#if MICRORL_CFG_USE_PASTE_BURST
+    if (mrl->get_time == NULL) {
+        terminal_redraw_dirty(mrl);
+    }
+#endif /* MICRORL_CFG_USE_PASTE_BURST */
+    terminal_sync(mrl);
+}
+
+#if MICRORL_CFG_USE_ASYNC_EXEC || __DOXYGEN__
+/**
+ * \brief           Finish command which returned \ref MICRORL_EXEC_PENDING
+ *
+ * Prints prompt and processes input kept in type-ahead buffer while command was pending.
+ * Call it from the same thread as other functions of instance, not from execute callback
+ *
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       status: Command result, like the one returned by execute callback
+ * \return          \ref microrlOK on success, \ref microrlERR if no command is pending
+ */
+microrlr_t microrl_command_done(microrl_t* mrl, int status) {
+    char buf[MICRORL_CFG_TYPEAHEAD_LEN];
+    size_t len;
+
+    if (!IS_EXEC_PENDING(mrl) || (status == MICRORL_EXEC_PENDING)) {
+        return microrlERR;
+    }
+    mrl->exec_pending = 0;
+    exec_finish(mrl, status);
+
+    // Input after the next pending command goes to type-ahead buffer again
+    len = mrl->typeahead_len;
+    memcpy(buf, mrl->typeahead, len);
+    mrl->typeahead_len = 0;
+#if MICRORL_CFG_USE_STATS
+    // kept chars are counted when received
+    mrl->stats.in_bytes -= (uint32_t)len;
+#endif /* MICRORL_CFG_USE_STATS */
+    microrl_process_input(mrl, buf, len);
+    return microrlOK;
+}
+#endif /* MICRORL_CFG_USE_ASYNC_EXEC || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_RX_RING || __DOXYGEN__
+/**
+ * \brief           Put received char to receive ring
+ *
+ * Call it from interrupt or DMA callback, only one producer is allowed.
+ * Chars are processed by \ref microrl_poll then
+ *
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       ch: Received char
+ * \return          \ref microrlOK on success, \ref microrlERRMEM if ring is full and char is dropped
+ */
+microrlr_t microrl_rx_push_isr(microrl_t* mrl, char ch) {
+    microrl_rx_pos_t head = mrl->rx_head;
+
+    if ((microrl_rx_pos_t)(head - MICRORL_RX_LOAD(mrl->rx_tail)) >= MICRORL_CFG_RX_RING_LEN) {
+        mrl->rx_overruns++;
+        return microrlERRMEM;
+    }
+    mrl->rx_ring[head & MICRORL_RX_MASK] = ch;
+    MICRORL_RX_STORE(mrl->rx_head, (microrl_rx_pos_t)(head + 1));
+    return microrlOK;
+}
+
+/**
+ * \brief           Put block of received chars to receive ring
+ *
+ * Call it from interrupt or DMA callback, only one producer is allowed.
+ * Chars which do not fit are dropped and counted in `rx_overruns` member
+ *
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       buf: Received chars
+ * \param[in]       len: Number of received chars
+ * \return          Number of chars put to ring
+ */
+size_t microrl_rx_push_block_isr(microrl_t* mrl, const char* buf, size_t len) {
+    microrl_rx_pos_t head = mrl->rx_head;
+    size_t space, pos, part;
+
+    space = MICRORL_CFG_RX_RING_LEN - (microrl_rx_pos_t)(head - MICRORL_RX_LOAD(mrl->rx_tail));
+    if (len > space) {
+        mrl->rx_overruns += (uint32_t)(len - space);
+        len = space;
+    }
+    if (len == 0) {
+        return 0;
+    }
+    pos = head & MICRORL_RX_MASK;
+    part = MICRORL_CFG_RX_RING_LEN - pos;
+    if (part > len) {
+        part = len;
+    }
+    memcpy(&mrl->rx_ring[pos], buf, part);
+    memcpy(mrl->rx_ring, buf + part, len - part);
+    MICRORL_RX_STORE(mrl->rx_head, (microrl_rx_pos_t)(head + len));
+    return len;
+}
+
+/**
+ * \brief           Process chars from receive ring
+ *
+ * Call it from main loop. Chars are processed like with \ref microrl_process_input,
+ * directly from ring. Calls \ref microrl_tick too, if it is used
+ *
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ */
+void microrl_poll(microrl_t* mrl) {
+    microrl_rx_pos_t head = MICRORL_RX_LOAD(mrl->rx_head);
+    microrl_rx_pos_t tail = mrl->rx_tail;
+
+    while (tail != head) {
+        size_t pos = tail & MICRORL_RX_MASK;
+        size_t len = (microrl_rx_pos_t)(head - tail);
+
+        if (len > (MICRORL_CFG_RX_RING_LEN - pos)) {
+            len = MICRORL_CFG_RX_RING_LEN - pos;
+        }
+        microrl_process_input(mrl, &mrl->rx_ring[pos], len);
+        tail = (microrl_rx_pos_t)(tail + len);
+        MICRORL_RX_STORE(mrl->rx_tail, tail);
+    }
+#if MICRORL_USE_TICK
+    microrl_tick(mrl);
+#endif /* MICRORL_USE_TICK */
+}
+#endif /* MICRORL_CFG_USE_RX_RING || __DOXYGEN__ */
+
+#if MICRORL_USE_TICK || __DOXYGEN__
+/**
+ * \brief           Finish deferred processing when its time is elapsed
+ *
+ * Call it periodically from main loop, if time callback is set or log is used
+ *
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ */
+void microrl_tick(microrl_t* mrl) {
+#if MICRORL_CFG_USE_LOG
+    log_finish(mrl);
+#endif /* MICRORL_CFG_USE_LOG */
+#if MICRORL_USE_TIME
+    if (mrl->get_time != NULL) {
+#if MICRORL_CFG_USE_PASTE_BURST
+        if ((mrl->dirty_pos >= 0)
+            && ((uint32_t)(mrl->get_time(mrl) - mrl->last_input_time) >= MICRORL_CFG_PASTE_BURST_TIME)) {
+            terminal_redraw_dirty(mrl);
+        }
+#endif /* MICRORL_CFG_USE_PASTE_BURST */
+#if MICRORL_CFG_USE_ESC_TIMEOUT
+        escape_timeout(mrl);
+#endif /* MICRORL_CFG_USE_ESC_TIMEOUT */
+    }
+#endif /* MICRORL_USE_TIME */
+    terminal_sync(mrl);
+}
+#endif /* MICRORL_USE_TICK || __DOXYGEN__ */
@@ -29,6 +29,8 @@
 #ifndef MICRORL_HDR_H
 #define MICRORL_HDR_H
 
+#include <stddef.h>
+#include <stdint.h>
 #include "microrl_config.h"
 
 #ifdef __cplusplus
@@ -39,6 +41,12 @@ extern "C" {
  * \defgroup        MICRORL Micro Read Line library
  * \brief           Micro Read Line library
  * \{
+ *
+ * Library has no shared mutable state, all working data is in \ref microrl_t instance
+ * and buffers given to it. Different instances can be used from different threads at the
+ * same time without locking. Functions of one instance must not be called concurrently,
+ * application serializes them, and callbacks of instance are called from the thread that
+ * calls library function for it. Callbacks must not pass input to own instance
  */
 
 /**
@@ -52,12 +60,14 @@ typedef enum {
 } microrlr_t;
 
 /**
- * \brief           ESC seq internal codes
+ * \brief           ESC seq parser states
  */
 typedef enum {
-    MICRORL_ESC_BRACKET = 0x01,                 /*!< Encountered '[' character after ESQ code */
-    MICRORL_ESC_HOME,                           /*!< Encountered 'HOME' code after ESQ code */
-    MICRORL_ESC_END                             /*!< Encountered 'END' code after ESQ code */
+    MICRORL_ESC_NONE = 0x00,                    /*!< No ESC seq is being received */
+    MICRORL_ESC_START,                          /*!< Encountered ESC code */
+    MICRORL_ESC_CSI,                            /*!< Encountered '[' after ESC code, parameters follow */
+    MICRORL_ESC_CSI_INTER,                      /*!< Encountered intermediate char of '[' sequence */
+    MICRORL_ESC_SS3                             /*!< Encountered 'O' after ESC code, final char follows */
 } microrl_esq_code_t;
 
 /**
@@ -78,7 +88,33 @@ struct microrl_hist_rbuf;
 struct microrl_quoted_tkn;
 #endif /* MICRORL_CFG_USE_QUOTING */
 
+#if (MICRORL_CFG_CMDLINE_LEN <= 127) || __DOXYGEN__
+typedef int8_t microrl_pos_t;                   /*!< Type of position in command line, signed for -1 marks */
+#elif MICRORL_CFG_CMDLINE_LEN <= 32767
+typedef int16_t microrl_pos_t;
+#else
+typedef int32_t microrl_pos_t;
+#endif /* (MICRORL_CFG_CMDLINE_LEN <= 127) || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_RX_RING || __DOXYGEN__
+#if (MICRORL_CFG_RX_RING_LEN <= 128) || __DOXYGEN__
+typedef uint8_t microrl_rx_pos_t;               /*!< Type of free-running receive ring counter, accessed atomically */
+#elif MICRORL_CFG_RX_RING_LEN <= 32768
+typedef uint16_t microrl_rx_pos_t;
+#else
+typedef uint32_t microrl_rx_pos_t;
+#endif /* (MICRORL_CFG_RX_RING_LEN <= 128) || __DOXYGEN__ */
+#endif /* MICRORL_CFG_USE_RX_RING || __DOXYGEN__ */
+
 #if MICRORL_CFG_USE_HISTORY || __DOXYGEN__
+#if (MICRORL_CFG_RING_HISTORY_LEN <= 256) || __DOXYGEN__
+typedef uint8_t microrl_hist_pos_t;             /*!< Type of position in history ring buffer */
+#elif MICRORL_CFG_RING_HISTORY_LEN <= 65536
+typedef uint16_t microrl_hist_pos_t;
+#else
+typedef uint32_t microrl_hist_pos_t;
+#endif /* (MICRORL_CFG_RING_HISTORY_LEN <= 256) || __DOXYGEN__ */
+
 /**
  * \brief           History struct, contains internal variable
  *
@@ -86,10 +122,29 @@ struct microrl_quoted_tkn;
  *
  */
 typedef struct microrl_hist_rbuf {
+#if MICRORL_CFG_USE_EXT_BUFFERS || __DOXYGEN__
+    char* ring_buf;                             /*!< History ring buffer provided by application */
+    size_t ring_len;                            /*!< History ring buffer size */
+#endif /* MICRORL_CFG_USE_EXT_BUFFERS || __DOXYGEN__ */
+#if MICRORL_CFG_USE_STATS || __DOXYGEN__
+    uint32_t evictions;                         /*!< Number of older records removed to free space */
+#endif /* MICRORL_CFG_USE_STATS || __DOXYGEN__ */
+    microrl_hist_pos_t begin;                   /*!< Buffer head position */
+    microrl_hist_pos_t end;                     /*!< Buffer tail position */
+    microrl_hist_pos_t cur;                     /*!< Number of record from the newest one for navigation */
+#if MICRORL_CFG_USE_HISTORY_INDEX || __DOXYGEN__
+    microrl_hist_pos_t index_begin;             /*!< Index slot of the oldest record */
+    microrl_hist_pos_t count;                   /*!< Number of records in history */
+    microrl_hist_pos_t index[MICRORL_CFG_HISTORY_INDEX_LEN];   /*!< Ring of record header offsets */
+#endif /* MICRORL_CFG_USE_HISTORY_INDEX || __DOXYGEN__ */
+#if MICRORL_CFG_USE_HISTORY_PERSIST || __DOXYGEN__
+    microrl_hist_pos_t mark;                    /*!< Header position of the first record saved after last export */
+    microrl_hist_pos_t unsaved;                 /*!< Number of records saved after last export */
+    char unsaved_lost;                          /*!< Record saved after last export is removed already */
+#endif /* MICRORL_CFG_USE_HISTORY_PERSIST || __DOXYGEN__ */
+#if !MICRORL_CFG_USE_EXT_BUFFERS
     char ring_buf[MICRORL_CFG_RING_HISTORY_LEN];   /*!< History ring buffer */
-    int begin;                                  /*!< Buffer head position */
-    int end;                                    /*!< Buffer tail position */
-    int cur;                                    /*!< Buffer current position for navigation */
+#endif /* !MICRORL_CFG_USE_EXT_BUFFERS */
 } microrl_hist_rbuf_t;
 #endif /* MICRORL_CFG_USE_HISTORY || __DOXYGEN__ */
 
@@ -109,10 +164,77 @@ typedef struct microrl_quoted_tkn {
  * \param[in,out]   mrl: \ref microrl_t working instance
  * \param[in]       argc: argument count
  * \param[in]       argv: pointer array to token string
- * \return          '0' on success, '1' otherwise. Not used by library
+ * \return          '0' on success, '1' otherwise. Not used by library,
+ *                      except \ref MICRORL_EXEC_PENDING with \ref MICRORL_CFG_USE_ASYNC_EXEC
  */
 typedef int       (*microrl_exec_fn)(struct microrl* mrl, int argc, const char* const *argv);
 
+#if MICRORL_CFG_USE_ASYNC_EXEC || __DOXYGEN__
+/**
+ * \brief           Result of execute callback or command handler, command is not finished
+ *                  and \ref microrl_command_done will be called for it. Tokens passed to callback
+ *                  are valid until it returns only
+ */
+#define MICRORL_EXEC_PENDING                    (-0x7FFF)
+#endif /* MICRORL_CFG_USE_ASYNC_EXEC || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_COMMAND_ARGS || __DOXYGEN__
+/**
+ * \brief           Types of command arguments
+ */
+typedef enum {
+    MICRORL_ARG_INT = 0x00,                     /*!< Signed decimal number, value is in `num` */
+    MICRORL_ARG_HEX,                            /*!< Unsigned hexadecimal number with optional '0x' prefix, value is in `unum` */
+    MICRORL_ARG_ENUM,                           /*!< One of keywords, keyword index is in `num` */
+    MICRORL_ARG_STR,                            /*!< Any string */
+    MICRORL_ARG_FLAG,                           /*!< Token equal to argument name at any position, `num` is '1' if given */
+} microrl_arg_type_t;
+
+/**
+ * \brief           Command argument schema entry
+ *
+ * Arguments except flags are positional, optional ones must follow required ones
+ */
+typedef struct microrl_arg {
+    const char* name;                           /*!< Argument name, token of flag */
+    microrl_arg_type_t type;                    /*!< Member of \ref microrl_arg_type_t enumeration */
+    const char* const *keywords;                /*!< NULL-terminated list of \ref MICRORL_ARG_ENUM keywords */
+    uint8_t optional;                           /*!< Argument can be omitted */
+} microrl_arg_t;
+
+/**
+ * \brief           Parsed value of command argument
+ */
+typedef struct microrl_argval {
+    const char* str;                            /*!< Argument token, NULL if argument is not given */
+    long num;                                   /*!< Value of integer, keyword index or flag */
+    unsigned long unum;                         /*!< Value of hexadecimal number */
+} microrl_argval_t;
+#endif /* MICRORL_CFG_USE_COMMAND_ARGS || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_COMMANDS || __DOXYGEN__
+/**
+ * \brief           Command registry entry
+ *
+ * Entries of one table must be sorted by name in `strcmp` order,
+ * because table is searched with binary search
+ */
+typedef struct microrl_cmd {
+    const char* name;                           /*!< Command name */
+    microrl_exec_fn handler;                    /*!< Command handler, `argv[0]` is this command name.
+                                                    If NULL, list of subcommands is printed */
+    const struct microrl_cmd* children;         /*!< Sorted table of subcommands, NULL if none */
+    size_t children_num;                        /*!< Number of entries in subcommands table */
+    const char* help;                           /*!< Short help text printed in subcommands list, can be NULL */
+#if MICRORL_CFG_USE_COMMAND_ARGS || __DOXYGEN__
+    const microrl_arg_t* args;                  /*!< Arguments schema, NULL if arguments are not parsed.
+                                                    Values are in `argval` member of \ref microrl_t in schema order */
+    size_t args_num;                            /*!< Number of entries in arguments schema,
+                                                    \ref MICRORL_CFG_CMD_TOKEN_NMB maximum */
+#endif /* MICRORL_CFG_USE_COMMAND_ARGS || __DOXYGEN__ */
+} microrl_cmd_t;
+#endif /* MICRORL_CFG_USE_COMMANDS || __DOXYGEN__ */
+
 /**
  * \brief           Auto-complete function prototype
  * \param[in,out]   mrl: \ref microrl_t working instance
@@ -124,6 +246,18 @@ typedef int       (*microrl_exec_fn)(struct microrl* mrl, int argc, const char*
  */
 typedef char **   (*microrl_get_compl_fn)(struct microrl* mrl, int argc, const char* const *argv);
 
+/**
+ * \brief           Auto-complete iterator function prototype. Variants are requested one by one
+ *                  in increasing order of index, several passes are done and each one starts from 0
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       argc: argument count
+ * \param[in]       argv: pointer array to token string
+ * \param[in]       index: Number of requested variant
+ * \return          Variant with number `index`, it's must stay valid until the next call.
+ *                  NULL if there are no more variants
+ */
+typedef const char* (*microrl_compl_iter_fn)(struct microrl* mrl, int argc, const char* const *argv, size_t index);
+
 /**
  * \brief           Character output function prototype
  * \param[in,out]   mrl: \ref microrl_t working instance
@@ -131,67 +265,375 @@ typedef char **   (*microrl_get_compl_fn)(struct microrl* mrl, int argc, const c
  */
 typedef void      (*microrl_print_fn)(struct microrl* mrl, const char* ch);
 
+#if MICRORL_CFG_USE_OUTPUT_BUFFER || __DOXYGEN__
+/**
+ * \brief           Buffer output function prototype
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       buf: Data to write, not NULL-terminated
+ * \param[in]       len: Number of bytes to write
+ */
+typedef void      (*microrl_write_fn)(struct microrl* mrl, const char* buf, size_t len);
+#endif /* MICRORL_CFG_USE_OUTPUT_BUFFER || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_OUTPUT_BACKPRESSURE || __DOXYGEN__
+/**
+ * \brief           Non-blocking output function prototype
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       buf: Data to write, not NULL-terminated
+ * \param[in]       len: Number of bytes to write
+ * \return          Number of bytes accepted, the rest is passed again on next flush
+ */
+typedef size_t    (*microrl_try_write_fn)(struct microrl* mrl, const char* buf, size_t len);
+#endif /* MICRORL_CFG_USE_OUTPUT_BACKPRESSURE || __DOXYGEN__ */
+
+#if MICRORL_USE_TIME || __DOXYGEN__
+/**
+ * \brief           Monotonic time function prototype
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \return          Current time, milliseconds usually. Value is allowed to overflow
+ */
+typedef uint32_t  (*microrl_get_time_fn)(struct microrl* mrl);
+#endif /* MICRORL_USE_TIME || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_HISTORY_PERSIST || __DOXYGEN__
+/**
+ * \brief           History export output function prototype
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       data: Part of exported data
+ * \param[in]       len: Number of bytes in part
+ */
+typedef void      (*microrl_hist_sink_fn)(struct microrl* mrl, const char* data, size_t len);
+#endif /* MICRORL_CFG_USE_HISTORY_PERSIST || __DOXYGEN__ */
+
 /**
  * \brief           Ctrl+C terminal signal function prototype
  * \param[in,out]   mrl: \ref microrl_t working instance
  */
 typedef void      (*microrl_sigint_fn)(struct microrl* mrl);
 
+#if MICRORL_CFG_USE_STATS || __DOXYGEN__
+/**
+ * \brief           Instance statistics, counters are allowed to overflow
+ */
+typedef struct microrl_stats {
+    uint32_t in_bytes;                          /*!< Number of received chars */
+    uint32_t out_bytes;                         /*!< Number of bytes passed to output callbacks */
+    uint32_t out_calls;                         /*!< Number of output callbacks calls */
+    uint32_t redraw_insert;                     /*!< Line redraws after insert in the middle of line */
+    uint32_t redraw_backspace;                  /*!< Line redraws after chars are removed by backspace, delete or kill keys */
+    uint32_t redraw_history;                    /*!< Line redraws after record is restored from history */
+    uint32_t redraw_complete;                   /*!< Line redraws after auto-completion */
+    uint32_t hist_evictions;                    /*!< Number of older history records removed to free space */
+    uint32_t tkn_overflows;                     /*!< Number of splits failed on \ref MICRORL_CFG_CMD_TOKEN_NMB
+                                                    or \ref MICRORL_CFG_QUOTED_TOKEN_NMB limit */
+    uint32_t esc_unknown;                       /*!< Number of unknown or broken ESC sequences */
+} microrl_stats_t;
+#endif /* MICRORL_CFG_USE_STATS || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_TRACE || __DOXYGEN__
+/**
+ * \brief           Traced functions of library
+ */
+typedef enum {
+    MICRORL_TRACE_NEW_LINE = 0x00,              /*!< Entered line is split, saved in history and executed */
+    MICRORL_TRACE_COMPLETE,                     /*!< Auto-completion of line on TAB key */
+    MICRORL_TRACE_HIST_SEARCH                   /*!< Record is restored from history on Up or Down key */
+} microrl_trace_point_t;
+
+/**
+ * \brief           Trace function prototype, called at entry and exit of traced function
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \param[in]       point: Member of \ref microrl_trace_point_t enumeration
+ * \param[in]       leave: '0' at entry, '1' at exit of traced function
+ * \param[in]       stamp: Value returned by time stamp callback, '0' if it is not set
+ */
+typedef void      (*microrl_trace_fn)(struct microrl* mrl, microrl_trace_point_t point, int leave, uint32_t stamp);
+
+/**
+ * \brief           Trace time stamp function prototype
+ * \param[in,out]   mrl: \ref microrl_t working instance
+ * \return          Current time stamp in any units, CPU cycle counter for example. Value is allowed to overflow
+ */
+typedef uint32_t  (*microrl_get_stamp_fn)(struct microrl* mrl);
+#endif /* MICRORL_CFG_USE_TRACE || __DOXYGEN__ */
+
 /**
  * \brief           MicroRL struct, contains internal library data
  */
 typedef struct microrl {
-#if MICRORL_CFG_USE_ESC_SEQ || __DOXYGEN__
-    microrl_esq_code_t escape_seq;              /*!< Member of \ref microrl_esq_code_t */
-    char escape;                                /*!< Escape sequence catched flag */
-#endif /* MICRORL_CFG_USE_ESC_SEQ || __DOXYGEN__ */
+    /* Members are grouped by size to avoid padding: pointers, 32 bit values, positions, chars */
+    const char* prompt_str;                     /*!< Pointer to prompt string */
+#if MICRORL_CFG_USE_EXT_BUFFERS || __DOXYGEN__
+    char* cmdline;                              /*!< Command line input buffer provided by application */
+#endif /* MICRORL_CFG_USE_EXT_BUFFERS || __DOXYGEN__ */
+    microrl_print_fn print;                     /*!< Output print callback */
+    microrl_exec_fn execute;                    /*!< Command execute callback */
+    void* userdata;                             /*!< Generic user data storage */
 
-    char last_endl;                             /*!< Either 0 or the CR or LF that just triggered a newline */
+#if MICRORL_CFG_USE_OUTPUT_BUFFER || __DOXYGEN__
+    microrl_write_fn write;                     /*!< Buffer output callback, used instead of print if set */
+    size_t tx_len;                              /*!< Number of pending bytes in staging buffer */
+#if MICRORL_CFG_USE_OUTPUT_BACKPRESSURE || __DOXYGEN__
+    microrl_try_write_fn try_write;             /*!< Non-blocking output callback, used instead of write if set */
+#endif /* MICRORL_CFG_USE_OUTPUT_BACKPRESSURE || __DOXYGEN__ */
+#endif /* MICRORL_CFG_USE_OUTPUT_BUFFER || __DOXYGEN__ */
 
-#if MICRORL_CFG_USE_HISTORY || __DOXYGEN__
-    microrl_hist_rbuf_t ring_hist;              /*!< Ring history object */
-#endif /* MICRORL_CFG_USE_HISTORY || __DOXYGEN__ */
+#if MICRORL_CFG_USE_ASYNC_EXEC || __DOXYGEN__
+    size_t typeahead_len;                       /*!< Number of chars in type-ahead buffer */
+#endif /* MICRORL_CFG_USE_ASYNC_EXEC || __DOXYGEN__ */
 
-    const char* prompt_str;                     /*!< Pointer to prompt string */
-    char cmdline[MICRORL_CFG_CMDLINE_LEN];      /*!< Command line input buffer */
-    int cmdlen;                                 /*!< Last position in command line */
-    int cursor;                                 /*!< Input cursor */
+#if MICRORL_CFG_USE_CTRL_C || __DOXYGEN__
+    microrl_sigint_fn sigint;                   /*!< Ctrl+C terminal signal callback */
+#endif /* MICRORL_CFG_USE_CTRL_C || __DOXYGEN__ */
 
-#if MICRORL_CFG_USE_QUOTING || __DOXYGEN__
-    microrl_quoted_tkn_t quotes[MICRORL_CFG_QUOTED_TOKEN_NMB];   /*!< Pointers to quoted tokens */
-#endif /* MICRORL_CFG_USE_QUOTING || __DOXYGEN__ */
+#if MICRORL_USE_TIME || __DOXYGEN__
+    microrl_get_time_fn get_time;               /*!< Monotonic time callback */
+#endif /* MICRORL_USE_TIME || __DOXYGEN__ */
 
-    microrl_exec_fn execute;                    /*!< Command execute callback */
+#if MICRORL_CFG_USE_TRACE || __DOXYGEN__
+    microrl_trace_fn trace;                     /*!< Trace callback */
+    microrl_get_stamp_fn get_stamp;             /*!< Trace time stamp callback */
+#endif /* MICRORL_CFG_USE_TRACE || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_COMMANDS || __DOXYGEN__
+    const microrl_cmd_t* cmds;                  /*!< Sorted table of top level commands */
+    size_t cmds_num;                            /*!< Number of entries in top level commands table */
+#if MICRORL_CFG_USE_COMMAND_ARGS || __DOXYGEN__
+    microrl_argval_t argval[MICRORL_CFG_CMD_TOKEN_NMB]; /*!< Parsed arguments of executed command */
+#endif /* MICRORL_CFG_USE_COMMAND_ARGS || __DOXYGEN__ */
+#endif /* MICRORL_CFG_USE_COMMANDS || __DOXYGEN__ */
 
 #if MICRORL_CFG_USE_COMPLETE || __DOXYGEN__
     microrl_get_compl_fn get_completion;        /*!< Auto-completion callback */
+    microrl_compl_iter_fn compl_iter;           /*!< Auto-completion iterator callback */
+#if MICRORL_CFG_USE_COMPLETE_CACHE || __DOXYGEN__
+    char* compl_list[MICRORL_CFG_COMPLETE_CACHE_NMB + 1];  /*!< NULL-terminated list of cached variants */
+#endif /* MICRORL_CFG_USE_COMPLETE_CACHE || __DOXYGEN__ */
 #endif /* MICRORL_CFG_USE_COMPLETE || __DOXYGEN__ */
 
-    microrl_print_fn print;                     /*!< Output print callback */
+#if (MICRORL_CFG_USE_QUOTING && !MICRORL_CFG_USE_TOKEN_INDEX) || __DOXYGEN__
+    microrl_quoted_tkn_t quotes[MICRORL_CFG_QUOTED_TOKEN_NMB];   /*!< Pointers to quoted tokens */
+#endif /* (MICRORL_CFG_USE_QUOTING && !MICRORL_CFG_USE_TOKEN_INDEX) || __DOXYGEN__ */
 
-#if MICRORL_CFG_USE_CTRL_C || __DOXYGEN__
-    microrl_sigint_fn sigint;                   /*!< Ctrl+C terminal signal callback */
-#endif /* MICRORL_CFG_USE_CTRL_C || __DOXYGEN__ */
+#if MICRORL_CFG_USE_HISTORY_SEARCH || __DOXYGEN__
+    size_t search_match;                        /*!< Number of found history record */
+#endif /* MICRORL_CFG_USE_HISTORY_SEARCH || __DOXYGEN__ */
 
+#if MICRORL_CFG_USE_HISTORY || __DOXYGEN__
+    microrl_hist_rbuf_t ring_hist;              /*!< Ring history object */
+#endif /* MICRORL_CFG_USE_HISTORY || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_ESC_TIMEOUT || __DOXYGEN__
+    uint32_t escape_time;                       /*!< Time of sequence start */
+#endif /* MICRORL_CFG_USE_ESC_TIMEOUT || __DOXYGEN__ */
+#if MICRORL_USE_TIME || __DOXYGEN__
+    uint32_t last_input_time;                   /*!< Time of last input */
+#endif /* MICRORL_USE_TIME || __DOXYGEN__ */
+#if MICRORL_CFG_USE_ASYNC_EXEC || __DOXYGEN__
+    int exec_status;                            /*!< Result of last finished command */
+#endif /* MICRORL_CFG_USE_ASYNC_EXEC || __DOXYGEN__ */
+#if MICRORL_CFG_USE_OUTPUT_BACKPRESSURE || __DOXYGEN__
+    uint32_t tx_dropped;                        /*!< Number of output bytes lost on full staging buffer */
+#endif /* MICRORL_CFG_USE_OUTPUT_BACKPRESSURE || __DOXYGEN__ */
+#if MICRORL_CFG_USE_RX_RING || __DOXYGEN__
+    uint32_t rx_overruns;                       /*!< Number of chars dropped on full receive ring, written by producer */
+#endif /* MICRORL_CFG_USE_RX_RING || __DOXYGEN__ */
+#if MICRORL_CFG_USE_STATS || __DOXYGEN__
+    microrl_stats_t stats;                      /*!< Instance statistics, history evictions are counted in history object */
+#endif /* MICRORL_CFG_USE_STATS || __DOXYGEN__ */
     microrl_echo_t echo;                        /*!< Member of \ref microrl_echo_t enumeration */
-    int start_password;                         /*!< Start position to print '*' echo off chars */
-    void* userdata;                             /*!< Generic user data storage */
+#if MICRORL_CFG_USE_ESC_SEQ || __DOXYGEN__
+    microrl_esq_code_t escape_seq;              /*!< Parser state, member of \ref microrl_esq_code_t */
+#endif /* MICRORL_CFG_USE_ESC_SEQ || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_RX_RING || __DOXYGEN__
+    microrl_rx_pos_t rx_head;                   /*!< Number of chars put to receive ring, written by producer */
+    microrl_rx_pos_t rx_tail;                   /*!< Number of chars taken from receive ring, written by consumer */
+#endif /* MICRORL_CFG_USE_RX_RING || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_EXT_BUFFERS || __DOXYGEN__
+    microrl_pos_t cmdline_len;                  /*!< Command line input buffer size */
+#endif /* MICRORL_CFG_USE_EXT_BUFFERS || __DOXYGEN__ */
+    microrl_pos_t cmdlen;                       /*!< Last position in command line */
+    microrl_pos_t cursor;                       /*!< Input cursor */
+    microrl_pos_t start_password;               /*!< Start position to print '*' echo off chars */
+
+#if MICRORL_CFG_USE_SHADOW_LINE || __DOXYGEN__
+    microrl_pos_t shadow_len;                   /*!< Number of shown chars, -1 if shown line is unknown */
+    microrl_pos_t term_cursor;                  /*!< Cursor position on terminal */
+#if MICRORL_CFG_USE_HSCROLL || __DOXYGEN__
+    microrl_pos_t view_offset;                  /*!< First command line position shown on terminal */
+#endif /* MICRORL_CFG_USE_HSCROLL || __DOXYGEN__ */
+#if MICRORL_CFG_USE_UTF8 || __DOXYGEN__
+    microrl_pos_t shadow_cols;                  /*!< Number of columns taken by shown chars */
+    microrl_pos_t shadow_pos;                   /*!< Command line before this position is shown unchanged */
+#endif /* MICRORL_CFG_USE_UTF8 || __DOXYGEN__ */
+#endif /* MICRORL_CFG_USE_SHADOW_LINE || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_PASTE_BURST || __DOXYGEN__
+    microrl_pos_t dirty_pos;                    /*!< Earliest position of line not redrawn yet, -1 if none */
+#endif /* MICRORL_CFG_USE_PASTE_BURST || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_HISTORY_SEARCH || __DOXYGEN__
+    microrl_pos_t search_len;                   /*!< Reverse history search pattern length */
+    microrl_pos_t search_tail;                  /*!< Number of columns printed after the pattern */
+#endif /* MICRORL_CFG_USE_HISTORY_SEARCH || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_TOKEN_INDEX || __DOXYGEN__
+    microrl_pos_t tkn_pos[MICRORL_CFG_CMD_TOKEN_NMB];   /*!< Position of token text in command line */
+    microrl_pos_t tkn_len[MICRORL_CFG_CMD_TOKEN_NMB];   /*!< Length of token text, without quote marks */
+    microrl_pos_t tkn_num;                      /*!< Number of valid tokens in index */
+    microrl_pos_t tkn_err_pos;                  /*!< Position of invalid token, -1 if there is no one */
+    microrl_pos_t tkn_dirty;                    /*!< The first position changed after the last scan */
+#endif /* MICRORL_CFG_USE_TOKEN_INDEX || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_UTF8 || __DOXYGEN__
+    microrl_pos_t col_map[MICRORL_CFG_CMDLINE_LEN]; /*!< Display column of command line position */
+    microrl_pos_t col_valid;                    /*!< The last position with valid column in map */
+#endif /* MICRORL_CFG_USE_UTF8 || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_COMPLETE_CACHE || __DOXYGEN__
+    microrl_pos_t compl_key_len;                /*!< Length of cached line part, -1 if cache is empty */
+    microrl_pos_t compl_tkn_pos;                /*!< Position of completed token in cached line part */
+#endif /* MICRORL_CFG_USE_COMPLETE_CACHE || __DOXYGEN__ */
+
+#if !MICRORL_CFG_USE_EXT_BUFFERS
+    char cmdline[MICRORL_CFG_CMDLINE_LEN];      /*!< Command line input buffer */
+#endif /* !MICRORL_CFG_USE_EXT_BUFFERS */
+
+#if MICRORL_CFG_USE_SHADOW_LINE || __DOXYGEN__
+    char shadow[MICRORL_SHADOW_LEN];            /*!< Command line chars shown on terminal */
+#endif /* MICRORL_CFG_USE_SHADOW_LINE || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_HISTORY_SEARCH || __DOXYGEN__
+    char search_pattern[MICRORL_CFG_HISTORY_SEARCH_LEN];   /*!< Reverse history search pattern */
+    char search_active;                         /*!< Reverse history search is in progress */
+    char search_found;                          /*!< Some record found during the search */
+    char search_failed;                         /*!< Record with current pattern is not found */
+#endif /* MICRORL_CFG_USE_HISTORY_SEARCH || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_TOKEN_INDEX || __DOXYGEN__
+    char tkn_quote[MICRORL_CFG_CMD_TOKEN_NMB];  /*!< Quote mark of quoted token, '\0' otherwise */
+#endif /* MICRORL_CFG_USE_TOKEN_INDEX || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_COMPLETE_CACHE || __DOXYGEN__
+    char compl_buf[MICRORL_CFG_COMPLETE_CACHE_LEN]; /*!< Cached completion variants */
+    char compl_key[MICRORL_CFG_CMDLINE_LEN];    /*!< Command line part variants are cached for */
+#endif /* MICRORL_CFG_USE_COMPLETE_CACHE || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_UTF8 || __DOXYGEN__
+    char utf8_seq[4];                           /*!< Received bytes of incomplete UTF-8 char */
+    char utf8_len;                              /*!< Number of received bytes of incomplete char */
+    char utf8_need;                             /*!< Number of bytes of incomplete char, '0' if there is no one */
+#endif /* MICRORL_CFG_USE_UTF8 || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_LOG || __DOXYGEN__
+    char log_active;                            /*!< Log text is printed, command line is not shown */
+    char log_eol;                               /*!< The last printed log char is end of line */
+#endif /* MICRORL_CFG_USE_LOG || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_ASYNC_EXEC || __DOXYGEN__
+    char typeahead[MICRORL_CFG_TYPEAHEAD_LEN];  /*!< Input received while command is pending */
+    char exec_pending;                          /*!< Command returned \ref MICRORL_EXEC_PENDING and is not done */
+#endif /* MICRORL_CFG_USE_ASYNC_EXEC || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_RX_RING || __DOXYGEN__
+    char rx_ring[MICRORL_CFG_RX_RING_LEN];      /*!< Receive ring buffer */
+#endif /* MICRORL_CFG_USE_RX_RING || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_OUTPUT_BUFFER || __DOXYGEN__
+    char tx_buf[MICRORL_CFG_OUTPUT_BUFFER_LEN + 1]; /*!< Output staging buffer, 1 extra byte for NULL terminator */
+#if MICRORL_CFG_USE_OUTPUT_BACKPRESSURE || __DOXYGEN__
+    char tx_stalled;                            /*!< Non-blocking output callback did not accept all bytes */
+    char redraw_pending;                        /*!< Command line redraw is deferred until output drains */
+#endif /* MICRORL_CFG_USE_OUTPUT_BACKPRESSURE || __DOXYGEN__ */
+#endif /* MICRORL_CFG_USE_OUTPUT_BUFFER || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_ESC_SEQ || __DOXYGEN__
+    unsigned char escape_param;                 /*!< The first numeric parameter of sequence */
+    unsigned char escape_nparam;                /*!< Number of parameter separators of sequence */
+#endif /* MICRORL_CFG_USE_ESC_SEQ || __DOXYGEN__ */
+
+#if MICRORL_CFG_USE_PASTE_BURST || __DOXYGEN__
+    char burst;                                 /*!< Paste burst is detected for current input */
+#endif /* MICRORL_CFG_USE_PASTE_BURST || __DOXYGEN__ */
+
+    char last_endl;                             /*!< Either 0 or the CR or LF that just triggered a newline */
 } microrl_t;
 
+#if MICRORL_CFG_USE_EXT_BUFFERS
+microrlr_t  microrl_init_ex(microrl_t* mrl, microrl_print_fn print, char* cmdline, size_t cmdline_len,
+                            char* hist_buf, size_t hist_len);
+#else
 microrlr_t  microrl_init(microrl_t* mrl, microrl_print_fn print);
+#endif /* MICRORL_CFG_USE_EXT_BUFFERS */
 
 #if MICRORL_CFG_USE_COMPLETE
 void        microrl_set_complete_callback(microrl_t* mrl, microrl_get_compl_fn get_completion);
+void        microrl_set_complete_iter_callback(microrl_t* mrl, microrl_compl_iter_fn compl_iter);
 #endif /* MICRORL_CFG_USE_COMPLETE */
 void        microrl_set_execute_callback(microrl_t* mrl, microrl_exec_fn execute);
+#if MICRORL_CFG_USE_COMMANDS
+void        microrl_set_commands(microrl_t* mrl, const microrl_cmd_t* cmds, size_t num);
+#endif /* MICRORL_CFG_USE_COMMANDS */
 #if MICRORL_CFG_USE_CTRL_C
 void        microrl_set_sigint_callback(microrl_t* mrl, microrl_sigint_fn sigint);
 #endif /* MICRORL_CFG_USE_CTRL_C */
 
+#if MICRORL_CFG_USE_OUTPUT_BUFFER
+void        microrl_set_write_callback(microrl_t* mrl, microrl_write_fn write);
+#if MICRORL_CFG_USE_OUTPUT_BACKPRESSURE
+void        microrl_set_try_write_callback(microrl_t* mrl, microrl_try_write_fn try_write);
+#endif /* MICRORL_CFG_USE_OUTPUT_BACKPRESSURE */
+void        microrl_flush(microrl_t* mrl);
+#endif /* MICRORL_CFG_USE_OUTPUT_BUFFER */
+
+#if MICRORL_USE_TIME
+void        microrl_set_time_callback(microrl_t* mrl, microrl_get_time_fn get_time);
+#endif /* MICRORL_USE_TIME */
+#if MICRORL_USE_TICK
+void        microrl_tick(microrl_t* mrl);
+#endif /* MICRORL_USE_TICK */
+
+#if MICRORL_CFG_USE_STATS
+void        microrl_get_stats(const microrl_t* mrl, microrl_stats_t* stats);
+#endif /* MICRORL_CFG_USE_STATS */
+#if MICRORL_CFG_USE_TRACE
+void        microrl_set_trace_callback(microrl_t* mrl, microrl_trace_fn trace, microrl_get_stamp_fn get_stamp);
+#endif /* MICRORL_CFG_USE_TRACE */
+
+#if MICRORL_CFG_USE_SCRIPT
+microrlr_t  microrl_exec_script(microrl_t* mrl, const char* buf, size_t len, int stop_on_error);
+#endif /* MICRORL_CFG_USE_SCRIPT */
+
+#if MICRORL_CFG_USE_LOG
+void        microrl_log(microrl_t* mrl, const char* buf, size_t len);
+#endif /* MICRORL_CFG_USE_LOG */
+#if MICRORL_CFG_USE_PRINTF
+int         microrl_printf(microrl_t* mrl, const char* fmt, ...);
+#endif /* MICRORL_CFG_USE_PRINTF */
+
 void        microrl_set_echo(microrl_t* mrl, microrl_echo_t echo);
 
+#if MICRORL_CFG_USE_HISTORY_PERSIST
+void        microrl_hist_export(microrl_t* mrl, microrl_hist_sink_fn sink);
+microrlr_t  microrl_hist_export_delta(microrl_t* mrl, microrl_hist_sink_fn sink);
+microrlr_t  microrl_hist_import(microrl_t* mrl, const char* buf, size_t len);
+#endif /* MICRORL_CFG_USE_HISTORY_PERSIST */
+
+#if MICRORL_CFG_USE_RX_RING
+microrlr_t  microrl_rx_push_isr(microrl_t* mrl, char ch);
+size_t      microrl_rx_push_block_isr(microrl_t* mrl, const char* buf, size_t len);
+void        microrl_poll(microrl_t* mrl);
+#endif /* MICRORL_CFG_USE_RX_RING */
+
+#if MICRORL_CFG_USE_ASYNC_EXEC
+microrlr_t  microrl_command_done(microrl_t* mrl, int status);
+#endif /* MICRORL_CFG_USE_ASYNC_EXEC */
+
 void        microrl_insert_char(microrl_t* mrl, int ch);
-microrlr_t  microrl_insert_text(microrl_t* mrl, char* text, int len);
+void        microrl_process_input(microrl_t* mrl, const char* buf, size_t len);
+microrlr_t  microrl_insert_text(microrl_t* mrl, const char* text, int len);
 
 /**
  * \}
@@ -0,0 +1,288 @@
+/**
+ * \file            microrl.hpp
+ * \brief           C++17 front-end of Micro Read Line library
+ */
+
+/*
+ * Portion Copyright (c) 2011 Eugene SAMOYLOV
+ * Portion Copyright (c) 2021 Dmitry KARASEV
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of MicroRL - Micro Read Line library for small and embedded devices.
+ *
+ * Authors:         Eugene SAMOYLOV aka Helius <ghelius@gmail.com>,
+ *                  Dmitry KARASEV <karasevsdmitry@yandex.ru>
+ * Version:         1.7.0
+ */
+
+#ifndef MICRORL_HDR_HPP
+#define MICRORL_HDR_HPP
+
+#include <array>
+#include <cstddef>
+#include "microrl.h"
+
+#if !MICRORL_CFG_USE_COMMANDS
+#error "microrl.hpp requires MICRORL_CFG_USE_COMMANDS"
+#endif /* !MICRORL_CFG_USE_COMMANDS */
+
+/**
+ * \defgroup        MICRORL_CPP C++ front-end
+ * \brief           Shell class with command table built at compile time
+ * \{
+ *
+ * Example of usage:
+ * \code{.cpp}
+ * constexpr auto led_cmds = microrl_cpp::commands({
+ *     microrl_cpp::command("on", led_on, "Turn LED on"),
+ *     microrl_cpp::command("off", led_off, "Turn LED off"),
+ * });
+ *
+ * struct DebugConfig : microrl_cpp::DefaultConfig {
+ *     static constexpr microrl_print_fn print = uart_print;
+ *     static constexpr auto commands = microrl_cpp::commands({
+ *         microrl_cpp::command("version", version, "Print version"),
+ *         microrl_cpp::group("led", led_cmds, "LED control"),
+ *     });
+ * };
+ *
+ * microrl_cpp::Shell<DebugConfig> shell;
+ *
+ * // With MICRORL_CFG_USE_EXT_BUFFERS, small session with 32 bytes line and 64 bytes history
+ * microrl_cpp::Shell<DebugConfig, 32, 64> session;
+ * \endcode
+ */
+
+namespace microrl_cpp {
+
+namespace detail {
+
+/**
+ * \brief           Compare strings like `strcmp` in constant expression
+ * \param[in]       a: The first string
+ * \param[in]       b: The second string
+ * \return          Negative, zero or positive value, as `strcmp` does
+ */
+constexpr int compare(const char* a, const char* b) {
+    while ((*a != '\0') && (*a == *b)) {
+        ++a;
+        ++b;
+    }
+    return static_cast<int>(static_cast<unsigned char>(*a)) - static_cast<int>(static_cast<unsigned char>(*b));
+}
+
+/**
+ * \brief           Check command table is sorted and has no duplicate names,
+ *                  subcommand tables included
+ * \param[in]       cmds: Table of commands
+ * \param[in]       num: Number of entries in table
+ * \return          `true` if table can be used for binary search
+ */
+constexpr bool is_valid(const microrl_cmd_t* cmds, std::size_t num) {
+    for (std::size_t i = 0; i < num; ++i) {
+        if ((i > 0) && (compare(cmds[i - 1].name, cmds[i].name) >= 0)) {
+            return false;
+        }
+        if (!is_valid(cmds[i].children, cmds[i].children_num)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} /* namespace detail */
+
+/**
+ * \brief           Build command table entry
+ * \param[in]       name: Command name
+ * \param[in]       handler: Command handler, `argv[0]` is command name
+ * \param[in]       help: Short help text, can be `nullptr`
+ * \return          Command table entry
+ */
+constexpr microrl_cmd_t command(const char* name, microrl_exec_fn handler, const char* help = nullptr) {
+    microrl_cmd_t cmd{};
+
+    cmd.name = name;
+    cmd.handler = handler;
+    cmd.help = help;
+    return cmd;
+}
+
+#if MICRORL_CFG_USE_COMMAND_ARGS || __DOXYGEN__
+/**
+ * \brief           Build command table entry with arguments schema
+ * \param[in]       name: Command name
+ * \param[in]       handler: Command handler, parsed arguments are in `argval` member of \ref microrl_t
+ * \param[in]       args: Arguments schema, must have static storage
+ * \param[in]       help: Short help text, can be `nullptr`
+ * \return          Command table entry
+ */
+template <std::size_t N>
+constexpr microrl_cmd_t command(const char* name, microrl_exec_fn handler, const microrl_arg_t (&args)[N],
+                                const char* help = nullptr) {
+    static_assert(N <= MICRORL_CFG_CMD_TOKEN_NMB, "too many arguments in schema");
+    microrl_cmd_t cmd = command(name, handler, help);
+
+    cmd.args = args;
+    cmd.args_num = N;
+    return cmd;
+}
+#endif /* MICRORL_CFG_USE_COMMAND_ARGS || __DOXYGEN__ */
+
+/**
+ * \brief           Build command table entry with subcommands
+ * \param[in]       name: Command name
+ * \param[in]       children: Table of subcommands made by \ref commands, must have static storage
+ * \param[in]       help: Short help text, can be `nullptr`
+ * \param[in]       handler: Handler called if no subcommand is matched, `nullptr` to print subcommands list
+ * \return          Command table entry
+ */
+template <std::size_t N>
+constexpr microrl_cmd_t group(const char* name, const std::array<microrl_cmd_t, N>& children,
+                              const char* help = nullptr, microrl_exec_fn handler = nullptr) {
+    microrl_cmd_t cmd = command(name, handler, help);
+
+    cmd.children = children.data();
+    cmd.children_num = N;
+    return cmd;
+}
+
+/**
+ * \brief           Make command table sorted by name at compile time
+ * \param[in]       cmds: Command table entries in any order
+ * \return          Sorted command table
+ */
+template <std::size_t N>
+constexpr std::array<microrl_cmd_t, N> commands(const microrl_cmd_t (&cmds)[N]) {
+    std::array<microrl_cmd_t, N> arr{};
+
+    for (std::size_t i = 0; i < N; ++i) {
+        std::size_t j = i;
+        while ((j > 0) && (detail::compare(arr[j - 1].name, cmds[i].name) > 0)) {
+            arr[j] = arr[j - 1];
+            --j;
+        }
+        arr[j] = cmds[i];
+    }
+    return arr;
+}
+
+/**
+ * \brief           Default shell configuration, derive own configuration from it
+ *                  and override needed members. `print` and `commands` must be set
+ */
+struct DefaultConfig {
+    static constexpr microrl_exec_fn execute = nullptr;         /*!< Callback for lines not found in commands table */
+#if MICRORL_CFG_USE_CTRL_C || __DOXYGEN__
+    static constexpr microrl_sigint_fn sigint = nullptr;        /*!< Ctrl+C callback */
+#endif /* MICRORL_CFG_USE_CTRL_C || __DOXYGEN__ */
+    static constexpr microrl_echo_t echo = MICRORL_ECHO_ON;     /*!< Initial echo mode */
+};
+
+/**
+ * \brief           Shell instance with configuration known at compile time
+ * \tparam          Config: Shell configuration, derived from \ref DefaultConfig
+ * \tparam          CmdlineLen: Command line buffer size, can differ from
+ *                      \ref MICRORL_CFG_CMDLINE_LEN with \ref MICRORL_CFG_USE_EXT_BUFFERS only
+ * \tparam          HistoryLen: History ring buffer size, can differ from
+ *                      \ref MICRORL_CFG_RING_HISTORY_LEN with \ref MICRORL_CFG_USE_EXT_BUFFERS only
+ */
+template <typename Config, std::size_t CmdlineLen = MICRORL_CFG_CMDLINE_LEN,
+          std::size_t HistoryLen = MICRORL_CFG_RING_HISTORY_LEN>
+class Shell {
+    static_assert(detail::is_valid(Config::commands.data(), Config::commands.size()),
+                  "command names must be unique in each table");
+#if MICRORL_CFG_USE_EXT_BUFFERS
+    static_assert((CmdlineLen >= 2) && (CmdlineLen <= MICRORL_CFG_CMDLINE_LEN),
+                  "command line buffer size must be in range 2..MICRORL_CFG_CMDLINE_LEN");
+    static_assert(HistoryLen <= MICRORL_CFG_RING_HISTORY_LEN,
+                  "history buffer size must not exceed MICRORL_CFG_RING_HISTORY_LEN");
+#else
+    static_assert((CmdlineLen == MICRORL_CFG_CMDLINE_LEN) && (HistoryLen == MICRORL_CFG_RING_HISTORY_LEN),
+                  "buffer sizes can be set with MICRORL_CFG_USE_EXT_BUFFERS only");
+#endif /* MICRORL_CFG_USE_EXT_BUFFERS */
+
+public:
+    /**
+     * \brief           Initialize shell and set its callbacks
+     */
+    Shell() {
+#if MICRORL_CFG_USE_EXT_BUFFERS
+#if MICRORL_CFG_USE_HISTORY
+        microrl_init_ex(&mrl, Config::print, cmdline, CmdlineLen, history, HistoryLen);
+#else
+        microrl_init_ex(&mrl, Config::print, cmdline, CmdlineLen, nullptr, 0);
+#endif /* MICRORL_CFG_USE_HISTORY */
+#else
+        microrl_init(&mrl, Config::print);
+#endif /* MICRORL_CFG_USE_EXT_BUFFERS */
+        microrl_set_commands(&mrl, Config::commands.data(), Config::commands.size());
+        if constexpr (Config::execute != nullptr) {
+            microrl_set_execute_callback(&mrl, Config::execute);
+        }
+#if MICRORL_CFG_USE_CTRL_C
+        if constexpr (Config::sigint != nullptr) {
+            microrl_set_sigint_callback(&mrl, Config::sigint);
+        }
+#endif /* MICRORL_CFG_USE_CTRL_C */
+        if constexpr (Config::echo != MICRORL_ECHO_ON) {
+            microrl_set_echo(&mrl, Config::echo);
+        }
+    }
+
+    Shell(const Shell&) = delete;
+    Shell& operator=(const Shell&) = delete;
+
+    /**
+     * \brief           Insert one input char
+     * \param[in]       ch: Input character
+     */
+    void insert_char(int ch) {
+        microrl_insert_char(&mrl, ch);
+    }
+
+    /**
+     * \brief           Insert block of input chars
+     * \param[in]       buf: Input data
+     * \param[in]       len: Number of bytes in input data
+     */
+    void process_input(const char* buf, std::size_t len) {
+        microrl_process_input(&mrl, buf, len);
+    }
+
+    /**
+     * \brief           Get working instance to use with C API
+     * \return          \ref microrl_t working instance
+     */
+    microrl_t* get() {
+        return &mrl;
+    }
+
+private:
+    microrl_t mrl;                              /*!< Working instance */
+#if MICRORL_CFG_USE_EXT_BUFFERS
+    char cmdline[CmdlineLen];                   /*!< Command line input buffer */
+#if MICRORL_CFG_USE_HISTORY
+    char history[HistoryLen];                   /*!< History ring buffer */
+#endif /* MICRORL_CFG_USE_HISTORY */
+#endif /* MICRORL_CFG_USE_EXT_BUFFERS */
+};
+
+} /* namespace microrl_cpp */
+
+/**
+ * \}
+ */
+
+#endif  /* MICRORL_HDR_HPP */
@@ -57,6 +57,17 @@ extern "C" {
 #define MICRORL_CFG_CMDLINE_LEN               (1 + 60)
 #endif
 
+/**
+ * \brief           Enable caller-provided buffers. Command line and history ring buffers are
+ *                  not embedded in \ref microrl_t then, application passes them with their sizes
+ *                  to \ref microrl_init_ex instead of \ref microrl_init, so each instance can have
+ *                  own sizes. _CMDLINE_LEN and _RING_HISTORY_LEN parameters set maximum sizes,
+ *                  they size internal stack buffers and index types
+ */
+#ifndef MICRORL_CFG_USE_EXT_BUFFERS
+#define MICRORL_CFG_USE_EXT_BUFFERS           0
+#endif
+
 /**
  * \brief           Command token number, define max token it command line, if number of token 
  *                  typed in command line exceed this value, then prints message about it and
@@ -95,6 +106,54 @@ extern "C" {
 #define MICRORL_CFG_USE_COMPLETE              1
 #endif
 
+/**
+ * \brief           Enable built-in command registry. Commands are described by static table
+ *                  of \ref microrl_cmd_t sorted by name, each one can have subcommands table.
+ *                  Registry is set by \ref microrl_set_commands, then Enter line is dispatched
+ *                  by binary search of tokens in tables, and TAB completes from the same tables
+ *                  if completion callback is not set
+ */
+#ifndef MICRORL_CFG_USE_COMMANDS
+#define MICRORL_CFG_USE_COMMANDS              0
+#endif
+
+/**
+ * \brief           Enable arguments schema of registry commands. Arguments of command with schema
+ *                  are parsed to typed values before its handler is called, bad argument is reported
+ *                  with its number. Keywords of enumeration arguments and flags are completed by TAB.
+ *                  Depends upon _USE_COMMANDS parameter
+ */
+#ifndef MICRORL_CFG_USE_COMMAND_ARGS
+#define MICRORL_CFG_USE_COMMAND_ARGS          0
+#endif
+
+/**
+ * \brief           Enable cache of completion variants. Variants returned by completion callback
+ *                  are copied to cache with the line part they are got for. If user presses TAB
+ *                  again after typing more chars of the same token, cached variants are filtered
+ *                  by new prefix and callback is not called. Cache is dropped on Enter.
+ *                  Depends upon _COMPLETE_CACHE_NMB and _COMPLETE_CACHE_LEN parameters
+ */
+#ifndef MICRORL_CFG_USE_COMPLETE_CACHE
+#define MICRORL_CFG_USE_COMPLETE_CACHE        0
+#endif
+
+/**
+ * \brief           Maximum number of cached completion variants. If callback returns more variants,
+ *                  they are not cached
+ */
+#ifndef MICRORL_CFG_COMPLETE_CACHE_NMB
+#define MICRORL_CFG_COMPLETE_CACHE_NMB        16
+#endif
+
+/**
+ * \brief           Size of buffer for cached completion variants, including NULL terminator
+ *                  of each variant. If variants do not fit, they are not cached
+ */
+#ifndef MICRORL_CFG_COMPLETE_CACHE_LEN
+#define MICRORL_CFG_COMPLETE_CACHE_LEN        128
+#endif
+
 /**
  * \brief           Define it, if you want to allow quoting command arguments to include spaces.
  *                  Depends upon _QUOTED_TOKEN_NMB parameter
@@ -115,6 +174,16 @@ extern "C" {
 #define MICRORL_CFG_QUOTED_TOKEN_NMB          2
 #endif
 
+/**
+ * \brief           Enable token index of command line. Positions and lengths of tokens are kept
+ *                  and only tokens from the first edited position are rescanned, when tokens are
+ *                  needed on Enter or TAB. Command line is not modified to split it, tokens which
+ *                  are not null-terminated in line (quoted or cut by cursor) are copied to stack
+ */
+#ifndef MICRORL_CFG_USE_TOKEN_INDEX
+#define MICRORL_CFG_USE_TOKEN_INDEX           0
+#endif
+
 /**
  * \brief           Define it, if you wanna use history. It s work's like bash history, and
  *                  set stored value to cmdline, if UP and DOWN key pressed. Using history add
@@ -129,12 +198,82 @@ extern "C" {
  *                  For saving memory, each entered cmdline store to history in ring buffer,
  *                  so we can not say, how many line we can store, it depends from cmdline len,
  *                  but memory using more effective. We not prefer dinamic memory allocation for
- *                  small and embedded devices. Overhead is 2 char on each saved line
+ *                  small and embedded devices. Overhead is _HISTORY_HEADER_SIZE chars on each saved line.
+ *                  Buffer with 1 byte headers is limited to 256 bytes
  */
 #ifndef MICRORL_CFG_RING_HISTORY_LEN
 #define MICRORL_CFG_RING_HISTORY_LEN          64
 #endif
 
+/**
+ * \brief           Size of history record length header, 1 or 2 bytes. 1 byte header is the most
+ *                  compact and allows history buffer up to 256 bytes. Set it to 2 for bigger
+ *                  history buffer, records are limited by 65535 bytes then
+ */
+#ifndef MICRORL_CFG_HISTORY_HEADER_SIZE
+#define MICRORL_CFG_HISTORY_HEADER_SIZE       1
+#endif
+
+/**
+ * \brief           Enable compressed history. Repeat of the last record is not saved, and each
+ *                  record keeps only length of prefix shared with previous record and the rest of line.
+ *                  Lines are rebuilt from previous records on navigation, so similar commands take
+ *                  much less space in the ring buffer. Overhead is one more _HISTORY_HEADER_SIZE chars
+ *                  on each saved line. Works faster with _USE_HISTORY_INDEX parameter.
+ *                  Depends upon _USE_HISTORY parameter
+ */
+#ifndef MICRORL_CFG_USE_HISTORY_COMPRESS
+#define MICRORL_CFG_USE_HISTORY_COMPRESS      0
+#endif
+
+/**
+ * \brief           Enable history export and import with \ref microrl_hist_export, \ref microrl_hist_export_delta
+ *                  and \ref microrl_hist_import, to keep history in flash or file between reboots.
+ *                  Snapshot is the raw ring buffer, so restore is a copy with bounds check.
+ *                  Delta contains only lines saved after the last export and can be appended to the
+ *                  snapshot. Depends upon _USE_HISTORY parameter
+ */
+#ifndef MICRORL_CFG_USE_HISTORY_PERSIST
+#define MICRORL_CFG_USE_HISTORY_PERSIST       0
+#endif
+
+/**
+ * \brief           Enable index of history records. Index is ring of record header offsets
+ *                  kept next to the history ring buffer, it is updated as records are saved and
+ *                  removed, so history navigation finds a record without walking the whole buffer.
+ *                  Depends upon _USE_HISTORY parameter
+ */
+#ifndef MICRORL_CFG_USE_HISTORY_INDEX
+#define MICRORL_CFG_USE_HISTORY_INDEX         0
+#endif
+
+/**
+ * \brief           Max number of records in history index. Every record takes 2 bytes in ring buffer
+ *                  at least, so default value never limits history. If set less, older records are
+ *                  removed when index is full. Depends upon _USE_HISTORY_INDEX parameter
+ */
+#ifndef MICRORL_CFG_HISTORY_INDEX_LEN
+#define MICRORL_CFG_HISTORY_INDEX_LEN         (MICRORL_CFG_RING_HISTORY_LEN / 2)
+#endif
+
+/**
+ * \brief           Enable incremental reverse history search on Ctrl+R, like in bash. Each typed char
+ *                  narrows the search from the last found record, Ctrl+R searches older record,
+ *                  Ctrl+G or Ctrl+C cancels the search, other keys take found record to command line.
+ *                  Ctrl+R (retype prompt and command line) is available only if echo is disabled then.
+ *                  Works faster with _USE_HISTORY_INDEX parameter. Depends upon _USE_HISTORY parameter
+ */
+#ifndef MICRORL_CFG_USE_HISTORY_SEARCH
+#define MICRORL_CFG_USE_HISTORY_SEARCH        0
+#endif
+
+/**
+ * \brief           Max length of reverse history search pattern. Depends upon _USE_HISTORY_SEARCH parameter
+ */
+#ifndef MICRORL_CFG_HISTORY_SEARCH_LEN
+#define MICRORL_CFG_HISTORY_SEARCH_LEN        16
+#endif
+
 /**
  * \brief           Size of the buffer used for piecemeal printing of part or all of the command
  *                  line.  Allocated on the stack.  Must be at least 16.                 
@@ -143,6 +282,121 @@ extern "C" {
 #define MICRORL_CFG_PRINT_BUFFER_LEN          40
 #endif
 
+/**
+ * \brief           Enable minimal line redraw. Copy of command line shown on terminal is kept
+ *                  inside \ref microrl_t, and on redraw only changed part of line is printed.
+ *                  Common prefix and suffix (if line length is not changed) of old and new line
+ *                  are skipped, so recalling similar command from history prints only a few chars.
+ *                  Memory consuming depends from _CMDLINE_LEN parameter
+ */
+#ifndef MICRORL_CFG_USE_SHADOW_LINE
+#define MICRORL_CFG_USE_SHADOW_LINE           0
+#endif
+
+/**
+ * \brief           Enable horizontal scrolling of command line. Only part of line around cursor
+ *                  is shown after prompt, so line never wraps and redraw cost is limited by
+ *                  terminal width instead of line length. Hidden parts of line are marked with
+ *                  '<' and '>' chars at the edges. Depends upon _USE_SHADOW_LINE parameter
+ */
+#ifndef MICRORL_CFG_USE_HSCROLL
+#define MICRORL_CFG_USE_HSCROLL               0
+#endif
+
+/**
+ * \brief           Terminal width in columns, includes prompt. The last column is not used to
+ *                  avoid line wrap. Used by _USE_HSCROLL parameter and to print completion
+ *                  variants in columns
+ */
+#ifndef MICRORL_CFG_TERMINAL_WIDTH
+#define MICRORL_CFG_TERMINAL_WIDTH            80
+#endif
+
+/**
+ * \brief           Enable UTF-8 editing. Multi-byte char is one editing unit for cursor moves,
+ *                  backspace and delete, and takes one terminal column. Display column of every
+ *                  command line position is cached and updated from the first changed position only,
+ *                  so cursor moves and redraws don't rescan line. Bytes of char split between input
+ *                  calls are kept until char is complete, broken sequences are dropped.
+ *                  Wide (CJK) and combining chars are not supported.
+ *                  Memory consuming depends from _CMDLINE_LEN parameter
+ */
+#ifndef MICRORL_CFG_USE_UTF8
+#define MICRORL_CFG_USE_UTF8                  0
+#endif
+
+/**
+ * \brief           Enable output coalescing. All terminal output generated while processing
+ *                  one input event (or one bulk input call) is collected in TX staging buffer
+ *                  inside \ref microrl_t and passed to the terminal with one callback call.
+ *                  Output goes to the \ref microrl_write_fn callback if it is set with
+ *                  'microrl_set_write_callback', otherwise to the print callback.
+ *                  Use it if every call of output callback is expensive (UART driver, TCP packet)
+ */
+#ifndef MICRORL_CFG_USE_OUTPUT_BUFFER
+#define MICRORL_CFG_USE_OUTPUT_BUFFER         0
+#endif
+
+/**
+ * \brief           Size of TX staging buffer used to coalesce terminal output.
+ *                  Buffer is flushed earlier if it is full. Depends upon _USE_OUTPUT_BUFFER parameter
+ */
+#ifndef MICRORL_CFG_OUTPUT_BUFFER_LEN
+#define MICRORL_CFG_OUTPUT_BUFFER_LEN         64
+#endif
+
+/**
+ * \brief           Enable non-blocking output with 'microrl_set_try_write_callback'. Callback returns
+ *                  number of accepted bytes, the rest is kept in staging buffer and passed again on
+ *                  next flush. While output is stalled command line redraws are deferred and done once
+ *                  in current state of line when output drains, so holding a key does not queue
+ *                  outdated redraws. Other output lost on full staging buffer is counted.
+ *                  Depends upon _USE_OUTPUT_BUFFER and _USE_SHADOW_LINE parameters
+ */
+#ifndef MICRORL_CFG_USE_OUTPUT_BACKPRESSURE
+#define MICRORL_CFG_USE_OUTPUT_BACKPRESSURE   0
+#endif
+
+/**
+ * \brief           Enable receive ring for input from interrupt or DMA callback. Producer puts chars
+ *                  with 'microrl_rx_push_isr' or 'microrl_rx_push_block_isr', main loop drains them
+ *                  with 'microrl_poll'. Ring is lock-free for one producer and one consumer.
+ *                  Acquire/release ordering is made with GCC/Clang atomic builtins, which is correct
+ *                  for Cortex-M and multi-core hosts. Other compilers use volatile access,
+ *                  which is enough on single-core MCU only
+ */
+#ifndef MICRORL_CFG_USE_RX_RING
+#define MICRORL_CFG_USE_RX_RING               0
+#endif
+
+/**
+ * \brief           Size of receive ring, must be power of 2. Chars are dropped and counted
+ *                  as overrun if ring is full. Depends upon _USE_RX_RING parameter
+ */
+#ifndef MICRORL_CFG_RX_RING_LEN
+#define MICRORL_CFG_RX_RING_LEN               64
+#endif
+
+/**
+ * \brief           Enable paste burst detection. Chars inserted in the middle of line during burst
+ *                  don't redraw the line tail on each char, line is marked dirty instead and
+ *                  redrawn once from the earliest dirty position when burst ends.
+ *                  Burst is input inside one 'microrl_process_input' call, and, if time callback
+ *                  is set with 'microrl_set_time_callback', input with chars coming closer than
+ *                  _PASTE_BURST_TIME to each other. Call 'microrl_tick' periodically then
+ */
+#ifndef MICRORL_CFG_USE_PASTE_BURST
+#define MICRORL_CFG_USE_PASTE_BURST           0
+#endif
+
+/**
+ * \brief           Max interval between input chars of one paste burst, in time callback units
+ *                  (milliseconds usually). Depends upon _USE_PASTE_BURST parameter
+ */
+#ifndef MICRORL_CFG_PASTE_BURST_TIME
+#define MICRORL_CFG_PASTE_BURST_TIME          10
+#endif
+
 /**
  * \brief           Enable Handling terminal ESC sequence. If disabling, then cursor arrow, HOME, END will not work,
  *                  use Ctrl+A(B,F,P,N,A,E,H,K,U,C) see README, but decrease code memory.
@@ -151,16 +405,43 @@ extern "C" {
 #define MICRORL_CFG_USE_ESC_SEQ               1
 #endif
 
+/**
+ * \brief           Enable timeout of incomplete ESC sequence. Char coming after _ESC_TIMEOUT_TIME
+ *                  is not part of sequence, so lone ESC keypress doesn't eat the next key.
+ *                  Time callback must be set with 'microrl_set_time_callback', call 'microrl_tick'
+ *                  periodically to finish sequence without input. Depends upon _USE_ESC_SEQ parameter
+ */
+#ifndef MICRORL_CFG_USE_ESC_TIMEOUT
+#define MICRORL_CFG_USE_ESC_TIMEOUT           0
+#endif
+
+/**
+ * \brief           Max time of ESC sequence receiving, in time callback units (milliseconds usually).
+ *                  Depends upon _USE_ESC_TIMEOUT parameter
+ */
+#ifndef MICRORL_CFG_ESC_TIMEOUT_TIME
+#define MICRORL_CFG_ESC_TIMEOUT_TIME          100
+#endif
+
 /**
  * \brief           Use sprintf from you standard complier library, but it gives some overhead.
- *                  If not defined, use my own number conversion code, it's save about 800 byte of
- *                  code size on AVR (avr-gcc build).
- *                  Try to build with and without, and compare total code size for tune library.
+ * \note            Not used anymore, numbers of ESC sequences and \ref MICRORL_CFG_USE_PRINTF
+ *                  are converted by library own code in any case. Kept for existing user configs
  */
 #ifndef MICRORL_CFG_USE_LIBC_STDIO
 #define MICRORL_CFG_USE_LIBC_STDIO            1
 #endif
 
+/**
+ * \brief           Enable 'microrl_printf' function to print formatted text from command handlers
+ *                  without libc. Supports '%d', '%i', '%u', '%x', '%X', '%c', '%s' with flags '-' and '0',
+ *                  width and 'l' modifier. With \ref MICRORL_CFG_USE_OUTPUT_BUFFER text goes to output
+ *                  staging buffer directly, otherwise it is collected by _PRINT_BUFFER_LEN parts
+ */
+#ifndef MICRORL_CFG_USE_PRINTF
+#define MICRORL_CFG_USE_PRINTF                0
+#endif
+
 /**
  * \brief           Use a single carriage return character to move the cursor to the left margin
  *                  rather than moving left by a large number.  This reduces the number of
@@ -178,6 +459,61 @@ extern "C" {
 #define MICRORL_CFG_USE_CTRL_C                1
 #endif
 
+/**
+ * \brief           Enable 'microrl_log' function to print log text while command line is edited.
+ *                  Prompt and command line are erased before the first log text and printed again
+ *                  once by 'microrl_tick' or next input, so many log calls between ticks cost
+ *                  one erase and one redraw
+ */
+#ifndef MICRORL_CFG_USE_LOG
+#define MICRORL_CFG_USE_LOG                   0
+#endif
+
+/**
+ * \brief           Enable deferred command execution. Execute callback or command handler can return
+ *                  \ref MICRORL_EXEC_PENDING and finish command later with \ref microrl_command_done,
+ *                  prompt is printed then. Input received while command is pending is kept in
+ *                  type-ahead buffer and processed after prompt, Ctrl+C is passed to 'sigint' callback
+ *                  at once. Depends upon _TYPEAHEAD_LEN parameter
+ */
+#ifndef MICRORL_CFG_USE_ASYNC_EXEC
+#define MICRORL_CFG_USE_ASYNC_EXEC            0
+#endif
+
+/**
+ * \brief           Size of type-ahead buffer, chars received while it is full are dropped
+ */
+#ifndef MICRORL_CFG_TYPEAHEAD_LEN
+#define MICRORL_CFG_TYPEAHEAD_LEN             32
+#endif
+
+/**
+ * \brief           Enable 'microrl_exec_script' function to execute lines of text without editing.
+ *                  Lines are split to tokens with the same rules as command line and passed to
+ *                  command registry or execute callback, without echo, history, prompt
+ *                  and ESC sequences processing
+ */
+#ifndef MICRORL_CFG_USE_SCRIPT
+#define MICRORL_CFG_USE_SCRIPT                0
+#endif
+
+/**
+ * \brief           Enable instance statistics: input and output bytes, output callback calls,
+ *                  line redraws by cause, history evictions, token overflows and unknown ESC sequences.
+ *                  Counters are read with 'microrl_get_stats'
+ */
+#ifndef MICRORL_CFG_USE_STATS
+#define MICRORL_CFG_USE_STATS                 0
+#endif
+
+/**
+ * \brief           Enable trace callback called at entry and exit of line execution, auto-completion
+ *                  and history navigation with time stamp from user callback, for profiling
+ */
+#ifndef MICRORL_CFG_USE_TRACE
+#define MICRORL_CFG_USE_TRACE                 0
+#endif
+
 /**
  * \brief           Print prompt at 'microrl_init', if enable, prompt will print at startup, 
  *                  otherwise first prompt will print after first press Enter in terminal
@@ -203,9 +539,70 @@ extern "C" {
 
 #if !__DOXYGEN__
 
-#if _RING_HISTORY_LEN > 256
-#error "This history implementation (ring buffer with 1 byte iterator) allow 256 byte buffer size maximum"
-#endif /* _RING_HISTORY_LEN > 256 */
+#if MICRORL_CFG_USE_HSCROLL
+/* Number of columns to show command line */
+#define MICRORL_VIEW_WIDTH                    (MICRORL_CFG_TERMINAL_WIDTH - MICRORL_CFG_PROMPT_LEN - 1)
+#if MICRORL_CFG_USE_UTF8 && ((MICRORL_VIEW_WIDTH * 4) < MICRORL_CFG_CMDLINE_LEN)
+/* Every shown column takes up to 4 bytes */
+#define MICRORL_SHADOW_LEN                    (MICRORL_VIEW_WIDTH * 4)
+#elif MICRORL_CFG_USE_UTF8
+#define MICRORL_SHADOW_LEN                    MICRORL_CFG_CMDLINE_LEN
+#else
+#define MICRORL_SHADOW_LEN                    MICRORL_VIEW_WIDTH
+#endif /* MICRORL_CFG_USE_UTF8 && ((MICRORL_VIEW_WIDTH * 4) < MICRORL_CFG_CMDLINE_LEN) */
+#else
+#define MICRORL_SHADOW_LEN                    MICRORL_CFG_CMDLINE_LEN
+#endif /* MICRORL_CFG_USE_HSCROLL */
+
+#if MICRORL_CFG_USE_HSCROLL && !MICRORL_CFG_USE_SHADOW_LINE
+#error "MICRORL_CFG_USE_HSCROLL requires MICRORL_CFG_USE_SHADOW_LINE"
+#endif /* MICRORL_CFG_USE_HSCROLL && !MICRORL_CFG_USE_SHADOW_LINE */
+
+#if MICRORL_CFG_USE_HSCROLL && (MICRORL_VIEW_WIDTH < 8)
+#error "MICRORL_CFG_TERMINAL_WIDTH is too small for prompt and command line"
+#endif /* MICRORL_CFG_USE_HSCROLL && (MICRORL_VIEW_WIDTH < 8) */
+
+/* Time callback is needed by features working with time intervals */
+#define MICRORL_USE_TIME                      (MICRORL_CFG_USE_PASTE_BURST || MICRORL_CFG_USE_ESC_TIMEOUT)
+
+/* Periodic call is needed by features finished in main loop */
+#define MICRORL_USE_TICK                      (MICRORL_USE_TIME || MICRORL_CFG_USE_LOG)
+
+#if MICRORL_CFG_USE_COMMAND_ARGS && !MICRORL_CFG_USE_COMMANDS
+#error "MICRORL_CFG_USE_COMMAND_ARGS requires MICRORL_CFG_USE_COMMANDS"
+#endif /* MICRORL_CFG_USE_COMMAND_ARGS && !MICRORL_CFG_USE_COMMANDS */
+
+#if MICRORL_CFG_USE_COMPLETE_CACHE && !MICRORL_CFG_USE_COMPLETE
+#error "MICRORL_CFG_USE_COMPLETE_CACHE requires MICRORL_CFG_USE_COMPLETE"
+#endif /* MICRORL_CFG_USE_COMPLETE_CACHE && !MICRORL_CFG_USE_COMPLETE */
+
+#if MICRORL_CFG_USE_HISTORY_SEARCH && !MICRORL_CFG_USE_HISTORY
+#error "MICRORL_CFG_USE_HISTORY_SEARCH requires MICRORL_CFG_USE_HISTORY"
+#endif /* MICRORL_CFG_USE_HISTORY_SEARCH && !MICRORL_CFG_USE_HISTORY */
+
+#if MICRORL_CFG_USE_OUTPUT_BACKPRESSURE && (!MICRORL_CFG_USE_OUTPUT_BUFFER || !MICRORL_CFG_USE_SHADOW_LINE)
+#error "MICRORL_CFG_USE_OUTPUT_BACKPRESSURE requires MICRORL_CFG_USE_OUTPUT_BUFFER and MICRORL_CFG_USE_SHADOW_LINE"
+#endif /* MICRORL_CFG_USE_OUTPUT_BACKPRESSURE && (!MICRORL_CFG_USE_OUTPUT_BUFFER || !MICRORL_CFG_USE_SHADOW_LINE) */
+
+#if MICRORL_CFG_USE_RX_RING && ((MICRORL_CFG_RX_RING_LEN & (MICRORL_CFG_RX_RING_LEN - 1)) != 0)
+#error "MICRORL_CFG_RX_RING_LEN must be power of 2"
+#endif /* MICRORL_CFG_USE_RX_RING && ((MICRORL_CFG_RX_RING_LEN & (MICRORL_CFG_RX_RING_LEN - 1)) != 0) */
+
+#if MICRORL_CFG_USE_ESC_TIMEOUT && !MICRORL_CFG_USE_ESC_SEQ
+#error "MICRORL_CFG_USE_ESC_TIMEOUT requires MICRORL_CFG_USE_ESC_SEQ"
+#endif /* MICRORL_CFG_USE_ESC_TIMEOUT && !MICRORL_CFG_USE_ESC_SEQ */
+
+#if (MICRORL_CFG_HISTORY_HEADER_SIZE != 1) && (MICRORL_CFG_HISTORY_HEADER_SIZE != 2)
+#error "MICRORL_CFG_HISTORY_HEADER_SIZE must be 1 or 2"
+#endif /* (MICRORL_CFG_HISTORY_HEADER_SIZE != 1) && (MICRORL_CFG_HISTORY_HEADER_SIZE != 2) */
+
+#if MICRORL_CFG_USE_HISTORY && (MICRORL_CFG_HISTORY_HEADER_SIZE == 1) && (MICRORL_CFG_RING_HISTORY_LEN > 256)
+#error "History with 1 byte record header allows 256 byte buffer size maximum, set MICRORL_CFG_HISTORY_HEADER_SIZE to 2"
+#endif /* MICRORL_CFG_USE_HISTORY && (MICRORL_CFG_HISTORY_HEADER_SIZE == 1) && (MICRORL_CFG_RING_HISTORY_LEN > 256) */
+
+#if MICRORL_CFG_USE_HISTORY_INDEX && (MICRORL_CFG_HISTORY_INDEX_LEN > MICRORL_CFG_RING_HISTORY_LEN)
+#error "MICRORL_CFG_HISTORY_INDEX_LEN must not exceed MICRORL_CFG_RING_HISTORY_LEN"
+#endif /* MICRORL_CFG_USE_HISTORY_INDEX && (MICRORL_CFG_HISTORY_INDEX_LEN > MICRORL_CFG_RING_HISTORY_LEN) */
 
 #endif /* !__DOXYGEN__ */
 